@@ -122,7 +122,7 @@ public:
         kstart_ = dst;
         memcpy(dst,user_key.data(),usize);
         dst += usize;
-        EncodeFixed64(dst,PackSequenceAndType(s,kValueTypeForSeek));//定长，8字节
+        EncodeFixed64(dst,PackSequenceAndType(sequence,kValueTypeForSeek));//定长，8字节
         dst += 8;
         end_ = dst;
     }
@@ -189,7 +189,7 @@ public:
         }
     }
 
-    const Comparator* user_comparator() const { return user_comparator_;}
+    const Comparator* user_comparator() const override { return user_comparator_;}
     int Compare(const InternalKey& a,const InternalKey& b) const { return Compare(a.Encode(),b.Encode());}
 };
 
@@ -1,24 +1,29 @@
 #pragma once
+#include<atomic>
 #include<string>
 
 #include"db/dbformat.h"
 #include"db/skiplist.h"
 #include"util/arena.h"
 #include "table/iterator.h"
+#include "util/bloom.h"
+#include "util/options.h"
+#include "util/slice_transform.h"
 
 namespace leveldb
 {
-class InternalKeyComparator;
 class MemTableIterator;
 static Slice GetLengthPrefixedSlice(const char* data){
-    uint32_t len;
+    uint32_t len = 0;
     const char*p = data;
     p = GetVarint32Ptr(p,p+5,&len);
     return Slice(p,len);
 }
 class MemTable{
 public:
-    explicit MemTable(const InternalKeyComparator& comparator);
+    //prefix_extractor不为空时为user key的前缀维护一个bloom filter，供前缀查找跳过memtable
+    explicit MemTable(const InternalComparator& comparator,const SliceTransform* prefix_extractor = nullptr,
+                      size_t prefix_bloom_bits = kDefaultPrefixBloomBits);
     MemTable(const MemTable&) = delete;
     MemTable& operator=(const MemTable&) = delete;
 
@@ -33,12 +38,23 @@ public:
 
     size_t ApprosimateMemoryUsage();
     Iterator* NewIterator();
+    //options.prefix_seek时Seek的target前缀不在memtable中直接得到无效的迭代器
+    Iterator* NewIterator(const ReadOptions& options);
     void Add(SequenceNumber seq,ValueType type,const Slice& key,const Slice& value);
     bool Get(const LookupKey& key, std::string* value,Status* s);
 
+    //默认每个memtable 64KB，约5万个不同前缀时假阳率为1%
+    static const size_t kDefaultPrefixBloomBits = 512*1024;
+
 private:
     friend class MemTableIterator;
     friend class MemTableBackwardIterator;
+    static const size_t kPrefixBloomProbes = 6;
+
+    void AddPrefix(const Slice& user_key);
+    //internal_key的user key前缀可能在memtable中时返回true
+    bool PrefixMayMatch(const Slice& internal_key) const;
+
     struct KeyComparator{
         const InternalComparator comparator;
         explicit KeyComparator(const InternalComparator& c): comparator(c){}
@@ -50,11 +66,55 @@ private:
     int refs_;
     Arena arena_;
     Table table_;
+    const SliceTransform* prefix_extractor_;
+    //按64字节分块的前缀bloom filter，写入和读取可以并发，所以按原子的64位字访问
+    std::atomic<uint64_t>* prefix_bloom_;
+    size_t prefix_bloom_lines_;
 };
 
-MemTable::MemTable(const InternalKeyComparator& Comparator):comparator_(comparator),refs_(0),table_(comparator_,&arena_){}
+MemTable::MemTable(const InternalComparator& comparator,const SliceTransform* prefix_extractor,size_t prefix_bloom_bits)
+    :comparator_(comparator),refs_(0),table_(comparator_,&arena_),
+     prefix_extractor_(prefix_extractor),prefix_bloom_(nullptr),prefix_bloom_lines_(0){
+    if(prefix_extractor_!=nullptr){
+        prefix_bloom_lines_ = (prefix_bloom_bits + kCacheLineBits - 1)/kCacheLineBits;
+        if(prefix_bloom_lines_<1) prefix_bloom_lines_ = 1;
+        const size_t words = prefix_bloom_lines_*kCacheLineBytes/sizeof(uint64_t);
+        prefix_bloom_ = new std::atomic<uint64_t>[words];
+        for(size_t i=0;i<words;i++){
+            prefix_bloom_[i].store(0,std::memory_order_relaxed);
+        }
+    }
+}
+
+MemTable::~MemTable(){
+    assert(refs_==0);
+    delete[] prefix_bloom_;
+}
+
+void MemTable::AddPrefix(const Slice& user_key){
+    if(!prefix_extractor_->InDomain(user_key)) return;
+    const uint64_t hash = BloomHash(prefix_extractor_->Transform(user_key));
+    std::atomic<uint64_t>* line = prefix_bloom_ + CacheLineIndex(hash,prefix_bloom_lines_)*(kCacheLineBytes/sizeof(uint64_t));
+    const uint32_t h = static_cast<uint32_t>(hash);
+    for(size_t i=0;i<kPrefixBloomProbes;i++){
+        const uint32_t bitpos = CacheLineBitPos(h,i);
+        line[bitpos/64].fetch_or(uint64_t{1}<<(bitpos%64),std::memory_order_relaxed);
+    }
+}
 
-MemTable::~MemTable(){assert(refs_==0);}
+bool MemTable::PrefixMayMatch(const Slice& internal_key) const{
+    if(prefix_bloom_==nullptr) return true;
+    const Slice user_key = ExtractUserKey(internal_key);
+    if(!prefix_extractor_->InDomain(user_key)) return true;
+    const uint64_t hash = BloomHash(prefix_extractor_->Transform(user_key));
+    const std::atomic<uint64_t>* line = prefix_bloom_ + CacheLineIndex(hash,prefix_bloom_lines_)*(kCacheLineBytes/sizeof(uint64_t));
+    const uint32_t h = static_cast<uint32_t>(hash);
+    for(size_t i=0;i<kPrefixBloomProbes;i++){
+        const uint32_t bitpos = CacheLineBitPos(h,i);
+        if((line[bitpos/64].load(std::memory_order_relaxed) & (uint64_t{1}<<(bitpos%64)))==0) return false;
+    }
+    return true;
+}
 size_t MemTable::ApprosimateMemoryUsage(){return arena_.MemoryUsage();}
 
 int MemTable:: KeyComparator::operator()(const char* aptr,const char* bptr) const{
@@ -72,14 +132,19 @@ static const char* EncodeKey(std::string* scratch,const Slice& target){
 
 class MemTableIterator: public Iterator{
 public:
-    explicit MemTableIterator(MemTable::Table* table):iter_(table){}
+    explicit MemTableIterator(MemTable::Table* table):iter_(table),mem_(nullptr),filtered_(false){}
+    //mem不为空时Seek先检查前缀bloom filter
+    MemTableIterator(MemTable::Table* table,const MemTable* mem):iter_(table),mem_(mem),filtered_(false){}
     MemTableIterator(const MemTableIterator&) = delete;
     MemTableIterator& operator=(const MemTableIterator&)=delete;
     ~MemTableIterator() override=default;
-    bool Valid()const override { return iter_.Valid();}
-    void Seek(const Slice& k) override { iter_.Seek(EncodeKey(&tmp_,k));}
-    void SeekToFirst() override { iter_.SeekToFirst();}
-    void SeekToLast() override{ iter_.SeekToLast(); }
+    bool Valid()const override { return !filtered_ && iter_.Valid();}
+    void Seek(const Slice& k) override {
+        filtered_ = (mem_!=nullptr && !mem_->PrefixMayMatch(k));
+        if(!filtered_) iter_.Seek(EncodeKey(&tmp_,k));
+    }
+    void SeekToFirst() override { filtered_ = false; iter_.SeekToFirst();}
+    void SeekToLast() override{ filtered_ = false; iter_.SeekToLast(); }
     void Next()override { iter_.Next();}
     void Prev() override { iter_.Prev();}
     Slice key() const override { return GetLengthPrefixedSlice(iter_.key());}
@@ -91,10 +156,19 @@ public:
 private:
     MemTable::Table::Iterator iter_;
     std::string tmp_;
-}
+    const MemTable* mem_;
+    bool filtered_;//上一次Seek被前缀filter排除
+};
 
 Iterator* MemTable::NewIterator() {return new MemTableIterator(&table_);}
 
+Iterator* MemTable::NewIterator(const ReadOptions& options){
+    if(options.prefix_seek && prefix_bloom_!=nullptr){
+        return new MemTableIterator(&table_,this);
+    }
+    return new MemTableIterator(&table_);
+}
+
 /*
 * SkipList中的每个entry组成如下:
 key_size: internal_key.size() varint32
@@ -117,16 +191,23 @@ void MemTable::Add(SequenceNumber s,ValueType type,const Slice& key,const Slice&
     memcpy(p,value.data(),val_size);
     assert(p+val_size == buf+ encoded_len);
     table_.Insert(buf);
+    if(prefix_bloom_!=nullptr){
+        AddPrefix(key);
+    }
 
 }
 
 bool MemTable::Get(const LookupKey& key,std::string* value,Status* s){
     Slice memkey = key.memtable_key();
+    //前缀不在memtable中时key也不可能在
+    if(!PrefixMayMatch(key.internal_key())){
+        return false;
+    }
     Table::Iterator iter(&table_);
     iter.Seek(memkey.data());
     if(iter.Valid()){
         const char* entry = iter.key();
-        uint32_t key_length;
+        uint32_t key_length = 0;
         const char* key_ptr = GetVarint32Ptr(entry,entry+5,&key_length);
         if(comparator_.comparator.user_comparator()->Compare(
             Slice(key_ptr,key_length-8),key.user_key())==0){
@@ -144,8 +225,8 @@ bool MemTable::Get(const LookupKey& key,std::string* value,Status* s){
                 return true;
             }
         }
-        return false;
     }
+    return false;
 }
 
 
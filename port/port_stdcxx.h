@@ -28,11 +28,19 @@
 #if HAVE_SNAPPY
 #include <snappy.h>
 #endif  // HAVE_SNAPPY
+#if HAVE_LZ4
+#include <lz4.h>
+#endif  // HAVE_LZ4
+#if HAVE_ZSTD
+#include <zdict.h>
+#include <zstd.h>
+#endif  // HAVE_ZSTD
 
 #include <cassert>
 #include <condition_variable>  // NOLINT
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <mutex>  // NOLINT
 #include <string>
 
@@ -56,6 +64,7 @@ class LOCKABLE Mutex {
 
   void Lock() EXCLUSIVE_LOCK_FUNCTION() { mu_.lock(); }
   void Unlock() UNLOCK_FUNCTION() { mu_.unlock(); }
+  bool TryLock() EXCLUSIVE_TRYLOCK_FUNCTION(true) { return mu_.try_lock(); }
   void AssertHeld() ASSERT_EXCLUSIVE_LOCK() {}
 
  private:
@@ -137,6 +146,201 @@ inline bool Snappy_Uncompress(const char* input, size_t length, char* output) {
 #endif  // HAVE_SNAPPY
 }
 
+// Raw LZ4 blocks do not record their uncompressed length, so it is stored
+// as a 4-byte little-endian prefix.
+inline bool LZ4_Compress(const char* input, size_t length,
+                         std::string* output) {
+#if HAVE_LZ4
+  if (length > static_cast<size_t>(LZ4_MAX_INPUT_SIZE)) {
+    return false;
+  }
+  const int bound = LZ4_compressBound(static_cast<int>(length));
+  output->resize(4 + bound);
+  for (int i = 0; i < 4; i++) {
+    (*output)[i] = static_cast<char>((length >> (8 * i)) & 0xff);
+  }
+  const int outlen = LZ4_compress_default(input, &(*output)[4],
+                                          static_cast<int>(length), bound);
+  if (outlen <= 0) {
+    return false;
+  }
+  output->resize(4 + outlen);
+  return true;
+#else
+  // Silence compiler warnings about unused arguments.
+  (void)input;
+  (void)length;
+  (void)output;
+#endif  // HAVE_LZ4
+
+  return false;
+}
+
+inline bool LZ4_GetUncompressedLength(const char* input, size_t length,
+                                      size_t* result) {
+#if HAVE_LZ4
+  if (length < 4) {
+    return false;
+  }
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(input);
+  *result = static_cast<size_t>(p[0]) | (static_cast<size_t>(p[1]) << 8) |
+            (static_cast<size_t>(p[2]) << 16) |
+            (static_cast<size_t>(p[3]) << 24);
+  return true;
+#else
+  // Silence compiler warnings about unused arguments.
+  (void)input;
+  (void)length;
+  (void)result;
+  return false;
+#endif  // HAVE_LZ4
+}
+
+inline bool LZ4_Uncompress(const char* input, size_t length, char* output,
+                           size_t output_length) {
+#if HAVE_LZ4
+  if (length < 4) {
+    return false;
+  }
+  const int n = LZ4_decompress_safe(input + 4, output,
+                                    static_cast<int>(length - 4),
+                                    static_cast<int>(output_length));
+  return n >= 0 && static_cast<size_t>(n) == output_length;
+#else
+  // Silence compiler warnings about unused arguments.
+  (void)input;
+  (void)length;
+  (void)output;
+  (void)output_length;
+  return false;
+#endif  // HAVE_LZ4
+}
+
+#if HAVE_ZSTD
+// Compression and decompression contexts are reused per thread.
+struct ZstdContextDeleter {
+  void operator()(ZSTD_CCtx* ctx) const { ZSTD_freeCCtx(ctx); }
+  void operator()(ZSTD_DCtx* ctx) const { ZSTD_freeDCtx(ctx); }
+};
+
+inline ZSTD_CCtx* ThreadZstdCCtx() {
+  static thread_local std::unique_ptr<ZSTD_CCtx, ZstdContextDeleter> ctx(
+      ZSTD_createCCtx());
+  return ctx.get();
+}
+
+inline ZSTD_DCtx* ThreadZstdDCtx() {
+  static thread_local std::unique_ptr<ZSTD_DCtx, ZstdContextDeleter> ctx(
+      ZSTD_createDCtx());
+  return ctx.get();
+}
+#endif  // HAVE_ZSTD
+
+// dict may be empty. Frames record their uncompressed length.
+inline bool Zstd_Compress(int level, const char* input, size_t length,
+                          const char* dict, size_t dict_length,
+                          std::string* output) {
+#if HAVE_ZSTD
+  size_t outlen = ZSTD_compressBound(length);
+  if (ZSTD_isError(outlen)) {
+    return false;
+  }
+  output->resize(outlen);
+  ZSTD_CCtx* ctx = ThreadZstdCCtx();
+  if (dict_length > 0) {
+    outlen = ZSTD_compress_usingDict(ctx, &(*output)[0], outlen, input, length,
+                                     dict, dict_length, level);
+  } else {
+    outlen = ZSTD_compressCCtx(ctx, &(*output)[0], outlen, input, length,
+                               level);
+  }
+  if (ZSTD_isError(outlen)) {
+    return false;
+  }
+  output->resize(outlen);
+  return true;
+#else
+  // Silence compiler warnings about unused arguments.
+  (void)level;
+  (void)input;
+  (void)length;
+  (void)dict;
+  (void)dict_length;
+  (void)output;
+#endif  // HAVE_ZSTD
+
+  return false;
+}
+
+inline bool Zstd_GetUncompressedLength(const char* input, size_t length,
+                                       size_t* result) {
+#if HAVE_ZSTD
+  const unsigned long long size = ZSTD_getFrameContentSize(input, length);
+  if (size == ZSTD_CONTENTSIZE_UNKNOWN || size == ZSTD_CONTENTSIZE_ERROR) {
+    return false;
+  }
+  *result = static_cast<size_t>(size);
+  return true;
+#else
+  // Silence compiler warnings about unused arguments.
+  (void)input;
+  (void)length;
+  (void)result;
+  return false;
+#endif  // HAVE_ZSTD
+}
+
+inline bool Zstd_Uncompress(const char* input, size_t length,
+                            const char* dict, size_t dict_length,
+                            char* output, size_t output_length) {
+#if HAVE_ZSTD
+  ZSTD_DCtx* ctx = ThreadZstdDCtx();
+  size_t n;
+  if (dict_length > 0) {
+    n = ZSTD_decompress_usingDict(ctx, output, output_length, input, length,
+                                  dict, dict_length);
+  } else {
+    n = ZSTD_decompressDCtx(ctx, output, output_length, input, length);
+  }
+  return !ZSTD_isError(n) && n == output_length;
+#else
+  // Silence compiler warnings about unused arguments.
+  (void)input;
+  (void)length;
+  (void)dict;
+  (void)dict_length;
+  (void)output;
+  (void)output_length;
+  return false;
+#endif  // HAVE_ZSTD
+}
+
+// samples holds num_samples samples back to back, sample_lengths their sizes.
+inline bool Zstd_TrainDictionary(const char* samples,
+                                 const size_t* sample_lengths,
+                                 unsigned num_samples, size_t max_dict_length,
+                                 std::string* dict) {
+#if HAVE_ZSTD
+  dict->resize(max_dict_length);
+  const size_t n = ZDICT_trainFromBuffer(&(*dict)[0], max_dict_length, samples,
+                                         sample_lengths, num_samples);
+  if (ZDICT_isError(n)) {
+    dict->clear();
+    return false;
+  }
+  dict->resize(n);
+  return true;
+#else
+  // Silence compiler warnings about unused arguments.
+  (void)samples;
+  (void)sample_lengths;
+  (void)num_samples;
+  (void)max_dict_length;
+  (void)dict;
+  return false;
+#endif  // HAVE_ZSTD
+}
+
 inline bool GetHeapProfile(void (*func)(void*, const char*, int), void* arg) {
   // Silence compiler warnings about unused arguments.
   (void)func;
@@ -0,0 +1,223 @@
+#pragma once
+#include<stdint.h>
+#include<map>
+#include<string>
+#include "port/port.h"
+#include "util/coding.h"
+#include "util/crc32c.h"
+#include "util/env.h"
+#include "util/mutexlock.h"
+#include "util/options.h"
+#include "util/slice.h"
+#include "util/status.h"
+
+namespace leveldb{
+
+/**
+ * blob文件保存从sstable中分离出来的大value，只追加写入
+ * header: magic number(fixed64)
+ * record: crc(fixed32，value的crc32c的掩码) | value
+ * sstable中只保存指向record的BlobIndex: file_number | offset | size(均为varint64)，size为value的大小
+ *
+ * options.min_blob_size>0时生成的sstable中每个value前加一个类型字节(BlobValueType)，
+ * metaindex中记录"leveldb.blob.values"，读取时Table据此去掉类型字节并按需解析blob引用
+ */
+static const uint64_t kBlobFileMagicNumber = 0x62a1f3c9d00b1e5full;
+static const size_t kBlobFileHeaderSize = 8;
+static const size_t kBlobRecordHeaderSize = 4;
+
+enum BlobValueType:uint8_t{
+    kInlineValue = 0x0,//value直接保存在sstable中
+    kBlobReference = 0x1//value是BlobIndex的编码
+};
+
+struct BlobIndex{
+    uint64_t file_number = 0;
+    uint64_t offset = 0;//record在blob文件中的偏移
+    uint64_t size = 0;//value的大小
+    //record在blob文件中占用的字节数
+    uint64_t record_size() const { return kBlobRecordHeaderSize+size;}
+    void EncodeTo(std::string* dst) const{
+        PutVarint64(dst,file_number);
+        PutVarint64(dst,offset);
+        PutVarint64(dst,size);
+    }
+    Status DecodeFrom(Slice* input){
+        if(GetVarint64(input,&file_number) && GetVarint64(input,&offset) && GetVarint64(input,&size)){
+            return Status::OK();
+        }
+        return Status::Corruption("bad blob index");
+    }
+};
+
+//启用blob分离的sstable中value的编码
+inline void EncodeInlineValue(const Slice& value,std::string* dst){
+    dst->push_back(static_cast<char>(kInlineValue));
+    dst->append(value.data(),value.size());
+}
+
+inline void EncodeBlobReference(const BlobIndex& index,std::string* dst){
+    dst->push_back(static_cast<char>(kBlobReference));
+    index.EncodeTo(dst);
+}
+
+//解析sstable中带类型字节的value，直接保存的value写入*value，blob引用写入*index并设置*is_reference
+inline Status DecodeBlobValue(const Slice& encoded,Slice* value,BlobIndex* index,bool* is_reference){
+    if(encoded.empty()){
+        return Status::Corruption("missing blob value type");
+    }
+    Slice input(encoded.data()+1,encoded.size()-1);
+    switch(static_cast<uint8_t>(encoded[0])){
+    case kInlineValue:
+        *is_reference = false;
+        *value = input;
+        return Status::OK();
+    case kBlobReference:
+        *is_reference = true;
+        return index->DecodeFrom(&input);
+    default:
+        return Status::Corruption("bad blob value type");
+    }
+}
+
+//顺序写入一个blob文件，调用者负责同步和关闭file
+class BlobFileBuilder{
+public:
+    //不持有file
+    BlobFileBuilder(WritableFile* file,uint64_t file_number)
+        :file_(file),file_number_(file_number),offset_(0),num_blobs_(0){}
+    BlobFileBuilder(const BlobFileBuilder&) = delete;
+    BlobFileBuilder& operator=(const BlobFileBuilder&) = delete;
+
+    //追加value，成功时*index指向它
+    Status Add(const Slice& value,BlobIndex* index){
+        if(!status_.ok()) return status_;
+        if(offset_==0){
+            std::string header;
+            PutFixed64(&header,kBlobFileMagicNumber);
+            status_ = file_->Append(header);
+            if(!status_.ok()) return status_;
+            offset_ = header.size();
+        }
+        char buf[kBlobRecordHeaderSize];
+        EncodeFixed32(buf,crc32c::Mask(crc32c::Value(value.data(),value.size())));
+        status_ = file_->Append(Slice(buf,sizeof(buf)));
+        if(status_.ok()){
+            status_ = file_->Append(value);
+        }
+        if(status_.ok()){
+            index->file_number = file_number_;
+            index->offset = offset_;
+            index->size = value.size();
+            offset_ += kBlobRecordHeaderSize+value.size();
+            num_blobs_++;
+        }
+        return status_;
+    }
+    //把缓存的数据写入文件
+    Status Flush(){
+        if(status_.ok()){
+            status_ = file_->Flush();
+        }
+        return status_;
+    }
+    uint64_t file_number() const { return file_number_;}
+    uint64_t FileSize() const { return offset_;}
+    uint64_t NumBlobs() const { return num_blobs_;}
+    Status status() const { return status_;}
+private:
+    WritableFile* const file_;
+    const uint64_t file_number_;
+    uint64_t offset_;
+    uint64_t num_blobs_;
+    Status status_;
+};
+
+//按BlobIndex读取blob文件中的value，线程安全
+class BlobFileReader{
+public:
+    //不持有file
+    BlobFileReader(RandomAccessFile* file,uint64_t file_size):file_(file),file_size_(file_size){}
+
+    Status Get(const ReadOptions& options,const BlobIndex& index,std::string* value) const{
+        if(index.offset<kBlobFileHeaderSize || index.offset>file_size_ || index.record_size()>file_size_-index.offset){
+            return Status::Corruption("blob index out of range");
+        }
+        const size_t n = static_cast<size_t>(index.record_size());
+        value->resize(n);
+        Slice result;
+        Status s = file_->Read(index.offset,n,&result,&(*value)[0]);
+        if(!s.ok()){
+            return s;
+        }
+        if(result.size()!=n){
+            return Status::Corruption("truncated blob read");
+        }
+        if(options.verify_checksums){
+            const uint32_t crc = crc32c::Unmask(DecodeFixed32(result.data()));
+            if(crc32c::Value(result.data()+kBlobRecordHeaderSize,n-kBlobRecordHeaderSize)!=crc){
+                return Status::Corruption("blob checksum mismatch");
+            }
+        }
+        //零拷贝的文件返回的是文件自身的内存
+        if(result.data()!=value->data()){
+            value->assign(result.data()+kBlobRecordHeaderSize,n-kBlobRecordHeaderSize);
+        }else{
+            value->erase(0,kBlobRecordHeaderSize);
+        }
+        return Status::OK();
+    }
+    uint64_t file_size() const { return file_size_;}
+private:
+    RandomAccessFile* const file_;
+    const uint64_t file_size_;
+};
+
+//按file number找到已打开的blob文件，Table通过options.blob_source解析blob引用；线程安全
+class BlobSource{
+public:
+    BlobSource() = default;
+    BlobSource(const BlobSource&) = delete;
+    BlobSource& operator=(const BlobSource&) = delete;
+    ~BlobSource(){
+        for(std::map<uint64_t,BlobFileReader*>::iterator it=files_.begin();it!=files_.end();++it){
+            delete it->second;
+        }
+    }
+
+    //不持有file，file在RemoveFile之前必须一直有效
+    void AddFile(uint64_t file_number,RandomAccessFile* file,uint64_t file_size){
+        MutexLock l(&mutex_);
+        BlobFileReader*& reader = files_[file_number];
+        delete reader;
+        reader = new BlobFileReader(file,file_size);
+    }
+    //调用者保证没有正在进行的对该文件的读取
+    void RemoveFile(uint64_t file_number){
+        MutexLock l(&mutex_);
+        std::map<uint64_t,BlobFileReader*>::iterator it = files_.find(file_number);
+        if(it!=files_.end()){
+            delete it->second;
+            files_.erase(it);
+        }
+    }
+    Status Get(const ReadOptions& options,const BlobIndex& index,std::string* value) const{
+        const BlobFileReader* reader = nullptr;
+        {
+            MutexLock l(&mutex_);
+            std::map<uint64_t,BlobFileReader*>::const_iterator it = files_.find(index.file_number);
+            if(it!=files_.end()){
+                reader = it->second;
+            }
+        }
+        if(reader==nullptr){
+            return Status::NotFound("blob file not found");
+        }
+        return reader->Get(options,index,value);
+    }
+private:
+    mutable port::Mutex mutex_;
+    std::map<uint64_t,BlobFileReader*> files_;
+};
+
+} // namespace leveldb
@@ -0,0 +1,115 @@
+#pragma once
+#include<stdint.h>
+#include<map>
+#include<set>
+#include<vector>
+#include "table/blob_file.h"
+#include "table/table.h"
+#include "table/table_builder.h"
+
+namespace leveldb{
+
+/**
+ * blob文件的垃圾回收。blob文件只追加写入，table被重写或删除后其中的引用失效，对应的record成为垃圾:
+ * 1.CollectBlobReferences统计所有存活的table对每个blob文件的引用
+ * 2.PickBlobFilesForGC: 没有引用的blob文件可以直接删除，垃圾比例达到阈值的文件需要搬迁
+ * 3.重写引用了待搬迁文件的table(RewriteTableWithBlobs)，仍被引用的blob写入新的blob文件，
+ *   所有这样的table重写之后旧文件不再被引用，下一轮被选为可删除
+ */
+
+//一个blob文件中仍被引用的record
+struct BlobFileUsage{
+    uint64_t live_bytes = 0;
+    uint64_t live_blobs = 0;
+};
+
+//把table中的blob引用按file number累加到*usage
+Status CollectBlobReferences(Table* table,std::map<uint64_t,BlobFileUsage>* usage){
+    if(!table->HasBlobValues()){
+        return Status::OK();
+    }
+    ReadOptions options;
+    options.resolve_blobs = false;
+    options.fill_cache = false;
+    Iterator* iter = table->NewIterator(options);
+    Status s;
+    for(iter->SeekToFirst();s.ok() && iter->Valid();iter->Next()){
+        Slice value;
+        BlobIndex index;
+        bool is_reference = false;
+        s = DecodeBlobValue(iter->value(),&value,&index,&is_reference);
+        if(s.ok() && is_reference){
+            BlobFileUsage& u = (*usage)[index.file_number];
+            u.live_bytes += index.record_size();
+            u.live_blobs++;
+        }
+    }
+    if(s.ok()){
+        s = iter->status();
+    }
+    delete iter;
+    return s;
+}
+
+//file_sizes为所有blob文件的大小，usage为所有存活table的引用
+//没有引用的文件加入*obsolete；垃圾占record总量的比例不低于garbage_ratio的文件加入*relocate
+void PickBlobFilesForGC(const std::map<uint64_t,uint64_t>& file_sizes,const std::map<uint64_t,BlobFileUsage>& usage,
+                        double garbage_ratio,std::vector<uint64_t>* obsolete,std::set<uint64_t>* relocate){
+    for(std::map<uint64_t,uint64_t>::const_iterator it=file_sizes.begin();it!=file_sizes.end();++it){
+        std::map<uint64_t,BlobFileUsage>::const_iterator u = usage.find(it->first);
+        if(u==usage.end() || u->second.live_blobs==0){
+            obsolete->push_back(it->first);
+            continue;
+        }
+        const uint64_t total = it->second>kBlobFileHeaderSize ? it->second-kBlobFileHeaderSize : 0;
+        const uint64_t garbage = total>u->second.live_bytes ? total-u->second.live_bytes : 0;
+        if(total>0 && static_cast<double>(garbage)>=garbage_ratio*static_cast<double>(total)){
+            relocate->insert(it->first);
+        }
+    }
+}
+
+//把table的全部entry按顺序加入builder，调用者负责builder的Finish；builder的options.min_blob_size必须大于0
+//引用relocate中的文件的blob从source读出后重新Add，按builder的设置写入它的blob文件；其他引用原样保留
+Status RewriteTableWithBlobs(Table* table,const ReadOptions& read_options,const std::set<uint64_t>& relocate,
+                             BlobSource* source,TableBuilder* builder){
+    ReadOptions options = read_options;
+    options.resolve_blobs = false;
+    const bool blob_values = table->HasBlobValues();
+    Iterator* iter = table->NewIterator(options);
+    Status s;
+    std::string blob;
+    for(iter->SeekToFirst();s.ok() && iter->Valid();iter->Next()){
+        if(!blob_values){
+            builder->Add(iter->key(),iter->value());
+            s = builder->status();
+            continue;
+        }
+        Slice value;
+        BlobIndex index;
+        bool is_reference = false;
+        s = DecodeBlobValue(iter->value(),&value,&index,&is_reference);
+        if(!s.ok()){
+            break;
+        }
+        if(!is_reference){
+            builder->Add(iter->key(),value);
+        }else if(relocate.count(index.file_number)==0){
+            builder->AddBlobReference(iter->key(),index);
+        }else{
+            s = source->Get(options,index,&blob);
+            if(!s.ok()){
+                break;
+            }
+            builder->Add(iter->key(),blob);
+        }
+        s = builder->status();
+    }
+    if(s.ok()){
+        s = iter->status();
+    }
+    delete iter;
+    return s;
+}
+
+} // namespace leveldb
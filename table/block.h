@@ -1,52 +1,161 @@
 #pragma once
 #include<stddef.h>
 #include<stdint.h>
+#include<string.h>
+#include<algorithm>
+#include<atomic>
+#include<vector>
 #include "table/iterator.h"
 #include "util/coding.h"
 #include "util/comparator.h"
 #include"util/logging.h"
 #include "table/format.h"
+#include "table/data_block_hash_index.h"
+#include "util/cpu_features.h"
+#ifdef LEVELDB_HAVE_X86_TARGET_ATTRIBUTE
+#include<immintrin.h>
+#endif
 namespace leveldb
 {
-struct BlockContent;
+struct BlockContents;
 class Comparator;
+struct RestartKeyCache;
 
 class Block{
 public:
-    explicit Block(const BlockContent& contents);
+    explicit Block(const BlockContents& contents);
     Block(const Block&)=delete;
     Block& operator=(const Block&)=delete;
     ~Block();
     size_t size() const { return size_;}
-    Iterator* NewEmptyIterator(const Comparator* comparator);
+    //restart_key_cache为true时，第一次Seek建立重启点key的缓存，之后的Seek先比较缓存中的定长前缀
+    //缓存与block一起释放，只支持按字节序比较的comparator(BytewiseComparator，以及包装BytewiseComparator的InternalKeyComparator)
+    //prev_cache为false时Prev每次从重启点重新解析，不缓存解码的重启区间
+    Iterator* NewIterator(const Comparator* comparator,bool restart_key_cache=false,bool prev_cache=true);
+    bool HasHashIndex() const { return hash_index_!=nullptr;}
+    //读取时是否校验过checksum，放入block cache后要求校验的读取命中时据此跳过校验
+    bool checksum_verified() const { return checksum_verified_;}
+    //点查: iter必须由该block的NewIterator创建，定位到第一个不小于target的entry
+    //有hash索引时只扫描target的user key所在的重启区间，此时结果的user key可能与target不同，调用者需要比较；
+    //返回false表示block中没有target的user key不小于target的版本，iter无效
+    bool SeekForGet(Iterator* iter,const Slice& target) const;
 private:
     class Iter;
     uint32_t NumRestarts() const;
+    //返回重启点key的缓存，comparator不支持或block损坏时返回nullptr；多个线程可能同时建立，只保留一个
+    const RestartKeyCache* GetRestartKeyCache(const Comparator* comparator) const;
     const char* data_;//block数据指针
     size_t size_;//block数据大小
     uint32_t restart_offset_;//重启点数组的偏移位置
     bool owned_;//data_[]是否是Block拥有的
+    const bool checksum_verified_;
+    const char* hash_index_;//hash索引的buckets，没有时为nullptr
+    uint16_t num_buckets_;
+    mutable std::atomic<RestartKeyCache*> restart_key_cache_;
 };
 
+/**
+ * 重启点key的缓存: 重启点的entry shared==0，key在block中是连续的，只需要记录位置
+ * 同一个block中的key通常有很长的公共前缀，common_prefix为所有重启点key(InternalKeyComparator时为user key)的公共前缀，
+ * prefixes为去掉公共前缀后的前8字节按大端组成的整数，不足8字节补0，再翻转最高位，使有符号比较的结果与按字节比较一致；
+ * 前缀不同时不必比较完整的key
+ * valid为false表示不能使用缓存，避免重复建立
+ */
+struct RestartKeyCache{
+    bool valid;
+    bool internal_keys;
+    std::string common_prefix;
+    std::vector<int64_t> prefixes;
+    std::vector<uint32_t> key_offsets;
+    std::vector<uint32_t> key_sizes;
+};
+
+//按字节序比较时前缀的大小关系与key一致，前缀相等时需要比较完整的key
+static inline int64_t RestartKeyPrefix(const Slice& key){
+    const size_t n = std::min<size_t>(key.size(),8);
+    uint64_t v = 0;
+    for(size_t i=0;i<n;i++){
+        v |= static_cast<uint64_t>(static_cast<uint8_t>(key[i]))<<(56-8*i);
+    }
+    return static_cast<int64_t>(v ^ (1ull<<63));
+}
+
+//已排序的prefixes[0,n)中小于target的个数，即第一个不小于target的位置
+static inline uint32_t CountPrefixesLessScalar(const int64_t* prefixes,uint32_t n,int64_t target){
+    return static_cast<uint32_t>(std::lower_bound(prefixes,prefixes+n,target)-prefixes);
+}
+
+#ifdef LEVELDB_HAVE_X86_TARGET_ATTRIBUTE
+#define LEVELDB_HAVE_AVX2_RESTART_SEARCH 1
+//重启点不多时顺序比较比二分查找少了难以预测的分支，一次比较4个前缀
+__attribute__((target("avx2")))
+static uint32_t CountPrefixesLessAVX2(const int64_t* prefixes,uint32_t n,int64_t target){
+    const __m256i t = _mm256_set1_epi64x(target);
+    uint32_t i = 0;
+    for(;i+4<=n;i+=4){
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(prefixes+i));
+        const int mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(t,v)));
+        if(mask!=0xf){
+            return i + __builtin_popcount(mask);
+        }
+    }
+    for(;i<n && prefixes[i]<target;i++){}
+    return i;
+}
+#endif
+
+//超过这个数量的重启点用二分查找
+static const uint32_t kMaxLinearRestartSearch = 64;
+
+static inline uint32_t CountPrefixesLess(const int64_t* prefixes,uint32_t n,int64_t target){
+#ifdef LEVELDB_HAVE_AVX2_RESTART_SEARCH
+    if(n<=kMaxLinearRestartSearch && CpuHasAVX2()){
+        return CountPrefixesLessAVX2(prefixes,n,target);
+    }
+#endif
+    return CountPrefixesLessScalar(prefixes,n,target);
+}
+
 inline uint32_t Block::NumRestarts() const{
     assert(size_>= sizeof(uint32_t));
-    return DecodeFixed32(data_+size_-sizeof(uint32_t));//最后四字节存放的是重启点的数量
+    //最后四字节存放的是重启点的数量，最高位表示是否有hash索引
+    return DecodeFixed32(data_+size_-sizeof(uint32_t)) & ~kDataBlockHashIndexFlag;
 }
-Block::Block(const BlockContent& contents)
-    :data_(contents.data.data()),size_(contents.data.size()),owned_(contents.heap_allocated){
+Block::Block(const BlockContents& contents)
+    :data_(contents.data.data()),size_(contents.data.size()),owned_(contents.heap_allocated),
+     checksum_verified_(contents.checksum_verified),
+     hash_index_(nullptr),num_buckets_(0),restart_key_cache_(nullptr){
         if(size_ <sizeof(uint32_t)){
             size_ = 0;//该block_data块出错
-        }else{
-            //size_能允许的最大的重启点数量，一个重启点占4个字节。所以除以4
-            size_t max_restarts_allowed  =(size_-sizeof(uint32_t)) / sizeof(uint32_t);
-            if(NumRestarts()>max_restarts_allowed){
+            return;
+        }
+        size_t index_size = 0;
+        if(DecodeFixed32(data_+size_-sizeof(uint32_t)) & kDataBlockHashIndexFlag){
+            if(size_<sizeof(uint32_t)+sizeof(uint16_t)){
                 size_ = 0;
-            }else{
-                restart_offset_ = size_ - (1+NumRestarts())*sizeof(uint32_t);
+                return;
             }
+            const char* p = data_+size_-sizeof(uint32_t)-sizeof(uint16_t);
+            num_buckets_ = static_cast<uint8_t>(p[0]) | (static_cast<uint16_t>(static_cast<uint8_t>(p[1]))<<8);
+            index_size = num_buckets_ + sizeof(uint16_t);
+            if(num_buckets_==0 || size_<sizeof(uint32_t)+index_size){
+                size_ = 0;
+                return;
+            }
+            hash_index_ = p-num_buckets_;
+        }
+        //size_能允许的最大的重启点数量，一个重启点占4个字节。所以除以4
+        size_t max_restarts_allowed  =(size_-sizeof(uint32_t)-index_size) / sizeof(uint32_t);
+        if(NumRestarts()>max_restarts_allowed){
+            size_ = 0;
+            hash_index_ = nullptr;
+        }else{
+            if(NumRestarts()==0) hash_index_ = nullptr;
+            restart_offset_ = size_ - index_size - (1+NumRestarts())*sizeof(uint32_t);
         }
 }
 Block::~Block(){
+    delete restart_key_cache_.load(std::memory_order_relaxed);
     if(owned_){
         delete[] data_;
     }
@@ -70,6 +179,56 @@ static inline const char* DecodeEntry(const char*p,const char*limit,uint32_t* sh
     return p;
 }
 
+const RestartKeyCache* Block::GetRestartKeyCache(const Comparator* comparator) const{
+    RestartKeyCache* cache = restart_key_cache_.load(std::memory_order_acquire);
+    if(cache==nullptr){
+        cache = new RestartKeyCache;
+        cache->internal_keys = HashIndexUsesInternalKeys(comparator);
+        //InternalKeyComparator只有包装的user comparator按字节比较时，前缀的大小关系才与key一致
+        const Comparator* key_comparator = cache->internal_keys ? comparator->user_comparator() : comparator;
+        cache->valid = key_comparator!=nullptr && strcmp(key_comparator->Name(),"leveldb.BytewiseComparator")==0;
+        const uint32_t num_restarts = cache->valid ? NumRestarts() : 0;
+        const char* limit = data_+restart_offset_;
+        for(uint32_t i=0;i<num_restarts;i++){
+            const uint32_t offset = DecodeFixed32(data_+restart_offset_+i*sizeof(uint32_t));
+            uint32_t shared,non_shared,value_length;
+            const char* key_ptr = offset<restart_offset_ ? DecodeEntry(data_+offset,limit,&shared,&non_shared,&value_length) : nullptr;
+            if(key_ptr==nullptr || shared!=0 || (cache->internal_keys && non_shared<8)){
+                cache->valid = false;
+                break;
+            }
+            cache->key_offsets.push_back(static_cast<uint32_t>(key_ptr-data_));
+            cache->key_sizes.push_back(non_shared);
+        }
+        if(cache->valid && num_restarts>0){
+            //key有序，第一个和最后一个重启点key的公共前缀就是所有重启点key的公共前缀
+            const Slice first = HashIndexKey(Slice(data_+cache->key_offsets[0],cache->key_sizes[0]),cache->internal_keys);
+            const Slice last = HashIndexKey(Slice(data_+cache->key_offsets[num_restarts-1],cache->key_sizes[num_restarts-1]),
+                                            cache->internal_keys);
+            size_t n = 0;
+            while(n<first.size() && n<last.size() && first[n]==last[n]) n++;
+            cache->common_prefix.assign(first.data(),n);
+            for(uint32_t i=0;i<num_restarts;i++){
+                Slice key = HashIndexKey(Slice(data_+cache->key_offsets[i],cache->key_sizes[i]),cache->internal_keys);
+                key.remove_prefix(n);
+                cache->prefixes.push_back(RestartKeyPrefix(key));
+            }
+        }
+        if(!cache->valid){
+            cache->prefixes.clear();
+            cache->key_offsets.clear();
+            cache->key_sizes.clear();
+        }
+        RestartKeyCache* expected = nullptr;
+        if(!restart_key_cache_.compare_exchange_strong(expected,cache,std::memory_order_acq_rel)){
+            //其他线程已经建立
+            delete cache;
+            cache = expected;
+        }
+    }
+    return cache->valid ? cache : nullptr;
+}
+
 class Block::Iter:public Iterator{
 private:
     const Comparator* const comparator_;
@@ -78,9 +237,24 @@ private:
     uint32_t const num_restarts_;//重启点个数
     uint32_t current_;//当前entry在data_中的偏移，》=restarts_表示非法
     uint32_t restart_index_;//current_所在的重启点的index
-    std::string key_;
+    const Block* const block_;//不为空时使用block的重启点key缓存
+    const RestartKeyCache* restart_keys_;//第一次Seek时取得
+    Slice key_;//当前key，shared==0时直接指向block中的数据
+    std::string key_buf_;//shared>0时在这里拼接出完整的key
     Slice value_;
     Status status_;
+    //Prev时解码的一个重启区间中的entry，key保存在prev_keys_中
+    struct PrevEntry{
+        uint32_t offset;//entry在data_中的偏移
+        uint32_t key_offset;//key在prev_keys_中的偏移
+        uint32_t key_size;
+        uint32_t value_offset;//value在data_中的偏移
+        uint32_t value_size;
+    };
+    std::vector<PrevEntry> prev_entries_;
+    std::string prev_keys_;
+    uint32_t prev_restart_index_;//prev_entries_所在的重启区间
+    const bool prev_cache_;//为false时每次Prev都从重启点重新解析
     inline int Compare(const Slice& a,const Slice& b) const {
         return comparator_->Compare(a,b);
     }
@@ -103,14 +277,19 @@ private:
 
     }
 public:
-    Iter(const Comparator* comparator,const char* data,uint32_t restarts,uint32_t num_restarts):
+    Iter(const Comparator* comparator,const char* data,uint32_t restarts,uint32_t num_restarts,const Block* block,
+         bool prev_cache=true):
         comparator_(comparator),
         data_(data),
-        restarts_(restarts_),
+        restarts_(restarts),
         num_restarts_(num_restarts),
         current_(restarts_),
         //创建一个Block:;Iter之后，它是处于invalid的状态，即不能Prev也不能Next,需要先Seek/SeekToXX之后，才能调用next/prev;
-        restart_index_(num_restarts_-1){
+        restart_index_(num_restarts_-1),
+        block_(block),
+        restart_keys_(nullptr),
+        prev_restart_index_(num_restarts),
+        prev_cache_(prev_cache){
          assert(num_restarts_>0);
     }
     bool Valid() const override{ return current_ < restarts_;}
@@ -130,22 +309,30 @@ public:
     }
     void Prev() override{
         assert(Valid());
-        const uint32_t original = current_;
-        while(GetRestartPoint(restart_index_)>=original){
-            if(restart_index_==0){//不存在前一个实体
-                current_ = restarts_;
-                restart_index_ = num_restarts_;
+        //当前entry在已解码的重启区间中且不是区间中的第一个时直接取前一个
+        if(!prev_cache_){
+            PrevFromRestartPoint();
+            return;
+        }
+        size_t i = FindPrevEntry(current_);
+        if(i==0 || i==prev_entries_.size()){
+            if(!FillPrevEntries()){
                 return;
             }
-            restart_index_--;
+            i = prev_entries_.size();
         }
-        SeekToRestartPoint(restart_index_);
-        do{
-
-        }while(ParseNextKey()&& NextEntryOffset()<original);
+        SetPrevEntry(i-1);
     }
 
     void Seek(const Slice& target) override{
+        if(block_!=nullptr && restart_keys_==nullptr){
+            restart_keys_ = block_->GetRestartKeyCache(comparator_);
+        }
+        if(restart_keys_!=nullptr){
+            SeekToRestartPoint(FindRestartPoint(target));
+            while(ParseNextKey() && Compare(key_,target)<0){}
+            return;
+        }
         uint32_t left=0;
         uint32_t right = num_restarts_-1;
         while(left<right){
@@ -174,6 +361,39 @@ public:
             }
         }
     }
+    //buckets为block的hash索引
+    bool SeekForGet(const Slice& target,const char* buckets,uint16_t num_buckets){
+        const Slice key = HashIndexKey(target,HashIndexUsesInternalKeys(comparator_));
+        const uint8_t entry = DataBlockHashIndexLookup(buckets,num_buckets,key);
+        if(entry==kHashIndexNoEntry){
+            current_ = restarts_;
+            restart_index_ = num_restarts_;
+            key_.clear();
+            value_.clear();
+            return false;
+        }
+        if(entry==kHashIndexCollision || entry>=num_restarts_){
+            Seek(target);
+            return true;
+        }
+        //key存在时所有版本都在这个重启区间中，扫描到区间之外说明没有不小于target的版本
+        SeekToRestartPoint(entry);
+        while(ParseNextKey()){
+            if(restart_index_!=entry){
+                break;
+            }
+            if(Compare(key_,target)>=0){
+                return true;
+            }
+        }
+        if(status_.ok()){
+            current_ = restarts_;
+            restart_index_ = num_restarts_;
+            key_.clear();
+            value_.clear();
+        }
+        return false;
+    }
     void SeekToFirst()override{
         SeekToRestartPoint(0);
         ParseNextKey();
@@ -187,6 +407,112 @@ public:
 
 
 private:
+    //用重启点key缓存找到最后一个key小于target的重启点，没有时返回0，与二分查找的结果相同
+    uint32_t FindRestartPoint(const Slice& target) const{
+        const RestartKeyCache* cache = restart_keys_;
+        Slice key = HashIndexKey(target,cache->internal_keys);
+        //公共前缀不同时target小于或大于所有重启点key
+        const Slice common(cache->common_prefix);
+        const int r = memcmp(key.data(),common.data(),std::min(key.size(),common.size()));
+        if(r<0 || (r==0 && key.size()<common.size())){
+            return 0;
+        }else if(r>0){
+            return num_restarts_-1;
+        }
+        key.remove_prefix(common.size());
+        const int64_t prefix = RestartKeyPrefix(key);
+        //前缀更小的重启点key一定小于target，前缀更大的一定大于target
+        const int64_t* prefixes = cache->prefixes.data();
+        uint32_t lo = CountPrefixesLess(prefixes,num_restarts_,prefix);
+        uint32_t hi = lo;
+        if(hi<num_restarts_ && prefixes[hi]==prefix){
+            hi = static_cast<uint32_t>(std::upper_bound(prefixes+hi,prefixes+num_restarts_,prefix)-prefixes);
+        }
+        //前缀相同的重启点比较完整的key，找到第一个不小于target的重启点
+        while(lo<hi){
+            const uint32_t mid = lo+(hi-lo)/2;
+            if(Compare(Slice(data_+cache->key_offsets[mid],cache->key_sizes[mid]),target)<0){
+                lo = mid+1;
+            }else{
+                hi = mid;
+            }
+        }
+        return lo>0 ? lo-1 : 0;
+    }
+    //从前一个entry所在区间的重启点开始解析到它，不缓存
+    void PrevFromRestartPoint(){
+        const uint32_t original = current_;
+        while(GetRestartPoint(restart_index_)>=original){
+            if(restart_index_==0){//不存在前一个实体
+                current_ = restarts_;
+                restart_index_ = num_restarts_;
+                return;
+            }
+            restart_index_--;
+        }
+        SeekToRestartPoint(restart_index_);
+        while(ParseNextKey() && NextEntryOffset()<original){}
+    }
+    //返回offset处的entry在prev_entries_中的下标，不在其中时返回prev_entries_.size()
+    size_t FindPrevEntry(uint32_t offset) const{
+        if(prev_entries_.empty() || restart_index_!=prev_restart_index_){
+            return prev_entries_.size();
+        }
+        auto it = std::lower_bound(prev_entries_.begin(),prev_entries_.end(),offset,
+                                   [](const PrevEntry& e,uint32_t o){ return e.offset<o;});
+        if(it==prev_entries_.end() || it->offset!=offset){
+            return prev_entries_.size();
+        }
+        return it-prev_entries_.begin();
+    }
+    //解码current_的前一个entry所在的重启区间中位于current_之前的所有entry，
+    //之后在这个区间中的Prev不必再从重启点开始解析
+    bool FillPrevEntries(){
+        const uint32_t original = current_;
+        while(GetRestartPoint(restart_index_)>=original){
+            if(restart_index_==0){//不存在前一个实体
+                current_ = restarts_;
+                restart_index_ = num_restarts_;
+                return false;
+            }
+            restart_index_--;
+        }
+        prev_entries_.clear();
+        prev_keys_.clear();
+        prev_restart_index_ = restart_index_;
+        const char* limit = data_+restarts_;
+        uint32_t offset = GetRestartPoint(restart_index_);
+        while(offset<original){
+            uint32_t shared,non_shared,value_length;
+            const char* p = DecodeEntry(data_+offset,limit,&shared,&non_shared,&value_length);
+            if(p==nullptr || (prev_entries_.empty() ? 0 : prev_entries_.back().key_size)<shared){
+                prev_entries_.clear();
+                CorruptionError();
+                return false;
+            }
+            PrevEntry entry;
+            entry.offset = offset;
+            entry.key_offset = static_cast<uint32_t>(prev_keys_.size());
+            entry.key_size = shared+non_shared;
+            entry.value_offset = static_cast<uint32_t>((p+non_shared)-data_);
+            entry.value_size = value_length;
+            prev_keys_.resize(entry.key_offset+entry.key_size);
+            if(shared>0){
+                memcpy(&prev_keys_[entry.key_offset],&prev_keys_[prev_entries_.back().key_offset],shared);
+            }
+            memcpy(&prev_keys_[entry.key_offset+shared],p,non_shared);
+            prev_entries_.push_back(entry);
+            offset = entry.value_offset+value_length;
+        }
+        return true;
+    }
+    void SetPrevEntry(size_t i){
+        const PrevEntry& entry = prev_entries_[i];
+        current_ = entry.offset;
+        restart_index_ = prev_restart_index_;
+        key_ = Slice(prev_keys_.data()+entry.key_offset,entry.key_size);
+        value_ = Slice(data_+entry.value_offset,entry.value_size);
+    }
     void CorruptionError(){
         current_ = restarts_;
         restart_index_ = num_restarts_;
@@ -212,8 +538,18 @@ private:
             CorruptionError();
             return false;
         }else{
-            key_.resize(shared);
-            key_.append(p,non_shared);
+            if(shared==0){
+                //重启点等完整存储的key不必拷贝
+                key_ = Slice(p,non_shared);
+            }else{
+                if(key_.data()!=key_buf_.data()){
+                    key_buf_.assign(key_.data(),shared);
+                }else{
+                    key_buf_.resize(shared);
+                }
+                key_buf_.append(p,non_shared);
+                key_ = Slice(key_buf_);
+            }
             value_ = Slice(p+non_shared,value_length);
             while(restart_index_+1<num_restarts_ && GetRestartPoint(restart_index_+1)<current_){
                 ++ restart_index_;
@@ -223,7 +559,16 @@ private:
     }
 };
 
-Iterator* Block::NewEmptyIterator(const Comparator* comparator){
+bool Block::SeekForGet(Iterator* iter,const Slice& target) const{
+    if(hash_index_==nullptr){
+        iter->Seek(target);
+        return true;
+    }
+    //有hash索引时重启点数量一定大于0，iter是Block::Iter
+    return static_cast<Iter*>(iter)->SeekForGet(target,hash_index_,num_buckets_);
+}
+
+Iterator* Block::NewIterator(const Comparator* comparator,bool restart_key_cache,bool prev_cache){
     if(size_ < sizeof(uint32_t)){
         return NewErrorIterator(Status::Corruption("bad block contents"));
     }
@@ -231,7 +576,7 @@ Iterator* Block::NewEmptyIterator(const Comparator* comparator){
     if(num_restarts==0){
         return NewEmptyIterator();
     }else{
-        return new Iter(comparator,data_,restart_offset_,num_restarts);
+        return new Iter(comparator,data_,restart_offset_,num_restarts,restart_key_cache ? this : nullptr,prev_cache);
     }
 }
 } // namespace leveldb
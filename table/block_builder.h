@@ -5,12 +5,14 @@
 #include "util/comparator.h"
 #include "util/options.h"
 #include "util/coding.h"
+#include "table/data_block_hash_index.h"
 #include <algorithm>
 namespace leveldb
 {
 
 struct Options;
 //构建Block_data数据块，一个Block_data块包括kv数据，重启点数组，重启点数量
+//options->data_block_hash_index时在重启点数组之后追加hash索引，格式见data_block_hash_index.h
 class BlockBuilder{
 public:
     explicit BlockBuilder(const Options* options);
@@ -29,10 +31,16 @@ private:
     int counter_;
     bool finished_;
     std::string last_key_;//记录最后添加的key
+    bool use_hash_index_;
+    bool internal_keys_;//按user key建立hash索引
+    DataBlockHashIndexBuilder hash_index_builder_;
 };
 
 BlockBuilder::BlockBuilder(const Options* options)
-    : options_(options),restarts_(),counter_(0),finished_(false){
+    : options_(options),restarts_(),counter_(0),finished_(false),
+      use_hash_index_(options->data_block_hash_index),
+      internal_keys_(HashIndexUsesInternalKeys(options->comparator)),
+      hash_index_builder_(options->data_block_hash_table_util_ratio){
         assert(options->block_restart_interval>=1);
         restarts_.push_back(0);
 }
@@ -44,9 +52,15 @@ void BlockBuilder::Reset(){
     counter_ = 0;
     finished_ = false;
     last_key_.clear();
+    use_hash_index_ = options_->data_block_hash_index;
+    hash_index_builder_.Reset();
 }
 size_t BlockBuilder::CurrentSizeEstimate() const {
-    return (buffer_.size() + restarts_.size()*sizeof(uint32_t)+sizeof(uint32_t));
+    size_t estimate = buffer_.size() + restarts_.size()*sizeof(uint32_t)+sizeof(uint32_t);
+    if(use_hash_index_){
+        estimate += hash_index_builder_.EstimateSize();
+    }
+    return estimate;
 }
 
 //调用该函数完成Block_data构建
@@ -55,8 +69,13 @@ Slice BlockBuilder::Finish(){
     for(size_t i=0;i<restarts_.size();i++){
         PutFixed32(&buffer_,restarts_[i]);
     }
-    //加入重启点个数
-    PutFixed32(&buffer_,restarts_.size());
+    //加入hash索引和重启点个数
+    if(use_hash_index_ && hash_index_builder_.Valid()){
+        hash_index_builder_.Finish(&buffer_);
+        PutFixed32(&buffer_,restarts_.size() | kDataBlockHashIndexFlag);
+    }else{
+        PutFixed32(&buffer_,restarts_.size());
+    }
     finished_ = true;
     return Slice(buffer_);
 }
@@ -86,6 +105,9 @@ void BlockBuilder::Add(const Slice&key,const Slice&value){
     last_key_.resize(shared);
     last_key_.append(key.data()+shared,non_shared);
     assert(Slice(last_key_)==key);
+    if(use_hash_index_){
+        hash_index_builder_.Add(HashIndexKey(key,internal_keys_),restarts_.size()-1);
+    }
     counter_++;
 
 
@@ -0,0 +1,167 @@
+#pragma once
+#include<stdint.h>
+#include<atomic>
+#include<map>
+#include<string>
+#include<vector>
+#include "table/table.h"
+#include "util/cache.h"
+#include "util/coding.h"
+#include "util/crc32c.h"
+#include "util/env.h"
+#include "util/rate_limiter.h"
+#include "util/status.h"
+#include "util/thread_pool.h"
+
+namespace leveldb{
+
+/**
+ * block cache索引文件，记录cache中驻留的data block，重启后据此预热cache
+ * 格式:
+ * magic(fixed64) | count(varint64) | {file_number(varint64),block_offset(varint64)} * count | crc(fixed32)
+ * 条目按照LRU顺序排列，最久未使用的在前，crc覆盖magic之后到crc之前的内容
+ * cache_id是进程内分配的，重启后失效，所以文件中保存的是sstable的文件编号
+ */
+static const uint64_t kCacheIndexMagicNumber = 0x7c3a5e9b1d2f4860ull;
+
+struct CachedBlockRef{
+    uint64_t file_number;
+    uint64_t offset;
+};
+
+//把block_cache中驻留的data block按LRU顺序编码到*dst中
+//cache_id_to_file为Table::CacheId()到sstable文件编号的映射，不在映射中的key(不属于任何table)被忽略
+void EncodeBlockCacheIndex(const Cache* cache,const std::map<uint64_t,uint64_t>& cache_id_to_file,std::string* dst){
+    std::vector<std::string> keys;
+    cache->GetResidentKeys(&keys);
+    std::string body;
+    uint64_t count = 0;
+    for(size_t i=0;i<keys.size();i++){
+        //Table::BlockReader使用的cache key为16字节: cache_id(fixed64) + offset(fixed64)
+        if(keys[i].size()!=16) continue;
+        std::map<uint64_t,uint64_t>::const_iterator it = cache_id_to_file.find(DecodeFixed64(keys[i].data()));
+        if(it==cache_id_to_file.end()) continue;
+        PutVarint64(&body,it->second);
+        PutVarint64(&body,DecodeFixed64(keys[i].data()+8));
+        count++;
+    }
+    dst->clear();
+    PutFixed64(dst,kCacheIndexMagicNumber);
+    const size_t crc_start = dst->size();
+    PutVarint64(dst,count);
+    dst->append(body);
+    PutFixed32(dst,crc32c::Mask(crc32c::Value(dst->data()+crc_start,dst->size()-crc_start)));
+}
+
+//关闭时或者周期性地调用，开销是遍历一次cache中的key
+Status DumpBlockCacheIndex(const Cache* cache,const std::map<uint64_t,uint64_t>& cache_id_to_file,WritableFile* file){
+    std::string contents;
+    EncodeBlockCacheIndex(cache,cache_id_to_file,&contents);
+    Status s = file->Append(contents);
+    if(s.ok()){
+        s = file->Sync();
+    }
+    if(s.ok()){
+        s = file->Close();
+    }
+    return s;
+}
+
+Status ParseBlockCacheIndex(const Slice& contents,std::vector<CachedBlockRef>* refs){
+    refs->clear();
+    if(contents.size()<12 || DecodeFixed64(contents.data())!=kCacheIndexMagicNumber){
+        return Status::Corruption("bad block cache index magic");
+    }
+    Slice body(contents.data()+8,contents.size()-12);
+    const uint32_t crc = crc32c::Unmask(DecodeFixed32(contents.data()+contents.size()-4));
+    if(crc32c::Value(body.data(),body.size())!=crc){
+        return Status::Corruption("block cache index checksum mismatch");
+    }
+    uint64_t count;
+    if(!GetVarint64(&body,&count)){
+        return Status::Corruption("bad block cache index count");
+    }
+    for(uint64_t i=0;i<count;i++){
+        CachedBlockRef ref;
+        if(!GetVarint64(&body,&ref.file_number) || !GetVarint64(&body,&ref.offset)){
+            refs->clear();
+            return Status::Corruption("truncated block cache index");
+        }
+        refs->push_back(ref);
+    }
+    return Status::OK();
+}
+
+//在后台线程中按照索引文件把block重新读入cache，总I/O速率受bytes_per_second限制
+//用法: AddTable注册已打开的table -> Start -> (可以同时对外服务) -> Wait
+class BlockCacheWarmer{
+public:
+    BlockCacheWarmer(int num_threads,uint64_t bytes_per_second)
+        :limiter_(bytes_per_second),blocks_requested_(0),errors_(0),pool_(num_threads){}
+    BlockCacheWarmer(const BlockCacheWarmer&) = delete;
+    BlockCacheWarmer& operator=(const BlockCacheWarmer&) = delete;
+    ~BlockCacheWarmer(){ Wait();}
+
+    //table在预热完成之前必须保持打开
+    void AddTable(uint64_t file_number,Table* table){ tables_[file_number] = table;}
+
+    //refs按LRU顺序排列，从最热的一端开始预取，每个任务最多处理kBlocksPerTask个block
+    //可以在Wait之前多次调用，每次只调度本次新建的任务
+    void Start(const std::vector<CachedBlockRef>& refs){
+        std::vector<Task*> tasks;
+        Task* task = nullptr;
+        for(size_t i=refs.size();i>0;i--){
+            const CachedBlockRef& ref = refs[i-1];
+            std::map<uint64_t,Table*>::const_iterator it = tables_.find(ref.file_number);
+            if(it==tables_.end()) continue;//该文件已经被删除
+            if(task==nullptr || task->table!=it->second || task->offsets.size()>=kBlocksPerTask){
+                task = new Task;
+                task->warmer = this;
+                task->table = it->second;
+                tasks.push_back(task);
+            }
+            task->offsets.push_back(ref.offset);
+        }
+        for(size_t i=0;i<tasks.size();i++){
+            pool_.Schedule(&BlockCacheWarmer::RunTask,tasks[i]);
+        }
+        tasks_.insert(tasks_.end(),tasks.begin(),tasks.end());
+    }
+
+    void Wait(){
+        pool_.WaitForIdle();
+        for(size_t i=0;i<tasks_.size();i++){
+            delete tasks_[i];
+        }
+        tasks_.clear();
+    }
+
+    uint64_t BlocksRequested() const { return blocks_requested_.load(std::memory_order_relaxed);}
+    uint64_t Errors() const { return errors_.load(std::memory_order_relaxed);}
+
+private:
+    static const size_t kBlocksPerTask = 64;
+    struct Task{
+        BlockCacheWarmer* warmer;
+        Table* table;
+        std::vector<uint64_t> offsets;
+    };
+    static void RunTask(void* arg){
+        Task* task = reinterpret_cast<Task*>(arg);
+        BlockCacheWarmer* warmer = task->warmer;
+        Status s = task->table->PrefetchBlocks(task->offsets,&warmer->limiter_);
+        warmer->blocks_requested_.fetch_add(task->offsets.size(),std::memory_order_relaxed);
+        if(!s.ok()){
+            warmer->errors_.fetch_add(1,std::memory_order_relaxed);
+        }
+    }
+
+    RateLimiter limiter_;
+    std::map<uint64_t,Table*> tables_;
+    std::vector<Task*> tasks_;
+    std::atomic<uint64_t> blocks_requested_;
+    std::atomic<uint64_t> errors_;
+    ThreadPool pool_;//最后声明，析构时先等待线程退出
+};
+
+} // namespace leveldb
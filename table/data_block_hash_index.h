@@ -0,0 +1,105 @@
+#pragma once
+#include<stdint.h>
+#include<string.h>
+#include<string>
+#include<utility>
+#include<vector>
+#include "util/coding.h"
+#include "util/comparator.h"
+#include "util/hash.h"
+#include "util/slice.h"
+
+namespace leveldb{
+
+/**
+ * data block的hash索引，由BlockBuilder追加在重启点数组之后:
+ *   restarts[num_restarts](fixed32) | buckets[num_buckets](uint8) | num_buckets(fixed16) | num_restarts|kDataBlockHashIndexFlag(fixed32)
+ * bucket中保存hash到该bucket的user key所在的重启区间下标，
+ * kHashIndexNoEntry表示block中没有这样的user key，kHashIndexCollision表示多个重启区间落到同一个bucket
+ * 最后4字节的最高位为0的block没有hash索引，按原来的格式读取
+ */
+static const uint32_t kDataBlockHashIndexFlag = 1u<<31;
+static const uint8_t kHashIndexNoEntry = 255;
+static const uint8_t kHashIndexCollision = 254;
+//重启区间下标必须小于kHashIndexCollision，重启点更多的block不建立hash索引
+static const uint32_t kMaxHashIndexRestarts = kHashIndexCollision;
+static const uint32_t kHashIndexSeed = 0x5bd1e995;
+
+//sstable中的key是internal key时按user key建立索引，同一个user key的多个版本落在同一个bucket
+inline bool HashIndexUsesInternalKeys(const Comparator* comparator){
+    return comparator!=nullptr && strcmp(comparator->Name(),"leveldb.InternalKeyComparator")==0;
+}
+
+inline Slice HashIndexKey(const Slice& key,bool internal_keys){
+    if(internal_keys && key.size()>=8){
+        return Slice(key.data(),key.size()-8);
+    }
+    return key;
+}
+
+inline uint8_t DataBlockHashIndexLookup(const char* buckets,uint16_t num_buckets,const Slice& key){
+    const uint32_t h = Hash(key.data(),key.size(),kHashIndexSeed);
+    return static_cast<uint8_t>(buckets[h%num_buckets]);
+}
+
+class DataBlockHashIndexBuilder{
+public:
+    //util_ratio为key数与bucket数之比，越小冲突越少，占用的空间越大
+    explicit DataBlockHashIndexBuilder(double util_ratio):util_ratio_(util_ratio>0 ? util_ratio : 0.75),valid_(true){}
+
+    void Add(const Slice& key,uint32_t restart_index){
+        if(restart_index>=kMaxHashIndexRestarts){
+            valid_ = false;
+            return;
+        }
+        const uint32_t h = Hash(key.data(),key.size(),kHashIndexSeed);
+        //同一个user key的连续多个版本只记录一次
+        if(!entries_.empty() && entries_.back().first==h && entries_.back().second==restart_index){
+            return;
+        }
+        entries_.push_back(std::make_pair(h,static_cast<uint8_t>(restart_index)));
+    }
+    //重启点过多时不能建立索引
+    bool Valid() const { return valid_ && !entries_.empty();}
+    size_t EstimateSize() const{
+        return valid_ ? NumBuckets()+sizeof(uint16_t) : 0;
+    }
+    //在buffer末尾追加buckets和num_buckets
+    void Finish(std::string* buffer) const{
+        const uint16_t num_buckets = NumBuckets();
+        const size_t start = buffer->size();
+        buffer->append(num_buckets,static_cast<char>(kHashIndexNoEntry));
+        char* buckets = &(*buffer)[start];
+        for(size_t i=0;i<entries_.size();i++){
+            char* bucket = &buckets[entries_[i].first%num_buckets];
+            const uint8_t current = static_cast<uint8_t>(*bucket);
+            if(current==kHashIndexNoEntry){
+                *bucket = static_cast<char>(entries_[i].second);
+            }else if(current!=entries_[i].second){
+                *bucket = static_cast<char>(kHashIndexCollision);
+            }
+        }
+        char num_buf[sizeof(uint16_t)];
+        num_buf[0] = static_cast<char>(num_buckets & 0xff);
+        num_buf[1] = static_cast<char>(num_buckets >> 8);
+        buffer->append(num_buf,sizeof(num_buf));
+    }
+    void Reset(){
+        entries_.clear();
+        valid_ = true;
+    }
+
+private:
+    uint16_t NumBuckets() const{
+        size_t n = static_cast<size_t>(entries_.size()/util_ratio_);
+        if(n>0xffff) n = 0xffff;
+        //奇数个bucket使hash的低位分布更均匀
+        return static_cast<uint16_t>(n | 1);
+    }
+
+    double util_ratio_;
+    bool valid_;
+    std::vector<std::pair<uint32_t,uint8_t>> entries_;//(hash,重启区间下标)
+};
+
+} // namespace leveldb
@@ -0,0 +1,254 @@
+#pragma once
+#include<stddef.h>
+#include<stdint.h>
+#include<string>
+#include<vector>
+#include "util/coding.h"
+#include "util/filter_policy.h"
+#include "util/slice.h"
+#include "util/slice_transform.h"
+
+namespace leveldb{
+
+//每2KB的data block偏移生成一个filter
+static const size_t kFilterBaseLg = 11;
+static const size_t kFilterBase = 1<<kFilterBaseLg;
+
+/**
+ * filter block在sstable中只有一个，格式:
+ * filter 0 | filter 1 | ... | filter n-1 |
+ * offset of filter 0(fixed32) | ... | offset of filter n-1(fixed32) |
+ * offset of filter offset array(fixed32) | base_lg(1字节)
+ * 第i个filter覆盖偏移在[i*base,(i+1)*base)中的data block
+ *
+ * 调用顺序: (StartBlock AddKey*)* Finish
+ */
+class FilterBlockBuilder{
+public:
+    //prefix_extractor不为空时key的前缀也加入filter
+    explicit FilterBlockBuilder(const FilterPolicy* policy,const SliceTransform* prefix_extractor = nullptr)
+        :policy_(policy),prefix_extractor_(prefix_extractor),has_last_prefix_(false){}
+    FilterBlockBuilder(const FilterBlockBuilder&) = delete;
+    FilterBlockBuilder& operator=(const FilterBlockBuilder&) = delete;
+
+    //开始一个新的data block，block_offset为其在sstable中的偏移
+    void StartBlock(uint64_t block_offset);
+    void AddKey(const Slice& key);
+    Slice Finish();
+
+private:
+    void GenerateFilter();
+    void AddPrefix(const Slice& key);
+
+    const FilterPolicy* policy_;
+    const SliceTransform* prefix_extractor_;
+    std::string last_prefix_;//同一个filter中连续相同的前缀只加入一次
+    bool has_last_prefix_;
+    std::string keys_;//展开存放的key
+    std::vector<size_t> start_;//每个key在keys_中的起始位置
+    std::string result_;//已经生成的filter
+    std::vector<Slice> tmp_keys_;//GenerateFilter中传给policy的key
+    std::vector<uint32_t> filter_offsets_;//每个filter在result_中的偏移
+};
+
+void FilterBlockBuilder::StartBlock(uint64_t block_offset){
+    uint64_t filter_index = (block_offset / kFilterBase);
+    assert(filter_index >= filter_offsets_.size());
+    //一个大的data block可能跨过多个filter的范围，中间的filter为空
+    while(filter_index > filter_offsets_.size()){
+        GenerateFilter();
+    }
+}
+
+void FilterBlockBuilder::AddKey(const Slice& key){
+    Slice k = key;
+    start_.push_back(keys_.size());
+    keys_.append(k.data(),k.size());
+    if(prefix_extractor_!=nullptr){
+        AddPrefix(key);
+    }
+}
+
+void FilterBlockBuilder::AddPrefix(const Slice& key){
+    if(!prefix_extractor_->InDomain(key)) return;
+    Slice prefix = prefix_extractor_->Transform(key);
+    if(has_last_prefix_ && prefix==Slice(last_prefix_)) return;
+    start_.push_back(keys_.size());
+    keys_.append(prefix.data(),prefix.size());
+    last_prefix_.assign(prefix.data(),prefix.size());
+    has_last_prefix_ = true;
+}
+
+Slice FilterBlockBuilder::Finish(){
+    if(!start_.empty()){
+        GenerateFilter();
+    }
+    const uint32_t array_offset = result_.size();
+    for(size_t i=0;i<filter_offsets_.size();i++){
+        PutFixed32(&result_,filter_offsets_[i]);
+    }
+    PutFixed32(&result_,array_offset);
+    result_.push_back(kFilterBaseLg);
+    return Slice(result_);
+}
+
+void FilterBlockBuilder::GenerateFilter(){
+    const size_t num_keys = start_.size();
+    if(num_keys==0){
+        //空filter
+        filter_offsets_.push_back(result_.size());
+        return;
+    }
+    start_.push_back(keys_.size());//方便计算最后一个key的长度
+    tmp_keys_.resize(num_keys);
+    for(size_t i=0;i<num_keys;i++){
+        const char* base = keys_.data() + start_[i];
+        size_t length = start_[i+1] - start_[i];
+        tmp_keys_[i] = Slice(base,length);
+    }
+    filter_offsets_.push_back(result_.size());
+    policy_->CreateFilter(&tmp_keys_[0],static_cast<int>(num_keys),&result_);
+
+    tmp_keys_.clear();
+    keys_.clear();
+    start_.clear();
+    has_last_prefix_ = false;
+}
+
+class FilterBlockReader{
+public:
+    //contents和policy在reader的生命周期内必须有效
+    FilterBlockReader(const FilterPolicy* policy,const Slice& contents);
+    bool KeyMayMatch(uint64_t block_offset,const Slice& key);
+
+private:
+    const FilterPolicy* policy_;
+    const char* data_;//filter block的开始
+    const char* offset_;//offset数组的开始
+    size_t num_;//filter的个数
+    size_t base_lg_;
+};
+
+FilterBlockReader::FilterBlockReader(const FilterPolicy* policy,const Slice& contents)
+    :policy_(policy),data_(nullptr),offset_(nullptr),num_(0),base_lg_(0){
+    size_t n = contents.size();
+    if(n<5) return;//1字节base_lg + 4字节offset数组起始位置
+    base_lg_ = contents[n-1];
+    uint32_t last_word = DecodeFixed32(contents.data()+n-5);
+    if(last_word > n-5) return;
+    data_ = contents.data();
+    offset_ = data_ + last_word;
+    num_ = (n-5-last_word)/4;
+}
+
+bool FilterBlockReader::KeyMayMatch(uint64_t block_offset,const Slice& key){
+    uint64_t index = block_offset>>base_lg_;
+    if(index<num_){
+        uint32_t start = DecodeFixed32(offset_ + index*4);
+        uint32_t limit = DecodeFixed32(offset_ + index*4 + 4);
+        if(start<=limit && limit<=static_cast<size_t>(offset_-data_)){
+            Slice filter = Slice(data_+start,limit-start);
+            return policy_->KeyMayMatch(key,filter);
+        }
+    }
+    //出错时认为可能匹配，去读data block
+    return true;
+}
+
+/**
+ * 全表filter和分区filter，所有key生成在一起，点查时不需要按data block偏移查找offset数组
+ * 全表filter: 一个filter block，内容就是policy生成的filter，metaindex中的key为"fullfilter.<Name>"
+ * 分区filter: 在data block边界上每约partition_keys个key切分出一个分区，各分区作为单独的block写入，
+ * 另外写一个分区索引block，key为分区中最大的key，value为分区的BlockHandle，
+ * metaindex中的key为"partitionedfilter.<Name>"，分区按需经过block cache读取
+ *
+ * 调用顺序: (AddKey* FinishDataBlock)* Finish
+ */
+class FullFilterBlockBuilder{
+public:
+    //partition_keys为0时只生成一个全表filter
+    FullFilterBlockBuilder(const FilterPolicy* policy,size_t partition_keys,
+                           const SliceTransform* prefix_extractor = nullptr)
+        :policy_(policy),partition_keys_(partition_keys),prefix_extractor_(prefix_extractor),
+         has_last_prefix_(false),num_keys_(0){}
+    FullFilterBlockBuilder(const FullFilterBlockBuilder&) = delete;
+    FullFilterBlockBuilder& operator=(const FullFilterBlockBuilder&) = delete;
+
+    void AddKey(const Slice& key);
+    //一个data block写完，分区只在这里切分，保证同一个data block的key落在同一个分区
+    void FinishDataBlock();
+    //为剩下的key生成filter，之后按顺序取出各个分区
+    void Finish();
+
+    size_t NumPartitions() const { return partitions_.size();}
+    Slice Partition(size_t i) const { return partitions_[i];}
+    //分区中最大的key
+    Slice PartitionLastKey(size_t i) const { return last_keys_[i];}
+
+private:
+    void GeneratePartition();
+
+    const FilterPolicy* policy_;
+    const size_t partition_keys_;
+    const SliceTransform* prefix_extractor_;
+    std::string last_prefix_;
+    bool has_last_prefix_;
+    size_t num_keys_;//当前分区中的key数，不包括前缀
+    std::string keys_;//当前分区展开存放的key和前缀
+    std::vector<size_t> start_;
+    std::string last_key_;
+    std::vector<Slice> tmp_keys_;
+    std::vector<std::string> partitions_;
+    std::vector<std::string> last_keys_;
+};
+
+void FullFilterBlockBuilder::AddKey(const Slice& key){
+    start_.push_back(keys_.size());
+    keys_.append(key.data(),key.size());
+    last_key_.assign(key.data(),key.size());
+    num_keys_++;
+    if(prefix_extractor_!=nullptr && prefix_extractor_->InDomain(key)){
+        //前缀相同的key是连续的，只需要与上一个前缀比较
+        Slice prefix = prefix_extractor_->Transform(key);
+        if(!has_last_prefix_ || prefix!=Slice(last_prefix_)){
+            start_.push_back(keys_.size());
+            keys_.append(prefix.data(),prefix.size());
+            last_prefix_.assign(prefix.data(),prefix.size());
+            has_last_prefix_ = true;
+        }
+    }
+}
+
+void FullFilterBlockBuilder::FinishDataBlock(){
+    if(partition_keys_>0 && num_keys_>=partition_keys_){
+        GeneratePartition();
+    }
+}
+
+void FullFilterBlockBuilder::Finish(){
+    //没有key时不生成filter
+    if(!start_.empty()){
+        GeneratePartition();
+    }
+}
+
+void FullFilterBlockBuilder::GeneratePartition(){
+    const size_t num_keys = start_.size();
+    start_.push_back(keys_.size());
+    tmp_keys_.resize(num_keys);
+    for(size_t i=0;i<num_keys;i++){
+        tmp_keys_[i] = Slice(keys_.data()+start_[i],start_[i+1]-start_[i]);
+    }
+    partitions_.push_back(std::string());
+    policy_->CreateFilter(&tmp_keys_[0],static_cast<int>(num_keys),&partitions_.back());
+    last_keys_.push_back(last_key_);
+
+    tmp_keys_.clear();
+    keys_.clear();
+    start_.clear();
+    num_keys_ = 0;
+    //跨分区的前缀在每个分区中都要有
+    has_last_prefix_ = false;
+}
+
+} // namespace leveldb
@@ -1,10 +1,14 @@
 #pragma once
 #include<stdint.h>
 #include<string>
+#include<vector>
 
 #include "util/slice.h"
 #include "util/status.h"
 #include "util/crc32c.h"
+#include "util/env.h"
+#include "util/options.h"
+#include "util/compression.h"
 namespace leveldb{
 
 class BlockHandle{
@@ -42,6 +46,8 @@ void BlockHandle::EncodeTo(std::string* dst)const{
     PutVarint64(dst,size_);
 }
 static const uint64_t kTableMagicNumber = 0xdb4775248b80fb57ull;
+//PlainTable(table/plain_table.h)文件最后8字节的magic number
+static const uint64_t kPlainTableMagicNumber = 0x8c3f1d7e5a29b643ull;
 static const size_t kBlockTrailerSize = 5;
 /**
  * Footer组成部分
@@ -97,26 +103,54 @@ Status Footer::DecodeFrom(Slice* input){
     return result;
 }
 
+//sstable的格式，由文件最后8字节的magic number区分
+enum TableFormat{
+    kBlockBasedTable = 0x0,//Table
+    kPlainTable = 0x1//PlainTable
+};
+
+Status ReadTableFormat(RandomAccessFile* file,uint64_t file_size,TableFormat* format){
+    if(file_size<sizeof(uint64_t)){
+        return Status::Corruption("file is too short to be an sstable");
+    }
+    char scratch[sizeof(uint64_t)];
+    Slice magic;
+    Status s = file->Read(file_size-sizeof(uint64_t),sizeof(uint64_t),&magic,scratch);
+    if(!s.ok()){
+        return s;
+    }
+    if(magic.size()!=sizeof(uint64_t)){
+        return Status::Corruption("truncated sstable magic number");
+    }
+    switch(DecodeFixed64(magic.data())){
+    case kTableMagicNumber:
+        *format = kBlockBasedTable;
+        return Status::OK();
+    case kPlainTableMagicNumber:
+        *format = kPlainTable;
+        return Status::OK();
+    default:
+        return Status::Corruption("not an sstable(bad magic number");
+    }
+}
+
 struct BlockContents{
     Slice data;
     bool cachable;
     bool heap_allocated;
+    bool checksum_verified = false;//读取时是否校验过checksum
 };
 
-Status ReadBlock(RandomAccessFile* file,const ReadOptions& options,const BlockHandle& handle,BlockContents* result){
-    //初始化result
+//contents为读到的block内容(包括trailer)，buf为读取使用的缓冲区(可以为nullptr)，由该函数接管
+//按需校验checksum并解压，结果写入result；dict为block压缩时使用的字典
+Status FinishReadBlock(const ReadOptions& options,const BlockHandle& handle,const Slice& contents,char* buf,BlockContents* result,
+                       const Slice& dict=Slice()){
     result->data=Slice();
     result->cachable = false;
-    reuslt->heap_allocated = false;
+    result->heap_allocated = false;
+    result->checksum_verified = false;
 
     size_t n = static_cast<size_t>(handle.size());
-    char* buf = new char[n+kBlockTrailerSize];
-    Slice contents;
-    Status s = file->Read(handle.offset(),n+kBlockTrailerSize,&contents,buf);
-    if(!s.ok()){
-        delete[] buf;
-        return s;
-    }
     if(contents.size()!=n+kBlockTrailerSize){
         delete[] buf;
         return Status::Corruption("truncated block read");
@@ -124,11 +158,10 @@ Status ReadBlock(RandomAccessFile* file,const ReadOptions& options,const BlockHa
     const char* data = contents.data();
     if(options.verify_checksums){
         const uint32_t crc = crc32c::Unmask(DecodeFixed32(data+n+1));
-        const uint32_t actual = crc32c::value(data,n+1);
+        const uint32_t actual = crc32c::Value(data,n+1);
         if(actual != crc){
             delete[] buf;
-            s = Status::Corruption("block checksum mismatch");
-            return s;
+            return Status::Corruption("block checksum mismatch");
         }
     }
     switch (data[n])
@@ -146,30 +179,123 @@ Status ReadBlock(RandomAccessFile* file,const ReadOptions& options,const BlockHa
         }
         break;
     
-    case kSnappyCompression:{
+    default:{
+        //类型字节对应注册的压缩算法
+        const Compressor* compressor = GetCompressor(static_cast<CompressionType>(data[n]));
+        if(compressor==nullptr){
+            delete[] buf;
+            return Status::Corruption("bad block type");
+        }
         size_t ulength = 0;
-        if (!port::Snappy_GetUncompressedLength(data, n, &ulength)) {
+        if (!compressor->GetUncompressedLength(Slice(data, n), &ulength)) {
             delete[] buf;
             return Status::Corruption("corrupted compressed block contents");
         }
         char* ubuf = new char[ulength];
-        if (!port::Snappy_Uncompress(data, n, ubuf)) {
+        if (!compressor->Uncompress(Slice(data, n), dict, ubuf, ulength)) {
             delete[] buf;
             delete[] ubuf;
             return Status::Corruption("corrupted compressed block contents");
         }
-         delete[] buf;
+        delete[] buf;
         result->data = Slice(ubuf, ulength);
         result->heap_allocated = true;
         result->cachable = true;
         break;
-
     }
-    default:
-        delete[] buf;
-        return status::Corruption("bad block type");
     }
+    result->checksum_verified = options.verify_checksums;
     return Status::OK();
 }
 
+Status ReadBlock(RandomAccessFile* file,const ReadOptions& options,const BlockHandle& handle,BlockContents* result,
+                 const Slice& dict=Slice()){
+    result->data=Slice();
+    result->cachable = false;
+    result->heap_allocated = false;
+
+    size_t n = static_cast<size_t>(handle.size());
+    //文件支持零拷贝(mmap)时不需要缓冲区，未压缩的block直接指向文件内存
+    char* buf = file->SupportsZeroCopy() ? nullptr : new char[n+kBlockTrailerSize];
+    Slice contents;
+    Status s = file->Read(handle.offset(),n+kBlockTrailerSize,&contents,buf);
+    if(!s.ok()){
+        delete[] buf;
+        return s;
+    }
+    return FinishReadBlock(options,handle,contents,buf,result,dict);
+}
+
+//一次提交handles[0,num-1]的读取，I/O全部完成后逐个校验解压，结果和状态分别写入results[i]、statuses[i]
+void MultiReadBlock(RandomAccessFile* file,const ReadOptions& options,const BlockHandle* handles,size_t num,
+                    BlockContents* results,Status* statuses,const Slice& dict=Slice()){
+    const bool zero_copy = file->SupportsZeroCopy();
+    std::vector<ReadRequest> reqs(num);
+    for(size_t i=0;i<num;i++){
+        reqs[i].offset = handles[i].offset();
+        reqs[i].len = static_cast<size_t>(handles[i].size()) + kBlockTrailerSize;
+        reqs[i].scratch = zero_copy ? nullptr : new char[reqs[i].len];
+    }
+    file->MultiRead(reqs.data(),num);
+    for(size_t i=0;i<num;i++){
+        if(reqs[i].status.ok()){
+            statuses[i] = FinishReadBlock(options,handles[i],reqs[i].result,reqs[i].scratch,&results[i],dict);
+        }else{
+            delete[] reqs[i].scratch;
+            results[i] = BlockContents{Slice(),false,false};
+            statuses[i] = reqs[i].status;
+        }
+    }
+}
+
+//异步读取完成后的回调，contents只在回调期间有效，调用者需要接管其中的内存
+typedef void(*BlockReadCallback)(void* arg,const Status& s,BlockContents* contents);
+
+namespace{
+struct AsyncBlockRead{
+    ReadRequest req;
+    ReadOptions options;
+    BlockHandle handle;
+    Slice dict;
+    BlockReadCallback callback;
+    void* arg;
+};
+
+//在读取完成的线程中校验解压，然后交给调用者
+static void FinishAsyncBlockRead(void* arg,ReadRequest* req){
+    AsyncBlockRead* state = reinterpret_cast<AsyncBlockRead*>(arg);
+    BlockContents contents{Slice(),false,false};
+    Status s;
+    if(req->status.ok()){
+        s = FinishReadBlock(state->options,state->handle,req->result,req->scratch,&contents,state->dict);
+    }else{
+        delete[] req->scratch;
+        s = req->status;
+    }
+    (*state->callback)(state->arg,s,&contents);
+    delete state;
+}
+} // namespace
+
+//提交一个block的异步读取，I/O完成后校验解压再调用callback；返回错误时callback不会被调用
+//dict必须在callback被调用之前一直有效
+Status ReadBlockAsync(RandomAccessFile* file,const ReadOptions& options,const BlockHandle& handle,
+                      BlockReadCallback callback,void* arg,const Slice& dict=Slice()){
+    AsyncBlockRead* state = new AsyncBlockRead;
+    state->options = options;
+    state->handle = handle;
+    state->dict = dict;
+    state->callback = callback;
+    state->arg = arg;
+    state->req.offset = handle.offset();
+    state->req.len = static_cast<size_t>(handle.size()) + kBlockTrailerSize;
+    state->req.scratch = file->SupportsZeroCopy() ? nullptr : new char[state->req.len];
+    Status s = file->ReadAsync(&state->req,&FinishAsyncBlockRead,state);
+    if(!s.ok()){
+        delete[] state->req.scratch;
+        delete state;
+    }
+    return s;
+}
+
 }//namespace leveldb
\ No newline at end of file
@@ -0,0 +1,384 @@
+#pragma once
+#include<stdint.h>
+#include<string.h>
+#include<algorithm>
+#include<string>
+#include<utility>
+#include<vector>
+#include "table/data_block_hash_index.h"
+#include "table/format.h"
+#include "table/iterator.h"
+#include "util/coding.h"
+#include "util/comparator.h"
+#include "util/env.h"
+#include "util/hash.h"
+#include "util/options.h"
+
+namespace leveldb{
+
+/**
+ * PlainTable: 整个文件mmap(或一次读入内存)后直接访问的sstable格式，适合数据集能放进page cache的场景
+ * data: entry按key有序依次存放，没有block、重启点和压缩
+ *   entry: key_size(varint32) | key | value_size(varint32) | value
+ * sparse index: 每sparse_interval个entry记录一个entry的偏移(fixed32)，Seek时二分查找后顺序扫描
+ * hash index: num_buckets个fixed32，线性探测，记录每个user key第一个entry的偏移，空桶为kPlainTableEmptyBucket；
+ *   comparator为InternalKeyComparator时按user key建立索引(flags中的kPlainTableInternalKeys)，同一个user key的多个版本相邻
+ * footer: data_size(fixed64) | num_entries(fixed64) | num_sparse(fixed32) | num_buckets(fixed32) |
+ *         sparse_interval(fixed32) | flags(fixed32) | magic(fixed64，kPlainTableMagicNumber)
+ * 偏移用32位表示，data部分不能超过4GB
+ */
+static const size_t kPlainTableFooterSize = 40;
+static const uint32_t kPlainTableSparseInterval = 16;
+static const uint32_t kPlainTableEmptyBucket = 0xffffffffu;
+static const uint32_t kPlainTableInternalKeys = 0x1;
+static const uint32_t kPlainTableHashSeed = 0x7c2e9a51;
+
+class PlainTableBuilder{
+public:
+    //hash索引的装载率使用options.data_block_hash_table_util_ratio；不持有file
+    PlainTableBuilder(const Options& options,WritableFile* file);
+    PlainTableBuilder(const PlainTableBuilder&) = delete;
+    PlainTableBuilder& operator=(const PlainTableBuilder&) = delete;
+
+    //key必须按comparator递增
+    void Add(const Slice& key,const Slice& value);
+    Status Finish();
+    Status status() const { return status_;}
+    uint64_t NumEntries() const { return num_entries_;}
+    uint64_t FileSize() const { return offset_;}
+private:
+    Status Append(const Slice& data);
+
+    const Options options_;
+    WritableFile* const file_;
+    const bool internal_keys_;
+    Status status_;
+    uint64_t offset_;
+    uint64_t num_entries_;
+    std::string last_key_;
+    std::string entry_;
+    std::vector<uint32_t> sparse_;
+    std::vector<std::pair<uint32_t,uint32_t>> user_keys_;//每个user key的hash和第一个entry的偏移
+    bool closed_;
+};
+
+PlainTableBuilder::PlainTableBuilder(const Options& options,WritableFile* file)
+    :options_(options),file_(file),internal_keys_(HashIndexUsesInternalKeys(options.comparator)),
+     offset_(0),num_entries_(0),closed_(false){}
+
+Status PlainTableBuilder::Append(const Slice& data){
+    if(status_.ok()){
+        status_ = file_->Append(data);
+        offset_ += data.size();
+    }
+    return status_;
+}
+
+void PlainTableBuilder::Add(const Slice& key,const Slice& value){
+    assert(!closed_);
+    if(!status_.ok()) return;
+    if(num_entries_>0){
+        assert(options_.comparator->Compare(key,Slice(last_key_))>0);
+    }
+    if(offset_+key.size()+value.size()+10>=kPlainTableEmptyBucket){
+        status_ = Status::InvalidArgument("plain table data exceeds 4GB");
+        return;
+    }
+    const uint32_t offset = static_cast<uint32_t>(offset_);
+    if(num_entries_%kPlainTableSparseInterval==0){
+        sparse_.push_back(offset);
+    }
+    const Slice user_key = HashIndexKey(key,internal_keys_);
+    if(num_entries_==0 || user_key!=HashIndexKey(last_key_,internal_keys_)){
+        user_keys_.push_back(std::make_pair(Hash(user_key.data(),user_key.size(),kPlainTableHashSeed),offset));
+    }
+    entry_.clear();
+    PutVarint32(&entry_,static_cast<uint32_t>(key.size()));
+    entry_.append(key.data(),key.size());
+    PutVarint32(&entry_,static_cast<uint32_t>(value.size()));
+    entry_.append(value.data(),value.size());
+    Append(entry_);
+    last_key_.assign(key.data(),key.size());
+    num_entries_++;
+}
+
+Status PlainTableBuilder::Finish(){
+    assert(!closed_);
+    closed_ = true;
+    if(!status_.ok()) return status_;
+    const uint64_t data_size = offset_;
+    std::string index;
+    for(size_t i=0;i<sparse_.size();i++){
+        PutFixed32(&index,sparse_[i]);
+    }
+    //至少留一个空桶，查找不存在的key时探测一定会结束
+    const double ratio = options_.data_block_hash_table_util_ratio>0 ? options_.data_block_hash_table_util_ratio : 0.75;
+    const uint32_t num_buckets = user_keys_.empty() ? 0 : static_cast<uint32_t>(user_keys_.size()/std::min(ratio,1.0))+1;
+    std::vector<uint32_t> buckets(num_buckets,kPlainTableEmptyBucket);
+    for(size_t i=0;i<user_keys_.size();i++){
+        uint32_t b = user_keys_[i].first%num_buckets;
+        while(buckets[b]!=kPlainTableEmptyBucket){
+            b = (b+1)%num_buckets;
+        }
+        buckets[b] = user_keys_[i].second;
+    }
+    for(uint32_t b=0;b<num_buckets;b++){
+        PutFixed32(&index,buckets[b]);
+    }
+    PutFixed64(&index,data_size);
+    PutFixed64(&index,num_entries_);
+    PutFixed32(&index,static_cast<uint32_t>(sparse_.size()));
+    PutFixed32(&index,num_buckets);
+    PutFixed32(&index,kPlainTableSparseInterval);
+    PutFixed32(&index,internal_keys_ ? kPlainTableInternalKeys : 0);
+    PutFixed64(&index,kPlainTableMagicNumber);
+    return Append(index);
+}
+
+class PlainTable{
+public:
+    //file支持零拷贝(mmap)时直接使用文件内存，否则把整个文件读入内存；不持有file，file必须比table活得更久
+    static Status Open(const Options& options,RandomAccessFile* file,uint64_t file_size,PlainTable** table);
+    PlainTable(const PlainTable&) = delete;
+    PlainTable& operator=(const PlainTable&) = delete;
+    ~PlainTable(){ delete[] buf_;}
+
+    Iterator* NewIterator(const ReadOptions& options) const;
+    //点查: 通过hash索引直接找到k的user key，对其中第一个不小于k的entry调用handle_result；user key不存在时不调用
+    Status Get(const ReadOptions& options,const Slice& k,void* arg,
+               void(*handle_result)(void* arg,const Slice& k,const Slice& v)) const;
+    //第一个不小于key的entry在文件中的偏移
+    uint64_t ApproximateOffsetOf(const Slice& key) const;
+    uint64_t NumEntries() const { return num_entries_;}
+private:
+    class Iter;
+    PlainTable(const Options& options,const char* data,char* buf)
+        :options_(options),data_(data),buf_(buf),data_size_(0),sparse_(nullptr),num_sparse_(0),
+         buckets_(nullptr),num_buckets_(0),internal_keys_(false),num_entries_(0){}
+
+    //解析offset处的entry，返回下一个entry的偏移，损坏时返回0
+    uint32_t DecodeEntryAt(uint32_t offset,Slice* key,Slice* value) const;
+    uint32_t SparseOffset(uint32_t i) const { return DecodeFixed32(sparse_+4*i);}
+    //第一个不小于target的entry的偏移，没有时返回data_size_；损坏时设置*s
+    uint32_t LowerBound(const Slice& target,Status* s) const;
+
+    const Options options_;
+    const char* const data_;//文件内容
+    char* const buf_;//不支持零拷贝时读入的文件内容
+    uint32_t data_size_;
+    const char* sparse_;
+    uint32_t num_sparse_;
+    const char* buckets_;
+    uint32_t num_buckets_;
+    bool internal_keys_;
+    uint64_t num_entries_;
+};
+
+Status PlainTable::Open(const Options& options,RandomAccessFile* file,uint64_t file_size,PlainTable** table){
+    *table = nullptr;
+    if(file_size<kPlainTableFooterSize){
+        return Status::Corruption("file is too short to be a plain table");
+    }
+    if(file_size>static_cast<uint64_t>(SIZE_MAX)){
+        return Status::NotSupported("plain table is too large to map");
+    }
+    const size_t n = static_cast<size_t>(file_size);
+    char* buf = file->SupportsZeroCopy() ? nullptr : new char[n];
+    Slice contents;
+    Status s = file->Read(0,n,&contents,buf);
+    if(s.ok() && contents.size()!=n){
+        s = Status::Corruption("truncated plain table read");
+    }
+    if(!s.ok()){
+        delete[] buf;
+        return s;
+    }
+    const char* footer = contents.data()+n-kPlainTableFooterSize;
+    const uint64_t data_size = DecodeFixed64(footer);
+    const uint64_t num_entries = DecodeFixed64(footer+8);
+    const uint32_t num_sparse = DecodeFixed32(footer+16);
+    const uint32_t num_buckets = DecodeFixed32(footer+20);
+    const uint32_t flags = DecodeFixed32(footer+28);
+    if(DecodeFixed64(footer+32)!=kPlainTableMagicNumber){
+        delete[] buf;
+        return Status::Corruption("not a plain table(bad magic number)");
+    }
+    if(data_size>=kPlainTableEmptyBucket ||
+       data_size+4ull*num_sparse+4ull*num_buckets+kPlainTableFooterSize!=file_size){
+        delete[] buf;
+        return Status::Corruption("bad plain table footer");
+    }
+    PlainTable* t = new PlainTable(options,contents.data(),buf);
+    t->data_size_ = static_cast<uint32_t>(data_size);
+    t->sparse_ = contents.data()+data_size;
+    t->num_sparse_ = num_sparse;
+    t->buckets_ = t->sparse_+4ull*num_sparse;
+    t->num_buckets_ = num_buckets;
+    t->internal_keys_ = (flags & kPlainTableInternalKeys)!=0;
+    t->num_entries_ = num_entries;
+    *table = t;
+    return Status::OK();
+}
+
+uint32_t PlainTable::DecodeEntryAt(uint32_t offset,Slice* key,Slice* value) const{
+    const char* limit = data_+data_size_;
+    uint32_t key_size,value_size;
+    const char* p = GetVarint32Ptr(data_+offset,limit,&key_size);
+    if(p==nullptr || static_cast<uint32_t>(limit-p)<key_size) return 0;
+    *key = Slice(p,key_size);
+    p = GetVarint32Ptr(p+key_size,limit,&value_size);
+    if(p==nullptr || static_cast<uint32_t>(limit-p)<value_size) return 0;
+    *value = Slice(p,value_size);
+    return static_cast<uint32_t>(p+value_size-data_);
+}
+
+uint32_t PlainTable::LowerBound(const Slice& target,Status* s) const{
+    //最后一个key小于target的稀疏索引点，从它开始顺序扫描
+    uint32_t left = 0,right = num_sparse_;
+    Slice key,value;
+    while(left<right){
+        const uint32_t mid = left+(right-left)/2;
+        if(DecodeEntryAt(SparseOffset(mid),&key,&value)==0){
+            *s = Status::Corruption("bad entry in plain table");
+            return data_size_;
+        }
+        if(options_.comparator->Compare(key,target)<0){
+            left = mid+1;
+        }else{
+            right = mid;
+        }
+    }
+    uint32_t offset = left==0 ? 0 : SparseOffset(left-1);
+    while(offset<data_size_){
+        const uint32_t next = DecodeEntryAt(offset,&key,&value);
+        if(next==0){
+            *s = Status::Corruption("bad entry in plain table");
+            return data_size_;
+        }
+        if(options_.comparator->Compare(key,target)>=0){
+            break;
+        }
+        offset = next;
+    }
+    return offset;
+}
+
+class PlainTable::Iter:public Iterator{
+public:
+    explicit Iter(const PlainTable* table):table_(table),offset_(table->data_size_),next_(table->data_size_){}
+
+    bool Valid() const override { return offset_<table_->data_size_;}
+    void SeekToFirst() override { ParseAt(0);}
+    void SeekToLast() override{
+        uint32_t offset = table_->num_sparse_==0 ? 0 : table_->SparseOffset(table_->num_sparse_-1);
+        ParseAt(offset);
+        while(Valid() && next_<table_->data_size_){
+            ParseAt(next_);
+        }
+    }
+    void Seek(const Slice& target) override { ParseAt(table_->LowerBound(target,&status_));}
+    void Next() override { assert(Valid()); ParseAt(next_);}
+    void Prev() override{
+        assert(Valid());
+        const uint32_t current = offset_;
+        if(current==0){
+            offset_ = next_ = table_->data_size_;
+            return;
+        }
+        //从current之前最近的稀疏索引点向后扫描到current的前一个entry
+        const char* sparse = table_->sparse_;
+        uint32_t left = 0,right = table_->num_sparse_;
+        while(left<right){
+            const uint32_t mid = left+(right-left)/2;
+            if(DecodeFixed32(sparse+4*mid)<current){
+                left = mid+1;
+            }else{
+                right = mid;
+            }
+        }
+        ParseAt(left==0 ? 0 : table_->SparseOffset(left-1));
+        while(Valid() && next_<current){
+            ParseAt(next_);
+        }
+    }
+    Slice key() const override { assert(Valid()); return key_;}
+    Slice value() const override { assert(Valid()); return value_;}
+    Status status() const override { return status_;}
+
+private:
+    void ParseAt(uint32_t offset){
+        if(offset>=table_->data_size_){
+            offset_ = next_ = table_->data_size_;
+            return;
+        }
+        next_ = table_->DecodeEntryAt(offset,&key_,&value_);
+        if(next_==0){
+            status_ = Status::Corruption("bad entry in plain table");
+            offset_ = next_ = table_->data_size_;
+            return;
+        }
+        offset_ = offset;
+    }
+
+    const PlainTable* const table_;
+    uint32_t offset_;//当前entry的偏移，data_size_表示无效
+    uint32_t next_;//下一个entry的偏移
+    Slice key_;//直接指向文件内容
+    Slice value_;
+    Status status_;
+};
+
+Iterator* PlainTable::NewIterator(const ReadOptions& options) const{
+    return new Iter(this);
+}
+
+Status PlainTable::Get(const ReadOptions& options,const Slice& k,void* arg,
+                       void(*handle_result)(void* arg,const Slice& k,const Slice& v)) const{
+    Status s;
+    uint32_t offset = data_size_;
+    const Slice user_key = HashIndexKey(k,internal_keys_);
+    if(num_buckets_==0){
+        if(num_entries_>0) offset = LowerBound(k,&s);
+    }else{
+        uint32_t b = Hash(user_key.data(),user_key.size(),kPlainTableHashSeed)%num_buckets_;
+        for(uint32_t probes=0;probes<num_buckets_;probes++){
+            const uint32_t candidate = DecodeFixed32(buckets_+4*b);
+            if(candidate==kPlainTableEmptyBucket){
+                break;
+            }
+            Slice key,value;
+            if(candidate>=data_size_ || DecodeEntryAt(candidate,&key,&value)==0){
+                return Status::Corruption("bad hash index in plain table");
+            }
+            if(HashIndexKey(key,internal_keys_)==user_key){
+                offset = candidate;
+                break;
+            }
+            b = (b+1)%num_buckets_;
+        }
+    }
+    //同一个user key的多个版本按comparator有序，找第一个不小于k的版本
+    Slice key,value;
+    while(s.ok() && offset<data_size_){
+        const uint32_t next = DecodeEntryAt(offset,&key,&value);
+        if(next==0){
+            return Status::Corruption("bad entry in plain table");
+        }
+        if(HashIndexKey(key,internal_keys_)!=user_key){
+            break;
+        }
+        if(options_.comparator->Compare(key,k)>=0){
+            (*handle_result)(arg,key,value);
+            break;
+        }
+        offset = next;
+    }
+    return s;
+}
+
+uint64_t PlainTable::ApproximateOffsetOf(const Slice& key) const{
+    Status s;
+    return LowerBound(key,&s);
+}
+
+} // namespace leveldb
@@ -1,34 +1,130 @@
 #pragma once
 #include <stdint.h>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <vector>
 #include "table/iterator.h"
+#include "port/port.h"
 
 #include "util/cache.h"
 #include "util/comparator.h"
 #include "util/options.h"
 #include "util/coding.h"
+#include "util/env.h"
+#include "util/mutexlock.h"
+#include "util/rate_limiter.h"
+#include "util/thread_pool.h"
+#include "table/blob_file.h"
 #include "table/block.h"
 #include "table/format.h"
+#include "table/filter_block.h"
+#include "util/filter_policy.h"
+#include "util/slice_transform.h"
 #include "table/two_level_iterator.h"
 
 namespace leveldb{
-  
+
+//Table::Open各阶段的耗时(微秒)和文件读取量，批量打开时可以用Add累加
+struct TableOpenStats{
+    uint64_t tail_micros = 0;//读取footer(或options.table_open_tail_size大小的文件尾部)
+    uint64_t index_micros = 0;//读取index block
+    uint64_t meta_micros = 0;//读取metaindex
+    uint64_t filter_micros = 0;//读取filter，options.lazy_filter_loading时为0
+    uint64_t num_reads = 0;
+    uint64_t bytes_read = 0;
+    void Add(const TableOpenStats& other){
+        tail_micros += other.tail_micros;
+        index_micros += other.index_micros;
+        meta_micros += other.meta_micros;
+        filter_micros += other.filter_micros;
+        num_reads += other.num_reads;
+        bytes_read += other.bytes_read;
+    }
+};
+
+class Table;
+//Table::OpenTables中的一个文件，table、status和stats为输出
+struct TableOpenRequest{
+    RandomAccessFile* file = nullptr;
+    uint64_t file_size = 0;
+    Table* table = nullptr;
+    Status status;
+    TableOpenStats stats;
+};
+
 class Table{
 public:
-    static Status Open(const Options& options,RandomAccessFile* file,uint64_t file_size,Table** table);
+    //stats不为空时累加各阶段的耗时和读取量
+    static Status Open(const Options& options,RandomAccessFile* file,uint64_t file_size,Table** table,
+                       TableOpenStats* stats=nullptr);
+    //在pool中并发打开reqs[0,num-1]，全部完成后返回第一个失败的状态；pool为空时依次打开
+    //不能在pool自己的线程中调用
+    static Status OpenTables(const Options& options,TableOpenRequest* reqs,size_t num,ThreadPool* pool);
 
     Table(const Table&)=delete;
     Table& operator=(const Table&)=delete;
     ~Table();
     Iterator* NewIterator(const ReadOptions&) const;
     uint64_t ApproximateOffsetOf(const Slice& key)const;
+    //该table在block_cache中的key前缀，cache key = cache_id + block offset
+    uint64_t CacheId() const;
+    //批量点查，keys[0,num-1]必须按comparator有序；对每个找到的entry调用handle_result(arg,i,k,v)，i为keys中的下标
+    //同一个data block中的key只读取和查找一次block，相邻的未缓存block合并成一次读取
+    Status MultiGet(const ReadOptions& options,const Slice* keys,size_t num,void* arg,
+                    void(*handle_result)(void* arg,size_t index,const Slice& k,const Slice& v));
+    //把offsets指定的data block读入block_cache，已在cache中的block直接跳过
+    //limiter不为空时按照其速率限制I/O，用于重启后的cache预热
+    Status PrefetchBlocks(const std::vector<uint64_t>& offsets,RateLimiter* limiter);
+    //生成时options.min_blob_size>0，value带类型字节，可能是blob引用
+    bool HasBlobValues() const;
 private:
     friend class TableCache;
+    friend class PrefixFilterIterator;
+    friend class BlobValueIterator;
     struct Rep;
     static Iterator* BlockReader(void*,const ReadOptions&,const Slice&);
+    //遍历index中所有data block的handle，kPartitionedIndex时按需读取分区
+    Iterator* NewIndexIterator(const ReadOptions& options) const;
+    //顺序扫描时一次读取index_values中连续的多个data block，总大小不超过options.readahead_size
+    static void BlockPrefetcher(void*,const ReadOptions&,const std::vector<std::string>& index_values,std::vector<Iterator*>* iters);
     explicit Table(Rep* rep):rep_(rep){}
     Status InternalGet(const ReadOptions&,const Slice& key,void* arg,void(*handle_result)(void* arg,const Slice&k,const Slice& v));
     void ReadMeta(const Footer& footer);
-    void ReadFilter(const Slice& filter_handle_value);
+    void ReadFilter(FilterLayout layout,const Slice& filter_handle_value);
+    //Open时读取meta block，落在已读到的文件尾部中时不再读取文件
+    Status ReadOpenBlock(const BlockHandle& handle,BlockContents* contents) const;
+    //options.lazy_filter_loading时第一次需要filter时读取
+    void LoadFilter();
+    //全表或分区filter判断k不在table中时返回false，其他情况返回true
+    bool FullFilterMayMatch(const ReadOptions& options,const Slice& k);
+    bool PartitionMayMatch(const ReadOptions& options,const Slice& partition_handle_value,const Slice& k);
+    //target的前缀不在table中时返回false
+    bool PrefixMayMatch(const ReadOptions& options,const Slice& target);
+    //在block cache中查找offset处的data block，命中时设置*cache_handle
+    //options要求校验checksum而cache中的block没有校验过时按未命中处理
+    Block* LookupBlock(const ReadOptions& options,uint64_t offset,Cache::Handle** cache_handle) const;
+    //零拷贝文件中offset处的data block是否已经校验过checksum
+    bool BlockVerified(uint64_t offset) const;
+    //要求校验时跳过已经校验过的零拷贝block，返回读取实际使用的options(可能指向*scratch)
+    const ReadOptions& DataBlockReadOptions(const ReadOptions& options,uint64_t offset,ReadOptions* scratch) const;
+    //新读到的block按照options插入block cache，没有插入时返回nullptr，调用者负责释放block
+    //零拷贝文件中校验过的block记录在verified_blocks中
+    Cache::Handle* CacheBlock(const ReadOptions& options,uint64_t offset,Block* block,const BlockContents& contents) const;
+    //读取handles指定的一组按偏移递增的data block，先查block cache，文件中相邻的未命中block合并成一次读取
+    //blocks[i]为nullptr表示读取失败；cache_handles[i]为nullptr时调用者负责释放blocks[i]
+    Status ReadBlocks(const ReadOptions& options,const BlockHandle* handles,size_t num,
+                      Block** blocks,Cache::Handle** cache_handles) const;
+    //先查block cache，未命中时读取handle处的data block并按照options插入cache
+    Status ReadDataBlock(const ReadOptions& options,const BlockHandle& handle,Block** block,Cache::Handle** cache_handle) const;
+    //为block建立迭代器，迭代器析构时释放block或cache handle
+    Iterator* NewBlockIterator(Block* block,Cache::Handle* cache_handle) const;
+    //blob_values时去掉*value的类型字节，blob引用从options.blob_source读取到*scratch；
+    //options.resolve_blobs为false时保持原样
+    Status ResolveValue(const ReadOptions& options,Slice* value,std::string* scratch) const;
+    //点查时block中找到的found是否就是要查的target(internal key时比较user key)
+    bool MatchesTarget(const Slice& found,const Slice& target) const;
     Rep* const rep_;
 };
 
@@ -36,21 +132,74 @@ struct Table::Rep{
     ~Rep(){
         delete filter;
         delete[] filter_data;
+        delete filter_index;
         delete index_block;
+        delete[] verified_blocks;
     }
     Options options;
     Status status;
     RandomAccessFile* file;
     uint64_t cache_id;
-    FilterBlockReader* filter;
+    IndexLayout index_layout;//kPartitionedIndex时index_block是分区的顶层索引
+    FilterLayout filter_layout;//table中实际使用的filter组织方式
+    FilterBlockReader* filter;//kBlockBasedFilter
+    Slice full_filter;//kFullFilter
+    Block* filter_index;//kPartitionedFilter的分区索引
+    bool prefix_filtering;//filter中包含options.prefix_extractor提取的前缀
+    //文件支持零拷贝且目前读到的data block都没有压缩时不经过block cache，
+    //block直接指向文件内存，缓存只会多一次查找和多占一份内存
+    std::atomic<bool> bypass_block_cache;
+    //零拷贝文件的block直接引用不变的文件内存，校验过一次后不必再校验；不经过block cache时没有Block记录校验状态，
+    //按偏移记录，每kVerifiedBlockGranularity字节一位，其他文件为nullptr
+    std::atomic<uint64_t>* verified_blocks;
+    size_t verified_blocks_words;
     const char* filter_data;
     BlockHandle metaindex_handle;
     Block* index_block;
+    //filter_loaded为false时filter还没有读取，pending_filter_*记录它的组织方式和handle
+    std::atomic<bool> filter_loaded;
+    port::Mutex filter_mutex;
+    FilterLayout pending_filter_layout;
+    std::string pending_filter_handle;
+    //data block和index分区的压缩字典，为空时不使用
+    std::string compression_dict;
+    //value带有类型字节，可能是blob引用，见table/blob_file.h
+    bool blob_values;
+    //只在Open期间有效: 已读到的文件尾部及其在文件中的偏移，以及统计
+    Slice open_tail;
+    uint64_t open_tail_offset;
+    TableOpenStats* open_stats;
 };
 
+//data block至少有一个entry(3字节)、一个重启点(4字节)、重启点个数(4字节)和trailer(5字节)，
+//不同block的偏移至少相差16字节，不会落在verified_blocks的同一位
+static const uint64_t kVerifiedBlockGranularity = 16;
+
+static uint64_t NowMicros(){
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//handle指向的block完整地落在tail(从文件偏移tail_offset开始)中时直接从中取得，否则读取文件
+static Status ReadBlockFromTail(RandomAccessFile* file,const ReadOptions& options,const BlockHandle& handle,
+                                const Slice& tail,uint64_t tail_offset,BlockContents* result,TableOpenStats* stats){
+    const uint64_t n = handle.size()+kBlockTrailerSize;
+    if(handle.offset()>=tail_offset && n<=tail.size() && handle.offset()-tail_offset<=tail.size()-n){
+        //tail在Open结束时释放，block需要自己的一份拷贝
+        char* buf = new char[n];
+        memcpy(buf,tail.data()+(handle.offset()-tail_offset),n);
+        return FinishReadBlock(options,handle,Slice(buf,n),buf,result);
+    }
+    if(stats!=nullptr){
+        stats->num_reads++;
+        stats->bytes_read += n;
+    }
+    return ReadBlock(file,options,handle,result);
+}
+
 //打开一个sstable文件
 //file为要打开的文件，size为要打开的文件的大小，若操作成功，table指向新打开的表，否则返回错误
-Status Table::Open(const Options& options,RandomAccessFile* file,uint64_t size,Table** table){
+Status Table::Open(const Options& options,RandomAccessFile* file,uint64_t size,Table** table,TableOpenStats* stats){
     *table=nullptr;
 
     //从文件末尾读取footer
@@ -58,13 +207,37 @@ Status Table::Open(const Options& options,RandomAccessFile* file,uint64_t size,T
         //文件太短
         return Status::Corruption("file is too short to be an sstable");
     }
-    char footer_space[Footer::kEncodedLength];
-    Slice footer_input;
-    Status s = file->Read(size-Footer::kEncodedLength,Footer::kEncodedLength,&footer_input,footer_space);
-    if(!s.ok())return s;
+    TableOpenStats local_stats;
+    if(stats==nullptr) stats = &local_stats;
+    //footer之前的index、metaindex和filter通常也在文件末尾，一次读取，落在其中的block不必再读
+    //零拷贝的文件读取没有开销，只读footer
+    size_t tail_size = Footer::kEncodedLength;
+    if(!file->SupportsZeroCopy() && options.table_open_tail_size>tail_size){
+        tail_size = static_cast<size_t>(std::min<uint64_t>(size,options.table_open_tail_size));
+    }
+    uint64_t start = NowMicros();
+    char* tail_space = new char[tail_size];
+    Slice tail;
+    Status s = file->Read(size-tail_size,tail_size,&tail,tail_space);
+    stats->num_reads++;
+    stats->bytes_read += tail_size;
+    stats->tail_micros += NowMicros()-start;
+    if(!s.ok()){
+        delete[] tail_space;
+        return s;
+    }
+    if(tail.size()<Footer::kEncodedLength){
+        delete[] tail_space;
+        return Status::Corruption("truncated sstable footer");
+    }
+    const uint64_t tail_offset = size-tail.size();
+    if(DecodeFixed64(tail.data()+tail.size()-sizeof(uint64_t))==kPlainTableMagicNumber){
+        delete[] tail_space;
+        return Status::NotSupported("plain table format, open with PlainTable::Open");
+    }
+    Slice footer_input(tail.data()+tail.size()-Footer::kEncodedLength,Footer::kEncodedLength);
     Footer footer;
     s = footer.DecodeFrom(&footer_input);
-    if(!s.ok())return s;
     //读取index block
     BlockContents index_block_contens;
     if(s.ok()){
@@ -72,7 +245,9 @@ Status Table::Open(const Options& options,RandomAccessFile* file,uint64_t size,T
         if(options.paranoid_checks){
             opt.verify_checksums = true;
         }
-        s = ReadBlock(file,opt,footer.index_handle(),&index_block_contens);
+        start = NowMicros();
+        s = ReadBlockFromTail(file,opt,footer.index_handle(),tail,tail_offset,&index_block_contens,stats);
+        stats->index_micros += NowMicros()-start;
     }
     if(s.ok()){
         //已成功读取footer和index_block,可以响应请求了
@@ -84,106 +259,311 @@ Status Table::Open(const Options& options,RandomAccessFile* file,uint64_t size,T
         rep->index_block = index_block;
         rep->cache_id = (options.block_cache? options.block_cache->NewId():0);
         rep->filter_data = nullptr;
+        rep->index_layout = kSingleIndex;
+        rep->filter_layout = kBlockBasedFilter;
         rep->filter = nullptr;
+        rep->filter_index = nullptr;
+        rep->prefix_filtering = false;
+        rep->blob_values = false;
+        rep->bypass_block_cache = file->SupportsZeroCopy();
+        rep->verified_blocks = nullptr;
+        rep->verified_blocks_words = 0;
+        if(file->SupportsZeroCopy()){
+            rep->verified_blocks_words = static_cast<size_t>((size/kVerifiedBlockGranularity+63)/64);
+            rep->verified_blocks = new std::atomic<uint64_t>[rep->verified_blocks_words];
+            for(size_t i=0;i<rep->verified_blocks_words;i++){
+                rep->verified_blocks[i].store(0,std::memory_order_relaxed);
+            }
+        }
+        rep->filter_loaded = true;
+        rep->pending_filter_layout = kBlockBasedFilter;
+        rep->open_tail = tail;
+        rep->open_tail_offset = tail_offset;
+        rep->open_stats = stats;
         *table = new Table(rep);
         (*table)->ReadMeta(footer);
+        rep->open_tail = Slice();
+        rep->open_stats = nullptr;
     }
+    delete[] tail_space;
     return s;
 }
 
-void Table::ReadMeta(const Footer& footer){
-    if(rep_->options.filter_policy==nullptr){
-        return;
+namespace{
+//OpenTables中等待所有table打开
+struct OpenTablesState{
+    OpenTablesState(const Options* o,size_t n):options(o),cv(&mutex),remaining(n){}
+    const Options* options;
+    port::Mutex mutex;
+    port::CondVar cv;
+    size_t remaining;
+};
+struct OpenTableTask{
+    OpenTablesState* state;
+    TableOpenRequest* req;
+};
+} // namespace
+
+static void OpenTableInPool(void* arg){
+    OpenTableTask* task = reinterpret_cast<OpenTableTask*>(arg);
+    TableOpenRequest* req = task->req;
+    req->status = Table::Open(*task->state->options,req->file,req->file_size,&req->table,&req->stats);
+    OpenTablesState* state = task->state;
+    MutexLock l(&state->mutex);
+    if(--state->remaining==0) state->cv.SignalAll();
+}
+
+Status Table::OpenTables(const Options& options,TableOpenRequest* reqs,size_t num,ThreadPool* pool){
+    if(pool==nullptr){
+        for(size_t i=0;i<num;i++){
+            reqs[i].status = Open(options,reqs[i].file,reqs[i].file_size,&reqs[i].table,&reqs[i].stats);
+        }
+    }else if(num>0){
+        OpenTablesState state(&options,num);
+        std::vector<OpenTableTask> tasks(num);
+        for(size_t i=0;i<num;i++){
+            tasks[i] = OpenTableTask{&state,&reqs[i]};
+            pool->Schedule(&OpenTableInPool,&tasks[i]);
+        }
+        MutexLock l(&state.mutex);
+        while(state.remaining>0) state.cv.Wait();
     }
-    ReadOptions opt;
-    if(rep_->options.paranoid_checks){
-        opt.verify_checksums=true;
+    for(size_t i=0;i<num;i++){
+        if(!reqs[i].status.ok()) return reqs[i].status;
     }
+    return Status::OK();
+}
+
+Table::~Table(){ delete rep_;}
+
+void Table::ReadMeta(const Footer& footer){
     BlockContents contents;
-    if(!ReadBlock(rep_->file,opt,footer.metaindex_handle(),&contents).ok()){
+    const uint64_t start = NowMicros();
+    const bool ok = ReadOpenBlock(footer.metaindex_handle(),&contents).ok();
+    if(rep_->open_stats!=nullptr){
+        rep_->open_stats->meta_micros += NowMicros()-start;
+    }
+    if(!ok){
         return;
     }
     Block* meta = new Block(contents);
     Iterator* iter = meta->NewIterator(BytewiseComparator());
-    std::string key = "filter.";
-    key.append(rep_->options.filter_policy->Name());
-    iter->Seek(key);
-    if(iter->Valid() && iter->key()==Slice(key)){
-        ReadFilter(iter->value());
+    //index的组织方式与filter无关，总是需要读取
+    iter->Seek("leveldb.index.type");
+    if(iter->Valid() && iter->key()==Slice("leveldb.index.type") && iter->value().size()>=sizeof(uint32_t) &&
+       DecodeFixed32(iter->value().data())==kPartitionedIndex){
+        rep_->index_layout = kPartitionedIndex;
+    }
+    iter->Seek("leveldb.blob.values");
+    if(iter->Valid() && iter->key()==Slice("leveldb.blob.values")){
+        rep_->blob_values = true;
+    }
+    iter->Seek("compression.dict");
+    if(iter->Valid() && iter->key()==Slice("compression.dict")){
+        Slice v = iter->value();
+        BlockHandle dict_handle;
+        BlockContents dict;
+        if(dict_handle.DecodeFrom(&v).ok() && ReadOpenBlock(dict_handle,&dict).ok()){
+            rep_->compression_dict.assign(dict.data.data(),dict.data.size());
+            if(dict.heap_allocated){
+                delete[] dict.data.data();
+            }
+        }
+    }
+    if(rep_->options.filter_policy!=nullptr){
+        //按照写入时的组织方式读取，与当前options.filter_layout无关
+        static const struct{ const char* prefix; FilterLayout layout;} kFilterTypes[] = {
+            {"fullfilter.",kFullFilter},
+            {"partitionedfilter.",kPartitionedFilter},
+            {"filter.",kBlockBasedFilter}
+        };
+        for(size_t i=0;i<sizeof(kFilterTypes)/sizeof(kFilterTypes[0]);i++){
+            std::string key = kFilterTypes[i].prefix;
+            key.append(rep_->options.filter_policy->Name());
+            iter->Seek(key);
+            if(iter->Valid() && iter->key()==Slice(key)){
+                if(rep_->options.lazy_filter_loading){
+                    rep_->pending_filter_layout = kFilterTypes[i].layout;
+                    rep_->pending_filter_handle = iter->value().ToString();
+                    rep_->filter_loaded = false;
+                }else{
+                    ReadFilter(kFilterTypes[i].layout,iter->value());
+                }
+                break;
+            }
+        }
+        if(rep_->options.prefix_extractor!=nullptr){
+            iter->Seek("prefix.extractor");
+            if(iter->Valid() && iter->key()==Slice("prefix.extractor") &&
+               iter->value()==Slice(rep_->options.prefix_extractor->Name())){
+                rep_->prefix_filtering = true;
+            }
+        }
     }
     delete iter;
     delete meta;
 }
-void Table::ReadFilter(const Slice& filter_handle_value){
+void Table::ReadFilter(FilterLayout layout,const Slice& filter_handle_value){
     Slice v = filter_handle_value;
     BlockHandle filter_handle;
     if(!filter_handle.DecodeFrom(&v).ok()){
         return;
     }
-    ReadOptions opt;
-    if (rep_->options.paranoid_checks) {
-        opt.verify_checksums = true;
-    }
     BlockContents block;
-    if(!ReadBlock(rep_->file,opt,filter_handle,&block).ok()){
+    const uint64_t start = NowMicros();
+    const bool ok = ReadOpenBlock(filter_handle,&block).ok();
+    if(rep_->open_stats!=nullptr){
+        rep_->open_stats->filter_micros += NowMicros()-start;
+    }
+    if(!ok){
+        return;
+    }
+    rep_->filter_layout = layout;
+    if(layout==kPartitionedFilter){
+        //分区索引常驻内存，分区本身按需读取
+        rep_->filter_index = new Block(block);
         return;
     }
     if(block.heap_allocated){
         rep_->filter_data = block.data.data();
     }
-    rep_->filter = new FilterBlockReader(rep_->options.filter_policy, block.data);
+    if(layout==kFullFilter){
+        rep_->full_filter = block.data;
+    }else{
+        rep_->filter = new FilterBlockReader(rep_->options.filter_policy, block.data);
+    }
+}
+Status Table::ReadOpenBlock(const BlockHandle& handle,BlockContents* contents) const{
+    ReadOptions opt;
+    if(rep_->options.paranoid_checks){
+        opt.verify_checksums = true;
+    }
+    return ReadBlockFromTail(rep_->file,opt,handle,rep_->open_tail,rep_->open_tail_offset,contents,rep_->open_stats);
 }
-Iterator* Table::NewIterator(const ReadOptions& options) const{
-    return NewTwoLevelIterator(rep_->index_block->NewIterator(rep_->options.comparator),  
-                                &Table::BlockReader,const_cast<Table*>(this), options);  
 
+void Table::LoadFilter(){
+    if(rep_->filter_loaded.load(std::memory_order_acquire)){
+        return;
+    }
+    MutexLock l(&rep_->filter_mutex);
+    if(!rep_->filter_loaded.load(std::memory_order_relaxed)){
+        ReadFilter(rep_->pending_filter_layout,rep_->pending_filter_handle);
+        rep_->filter_loaded.store(true,std::memory_order_release);
+    }
 }
 
-Iterator* Table::BlockReader(void* arg,const ReadOptions& options,const Slice& index_value){
-    Table* table = reinterpret_cast<Table*>(arg);
-    Block* block=nullptr;
-    Cache* block_cache = table->rep_->options.block_cache;
-    Cache::Handle* cache_handle = nullptr;
-    BlockHandle handle;
-    Slice input = index_value;
-    Status s= handle.DecodeFrom(&input);//解析出block在sstable中的偏移和大小
-    if(s.ok()){
-        BlockContents contents;
-        if(block_cache != nullptr){
-            char cache_key_buffer[16];
-            EncodeFixed64(cache_key_buffer,table->rep_->cache_id);
-            EncodeFixed64(cache_key_buffer+8,handle.offset());
-            //根据block的大小和cache_id组成key，来查找block在LRU中的位置
-            Slice key(cache_key_buffer,sizeof(cache_key_buffer));
-            cache_handle = block_cache->Lookup(key);
-            if(cache_handle!=nullptr){
-                block = reinterpret_cast<Block*>(block_cache->Value(cache_handle));
-            }else{
-                s = ReadBlock(table->rep_->file, options, handle, &contents);
-                if(s.ok()){
-                    block = new Block(contents);
-                    if(contents.cachable&& options.fill_cache)
-                    //尝试加到cache中
-                        cache_handle = block_cache->Insert(key,block,block->size(),&DeleteCachedBlock);
-                }
-            }
-        }else{
-            s = ReadBlock(table->rep_->file, options, handle, &contents);
-            if (s.ok()) {
-                block = new Block(contents);
-            }
+//ReadOptions::prefix_seek时包装table的迭代器，Seek的target前缀不在filter中时不读取任何block
+class PrefixFilterIterator:public Iterator{
+public:
+    PrefixFilterIterator(Table* table,const ReadOptions& options,Iterator* iter)
+        :table_(table),options_(options),iter_(iter),filtered_(false){}
+    ~PrefixFilterIterator() override { delete iter_;}
+
+    bool Valid() const override { return !filtered_ && iter_->Valid();}
+    void Seek(const Slice& target) override{
+        filtered_ = !table_->PrefixMayMatch(options_,target);
+        if(!filtered_){
+            iter_->Seek(target);
         }
     }
-    Iterator* iter;
-    if(block != nullptr){
-        iter = block->NewIterator(table->rep_->options.comparator);
-        if(cache_handle==nullptr){
-            iter->RegsiterCleanup(&DeleteBlock,block,nullptr);
-        }else{
-           iter->RegisterCleanup(&ReleaseBlock, block_cache, cache_handle);
+    void SeekToFirst() override { filtered_ = false; iter_->SeekToFirst();}
+    void SeekToLast() override { filtered_ = false; iter_->SeekToLast();}
+    void Next() override { assert(Valid()); iter_->Next();}
+    void Prev() override { assert(Valid()); iter_->Prev();}
+    Slice key() const override { assert(Valid()); return iter_->key();}
+    Slice value() const override { assert(Valid()); return iter_->value();}
+    Status status() const override { return filtered_ ? Status::OK() : iter_->status();}
+
+private:
+    Table* const table_;
+    const ReadOptions options_;
+    Iterator* const iter_;
+    bool filtered_;//上一次Seek被filter排除
+};
+
+//blob_values的table的迭代器: 去掉value的类型字节，blob引用在第一次调用value()时才读取
+class BlobValueIterator:public Iterator{
+public:
+    BlobValueIterator(const Table* table,const ReadOptions& options,Iterator* iter)
+        :table_(table),options_(options),iter_(iter),resolved_(false){}
+    ~BlobValueIterator() override { delete iter_;}
+
+    bool Valid() const override { return iter_->Valid();}
+    void Seek(const Slice& target) override { iter_->Seek(target); resolved_ = false;}
+    void SeekToFirst() override { iter_->SeekToFirst(); resolved_ = false;}
+    void SeekToLast() override { iter_->SeekToLast(); resolved_ = false;}
+    void Next() override { assert(Valid()); iter_->Next(); resolved_ = false;}
+    void Prev() override { assert(Valid()); iter_->Prev(); resolved_ = false;}
+    Slice key() const override { assert(Valid()); return iter_->key();}
+    Slice value() const override{
+        assert(Valid());
+        if(!resolved_){
+            value_ = iter_->value();
+            Status s = table_->ResolveValue(options_,&value_,&blob_);
+            if(!s.ok()){
+                value_ = Slice();
+                if(status_.ok()) status_ = s;
+            }
+            resolved_ = true;
         }
-    }else{
-        iter = NewErrorIterator(s);
+        return value_;
+    }
+    Status status() const override { return status_.ok() ? iter_->status() : status_;}
+
+private:
+    const Table* const table_;
+    const ReadOptions options_;
+    Iterator* const iter_;
+    mutable bool resolved_;//value_对应当前entry
+    mutable Slice value_;
+    mutable std::string blob_;
+    mutable Status status_;//第一次读取blob失败的状态
+};
+
+Status Table::ResolveValue(const ReadOptions& options,Slice* value,std::string* scratch) const{
+    if(!rep_->blob_values || !options.resolve_blobs){
+        return Status::OK();
+    }
+    Slice inline_value;
+    BlobIndex index;
+    bool is_reference = false;
+    Status s = DecodeBlobValue(*value,&inline_value,&index,&is_reference);
+    if(!s.ok()){
+        return s;
+    }
+    if(!is_reference){
+        *value = inline_value;
+        return s;
+    }
+    if(rep_->options.blob_source==nullptr){
+        return Status::InvalidArgument("blob reference without options.blob_source");
+    }
+    s = rep_->options.blob_source->Get(options,index,scratch);
+    if(s.ok()){
+        *value = *scratch;
+    }
+    return s;
+}
+
+bool Table::MatchesTarget(const Slice& found,const Slice& target) const{
+    const bool internal_keys = HashIndexUsesInternalKeys(rep_->options.comparator);
+    return HashIndexKey(found,internal_keys)==HashIndexKey(target,internal_keys);
+}
+
+Iterator* Table::NewIterator(const ReadOptions& options) const{
+    Iterator* iter = NewTwoLevelIterator(NewIndexIterator(options),
+                                         &Table::BlockReader,const_cast<Table*>(this), options,
+                                         &Table::BlockPrefetcher);
+    //只有全表和分区filter能够对整个table做判断
+    if(options.prefix_seek && rep_->prefix_filtering){
+        const_cast<Table*>(this)->LoadFilter();
+    }
+    if(options.prefix_seek && rep_->prefix_filtering &&
+       (rep_->filter_layout==kFullFilter || rep_->filter_layout==kPartitionedFilter)){
+        iter = new PrefixFilterIterator(const_cast<Table*>(this),options,iter);
+    }
+    if(rep_->blob_values && options.resolve_blobs){
+        iter = new BlobValueIterator(this,options,iter);
     }
     return iter;
 }
@@ -202,8 +582,110 @@ static void DeleteBlock(void* arg, void* ignored) {
   delete reinterpret_cast<Block*>(arg);
 }
 
+Block* Table::LookupBlock(const ReadOptions& options,uint64_t offset,Cache::Handle** cache_handle) const{
+    *cache_handle = nullptr;
+    Cache* block_cache = rep_->options.block_cache;
+    if(block_cache==nullptr || rep_->bypass_block_cache.load(std::memory_order_relaxed)){
+        return nullptr;
+    }
+    char cache_key_buffer[16];
+    EncodeFixed64(cache_key_buffer,rep_->cache_id);
+    EncodeFixed64(cache_key_buffer+8,offset);
+    //根据block的大小和cache_id组成key，来查找block在LRU中的位置
+    *cache_handle = block_cache->Lookup(Slice(cache_key_buffer,sizeof(cache_key_buffer)));
+    if(*cache_handle==nullptr){
+        return nullptr;
+    }
+    Block* block = reinterpret_cast<Block*>(block_cache->Value(*cache_handle));
+    if(options.verify_checksums && !block->checksum_verified()){
+        //不校验的读取放入的block，重新读取校验后替换cache中的项，之后的命中不再校验
+        block_cache->Release(*cache_handle);
+        *cache_handle = nullptr;
+        return nullptr;
+    }
+    return block;
+}
+
+bool Table::BlockVerified(uint64_t offset) const{
+    const uint64_t bit = offset/kVerifiedBlockGranularity;
+    if(bit/64>=rep_->verified_blocks_words) return false;
+    return (rep_->verified_blocks[bit/64].load(std::memory_order_acquire) & (uint64_t{1}<<(bit%64)))!=0;
+}
+
+const ReadOptions& Table::DataBlockReadOptions(const ReadOptions& options,uint64_t offset,ReadOptions* scratch) const{
+    if(!options.verify_checksums || !BlockVerified(offset)){
+        return options;
+    }
+    *scratch = options;
+    scratch->verify_checksums = false;
+    return *scratch;
+}
+
+Cache::Handle* Table::CacheBlock(const ReadOptions& options,uint64_t offset,Block* block,const BlockContents& contents) const{
+    const uint64_t bit = offset/kVerifiedBlockGranularity;
+    if(contents.checksum_verified && bit/64<rep_->verified_blocks_words){
+        rep_->verified_blocks[bit/64].fetch_or(uint64_t{1}<<(bit%64),std::memory_order_release);
+    }
+    if(contents.heap_allocated && rep_->bypass_block_cache.load(std::memory_order_relaxed)){
+        //遇到需要分配内存(压缩)的block，之后的读取都经过cache
+        rep_->bypass_block_cache.store(false,std::memory_order_relaxed);
+    }
+    Cache* block_cache = rep_->options.block_cache;
+    if(block_cache==nullptr || !contents.cachable || !options.fill_cache){
+        return nullptr;
+    }
+    char cache_key_buffer[16];
+    EncodeFixed64(cache_key_buffer,rep_->cache_id);
+    EncodeFixed64(cache_key_buffer+8,offset);
+    return block_cache->Insert(Slice(cache_key_buffer,sizeof(cache_key_buffer)),block,block->size(),&DeleteCachedBlock);
+}
+
+Status Table::ReadDataBlock(const ReadOptions& options,const BlockHandle& handle,Block** block,Cache::Handle** cache_handle) const{
+    *block = LookupBlock(options,handle.offset(),cache_handle);
+    if(*block!=nullptr){
+        return Status::OK();
+    }
+    BlockContents contents;
+    ReadOptions scratch;
+    const ReadOptions& read_options = DataBlockReadOptions(options,handle.offset(),&scratch);
+    Status s = ReadBlock(rep_->file,read_options,handle,&contents,rep_->compression_dict);
+    if(s.ok()){
+        //跳过校验的block之前已经校验过
+        if(&read_options!=&options) contents.checksum_verified = true;
+        *block = new Block(contents);
+        //尝试加到cache中
+        *cache_handle = CacheBlock(options,handle.offset(),*block,contents);
+    }
+    return s;
+}
+
+Iterator* Table::BlockReader(void* arg,const ReadOptions& options,const Slice& index_value){
+    Table* table = reinterpret_cast<Table*>(arg);
+    Block* block=nullptr;
+    Cache::Handle* cache_handle = nullptr;
+    BlockHandle handle;
+    Slice input = index_value;
+    Status s= handle.DecodeFrom(&input);//解析出block在sstable中的偏移和大小
+    if(s.ok()){
+        s = table->ReadDataBlock(options,handle,&block,&cache_handle);
+    }
+    if(block==nullptr){
+        return NewErrorIterator(s);
+    }
+    return table->NewBlockIterator(block,cache_handle);
+}
+
+Iterator* Table::NewIndexIterator(const ReadOptions& options) const{
+    Iterator* iter = rep_->index_block->NewIterator(rep_->options.comparator,rep_->options.block_restart_key_cache);
+    if(rep_->index_layout==kPartitionedIndex){
+        //分区和data block一样经过block cache读取
+        iter = NewTwoLevelIterator(iter,&Table::BlockReader,const_cast<Table*>(this),options);
+    }
+    return iter;
+}
+
 uint64_t Table::ApproximateOffsetOf(const Slice& key) const{
-    Iterator* index_iter = rep_->index_block->NewIterator(rep_->options.comparator);
+    Iterator* index_iter = NewIndexIterator(ReadOptions());
     index_iter->Seek(key);
     uint64_t result;
     if(index_iter->Valid()){
@@ -225,31 +707,444 @@ uint64_t Table::ApproximateOffsetOf(const Slice& key) const{
   return result;
 }
 
-Status Table::InternalGet(const ReadOptions& options,const Slice& k,void* arg,void(*handle_result)(void*,const Slice&,const Slice&)){
-    Status s;
-    Iterator* iter = rep_->index_block->NewIterator(rep_->options.comparator);
-    iter->Seek(k);
-    if(iter->Valid()){
-        Slice hanlde_value = iter->value();
-        FilterBlockReader* filter = rep->filter;
+uint64_t Table::CacheId() const { return rep_->cache_id;}
+
+bool Table::HasBlobValues() const { return rep_->blob_values;}
+
+Status Table::PrefetchBlocks(const std::vector<uint64_t>& offsets,RateLimiter* limiter){
+    Cache* block_cache = rep_->options.block_cache;
+    if(block_cache==nullptr){
+        return Status::NotSupported("table has no block cache");
+    }
+    //扫描一遍index block，建立block offset到index value的映射
+    std::map<uint64_t,std::string> handles;
+    Iterator* index_iter = NewIndexIterator(ReadOptions());
+    for(index_iter->SeekToFirst();index_iter->Valid();index_iter->Next()){
         BlockHandle handle;
-        if(filter!=nullptr && handle.DecodeFrom(&handle_value).ok()&& !filter->KeyNayMatch(handle.offset(),k)){
+        Slice input = index_iter->value();
+        if(handle.DecodeFrom(&input).ok()){
+            handles[handle.offset()] = index_iter->value().ToString();
+        }
+    }
+    Status s = index_iter->status();
+    delete index_iter;
+
+    //不在cache中的block按批一次提交，减少等待I/O的次数
+    std::vector<BlockHandle> missing;
+    for(size_t i=0;s.ok() && i<offsets.size();i++){
+        std::map<uint64_t,std::string>::const_iterator it = handles.find(offsets[i]);
+        if(it==handles.end()){
+            //文件被重写过或预热文件已过期，忽略
+            continue;
+        }
+        char cache_key_buffer[16];
+        EncodeFixed64(cache_key_buffer,rep_->cache_id);
+        EncodeFixed64(cache_key_buffer+8,offsets[i]);
+        Cache::Handle* cache_handle = block_cache->Lookup(Slice(cache_key_buffer,sizeof(cache_key_buffer)));
+        if(cache_handle!=nullptr){
+            block_cache->Release(cache_handle);
+            continue;
+        }
+        BlockHandle handle;
+        Slice input = it->second;
+        if(handle.DecodeFrom(&input).ok()){
+            missing.push_back(handle);
+        }
+    }
+
+    static const size_t kPrefetchBatch = 16;
+    //预热在后台线程中进行，校验checksum(以及解压)的开销不落在前台读取上，之后要求校验的读取命中时不再校验
+    ReadOptions opt;
+    opt.verify_checksums = true;
+    BlockContents contents[kPrefetchBatch];
+    Status statuses[kPrefetchBatch];
+    for(size_t start=0;s.ok() && start<missing.size();start+=kPrefetchBatch){
+        const size_t num = std::min(kPrefetchBatch,missing.size()-start);
+        if(limiter!=nullptr){
+            size_t bytes = 0;
+            for(size_t i=0;i<num;i++){
+                bytes += missing[start+i].size()+kBlockTrailerSize;
+            }
+            limiter->Request(bytes);
+        }
+        MultiReadBlock(rep_->file,opt,&missing[start],num,contents,statuses,rep_->compression_dict);
+        for(size_t i=0;i<num;i++){
+            if(!statuses[i].ok()){
+                if(s.ok()) s = statuses[i];
+                continue;
+            }
+            Block* block = new Block(contents[i]);
+            Cache::Handle* cache_handle = CacheBlock(opt,missing[start+i].offset(),block,contents[i]);
+            if(cache_handle!=nullptr){
+                block_cache->Release(cache_handle);
+            }else{
+                //直接指向文件内存的block不需要缓存
+                delete block;
+            }
+        }
+    }
+    return s;
+}
+
+//block cache中缓存的filter分区
+struct FilterPartition{
+    explicit FilterPartition(const BlockContents& c):contents(c){}
+    ~FilterPartition(){
+        if(contents.heap_allocated){
+            delete[] contents.data.data();
+        }
+    }
+    BlockContents contents;
+};
+
+static void DeleteCachedFilterPartition(const Slice& key,void* value){
+    delete reinterpret_cast<FilterPartition*>(value);
+}
+
+bool Table::FullFilterMayMatch(const ReadOptions& options,const Slice& k){
+    if(rep_->filter_layout==kFullFilter){
+        return rep_->options.filter_policy->KeyMayMatch(k,rep_->full_filter);
+    }
+    if(rep_->filter_layout!=kPartitionedFilter || rep_->filter_index==nullptr){
+        return true;
+    }
+    Iterator* piter = rep_->filter_index->NewIterator(rep_->options.comparator);
+    piter->Seek(k);
+    bool may_match;
+    if(piter->Valid()){
+        may_match = PartitionMayMatch(options,piter->value(),k);
+    }else{
+        //k大于table中所有的key；分区索引出错时认为可能匹配
+        may_match = !piter->status().ok();
+    }
+    delete piter;
+    return may_match;
+}
+
+bool Table::PartitionMayMatch(const ReadOptions& options,const Slice& partition_handle_value,const Slice& k){
+    Slice input = partition_handle_value;
+    BlockHandle handle;
+    if(!handle.DecodeFrom(&input).ok()){
+        return true;
+    }
+    Cache* block_cache = rep_->options.block_cache;
+    Cache::Handle* cache_handle = nullptr;
+    FilterPartition* partition = nullptr;
+    char cache_key_buffer[16];
+    EncodeFixed64(cache_key_buffer,rep_->cache_id);
+    EncodeFixed64(cache_key_buffer+8,handle.offset());
+    Slice key(cache_key_buffer,sizeof(cache_key_buffer));
+    if(block_cache!=nullptr){
+        cache_handle = block_cache->Lookup(key);
+        if(cache_handle!=nullptr){
+            partition = reinterpret_cast<FilterPartition*>(block_cache->Value(cache_handle));
+        }
+    }
+    if(partition==nullptr){
+        BlockContents contents;
+        if(!ReadBlock(rep_->file,options,handle,&contents).ok()){
+            //读取失败时认为可能匹配，交给data block读取报错
+            return true;
+        }
+        partition = new FilterPartition(contents);
+        if(block_cache!=nullptr && contents.cachable && options.fill_cache){
+            cache_handle = block_cache->Insert(key,partition,contents.data.size(),&DeleteCachedFilterPartition);
+        }
+    }
+    const bool may_match = rep_->options.filter_policy->KeyMayMatch(k,partition->contents.data);
+    if(cache_handle!=nullptr){
+        block_cache->Release(cache_handle);
+    }else{
+        delete partition;
+    }
+    return may_match;
+}
+
+bool Table::PrefixMayMatch(const ReadOptions& options,const Slice& target){
+    const SliceTransform* extractor = rep_->options.prefix_extractor;
+    if(!rep_->prefix_filtering || !extractor->InDomain(target)){
+        return true;
+    }
+    //前缀不大于任何以它开头的key，在分区索引中同样能定位到包含该前缀的分区
+    return FullFilterMayMatch(options,extractor->Transform(target));
+}
+
+//合并读取时单次读取的上限，readahead_size更大时以readahead_size为上限，预读窗口不被拆成多次读取
+static const uint64_t kMaxCoalescedReadBytes = 256*1024;
+
+Status Table::ReadBlocks(const ReadOptions& options,const BlockHandle* handles,size_t num,
+                         Block** blocks,Cache::Handle** cache_handles) const{
+    Status s;
+    //1.查找block cache，记录未命中的block
+    std::vector<size_t> misses;
+    for(size_t i=0;i<num;i++){
+        blocks[i] = LookupBlock(options,handles[i].offset(),&cache_handles[i]);
+        if(blocks[i]==nullptr){
+            misses.push_back(i);
+        }
+    }
 
+    //2.文件中相邻的未命中block合并成一次读取，所有读取一次提交
+    const bool zero_copy = rep_->file->SupportsZeroCopy();
+    const uint64_t max_read_bytes = std::max<uint64_t>(kMaxCoalescedReadBytes,options.readahead_size);
+    std::vector<ReadRequest> reqs;
+    std::vector<size_t> span_start;//每个读取覆盖misses[span_start[k],span_start[k+1])
+    for(size_t i=0;i<misses.size();){
+        const BlockHandle& first = handles[misses[i]];
+        uint64_t end = first.offset() + first.size() + kBlockTrailerSize;
+        size_t j = i+1;
+        while(j<misses.size()){
+            const BlockHandle& next = handles[misses[j]];
+            const uint64_t next_end = next.offset() + next.size() + kBlockTrailerSize;
+            if(next.offset()!=end || next_end-first.offset()>max_read_bytes) break;
+            end = next_end;
+            j++;
+        }
+        ReadRequest req;
+        req.offset = first.offset();
+        req.len = static_cast<size_t>(end-first.offset());
+        req.scratch = zero_copy ? nullptr : new char[req.len];
+        reqs.push_back(req);
+        span_start.push_back(i);
+        i = j;
+    }
+    span_start.push_back(misses.size());
+    if(!reqs.empty()){
+        rep_->file->MultiRead(reqs.data(),reqs.size());
+    }
+    for(size_t k=0;k<reqs.size();k++){
+        const ReadRequest& req = reqs[k];
+        Status rs = req.status;
+        if(rs.ok() && req.result.size()!=req.len){
+            rs = Status::Corruption("truncated block read");
+        }
+        for(size_t m=span_start[k];rs.ok() && m<span_start[k+1];m++){
+            const size_t i = misses[m];
+            const size_t n = static_cast<size_t>(handles[i].size());
+            Slice raw(req.result.data()+(handles[i].offset()-req.offset),n+kBlockTrailerSize);
+            //合并读取的缓冲区是共享的，未压缩的block拷贝一份以便独立缓存；零拷贝文件直接引用文件内存
+            char* buf = nullptr;
+            if(!zero_copy && raw[n]==kNoCompression){
+                buf = new char[raw.size()];
+                memcpy(buf,raw.data(),raw.size());
+                raw = Slice(buf,raw.size());
+            }
+            BlockContents contents;
+            ReadOptions scratch;
+            const ReadOptions& read_options = DataBlockReadOptions(options,handles[i].offset(),&scratch);
+            Status bs = FinishReadBlock(read_options,handles[i],raw,buf,&contents,rep_->compression_dict);
+            if(!bs.ok()){
+                if(s.ok()) s = bs;
+                continue;
+            }
+            if(&read_options!=&options) contents.checksum_verified = true;
+            blocks[i] = new Block(contents);
+            cache_handles[i] = CacheBlock(options,handles[i].offset(),blocks[i],contents);
+        }
+        if(s.ok() && !rs.ok()){
+            s = rs;
+        }
+        delete[] req.scratch;
+    }
+    return s;
+}
+
+Iterator* Table::NewBlockIterator(Block* block,Cache::Handle* cache_handle) const{
+    //不在block cache中的block只用一次，建立重启点key的缓存得不偿失
+    Iterator* iter = block->NewIterator(rep_->options.comparator,
+                                        rep_->options.block_restart_key_cache && cache_handle!=nullptr,
+                                        rep_->options.block_prev_cache);
+    if(cache_handle==nullptr){
+        iter->RegisterCleanup(&DeleteBlock,block,nullptr);
+    }else{
+        iter->RegisterCleanup(&ReleaseBlock,rep_->options.block_cache,cache_handle);
+    }
+    return iter;
+}
+
+void Table::BlockPrefetcher(void* arg,const ReadOptions& options,const std::vector<std::string>& index_values,
+                            std::vector<Iterator*>* iters){
+    Table* table = reinterpret_cast<Table*>(arg);
+    if(table->rep_->file->SupportsZeroCopy()){
+        //直接映射的文件交给操作系统预读
+        return;
+    }
+    //至少读取第一个block，之后的block总大小不超过readahead_size
+    std::vector<BlockHandle> handles;
+    uint64_t bytes = 0;
+    for(size_t i=0;i<index_values.size();i++){
+        BlockHandle handle;
+        Slice input = index_values[i];
+        if(!handle.DecodeFrom(&input).ok()) break;
+        bytes += handle.size() + kBlockTrailerSize;
+        if(!handles.empty() && bytes>options.readahead_size) break;
+        handles.push_back(handle);
+    }
+    const size_t num = handles.size();
+    std::vector<Block*> blocks(num,nullptr);
+    std::vector<Cache::Handle*> cache_handles(num,nullptr);
+    if(num>0){
+        table->ReadBlocks(options,handles.data(),num,blocks.data(),cache_handles.data());
+    }
+    //读取失败的block及其之后的block不返回，由block_function重新读取并报告错误
+    bool failed = false;
+    for(size_t i=0;i<num;i++){
+        failed = failed || blocks[i]==nullptr;
+        if(!failed){
+            iters->push_back(table->NewBlockIterator(blocks[i],cache_handles[i]));
+        }else if(cache_handles[i]!=nullptr){
+            table->rep_->options.block_cache->Release(cache_handles[i]);
         }else{
-             Iterator* block_iter = BlockReader(this, options, iiter->value());
-            block_iter->Seek(k);
-            if (block_iter->Valid()) {
-                (*handle_result)(arg, block_iter->key(), block_iter->value());
+            delete blocks[i];
+        }
+    }
+}
+
+Status Table::MultiGet(const ReadOptions& options,const Slice* keys,size_t num,void* arg,
+                       void(*handle_result)(void* arg,size_t index,const Slice& k,const Slice& v)){
+    //落在同一个data block中的一组key
+    struct BlockGroup{
+        BlockHandle handle;
+        std::vector<size_t> keys;
+    };
+    const Comparator* comparator = rep_->options.comparator;
+    std::vector<BlockGroup> groups;
+    Status s;
+    LoadFilter();
+
+    //1.按顺序走一遍index，把key分到data block
+    Iterator* iiter = NewIndexIterator(options);
+    for(size_t i=0;i<num;i++){
+        assert(i==0 || comparator->Compare(keys[i-1],keys[i])<=0);
+        if(!FullFilterMayMatch(options,keys[i])){
+            continue;
+        }
+        //当前data block的上界不小于key时key也在该block中，不必重新查找
+        if(!iiter->Valid() || comparator->Compare(iiter->key(),keys[i])<0){
+            iiter->Seek(keys[i]);
+            if(!iiter->Valid()){
+                //剩下的key都大于table中所有的key
+                break;
+            }
+        }
+        BlockHandle handle;
+        Slice input = iiter->value();
+        s = handle.DecodeFrom(&input);
+        if(!s.ok()){
+            break;
+        }
+        if(rep_->filter!=nullptr && !rep_->filter->KeyMayMatch(handle.offset(),keys[i])){
+            continue;
+        }
+        if(groups.empty() || groups.back().handle.offset()!=handle.offset()){
+            groups.push_back(BlockGroup{handle,std::vector<size_t>()});
+        }
+        groups.back().keys.push_back(i);
+    }
+    if(s.ok()){
+        s = iiter->status();
+    }
+    delete iiter;
+
+    //2.读取所有涉及的block
+    std::vector<BlockHandle> handles(groups.size());
+    std::vector<Block*> blocks(groups.size(),nullptr);
+    std::vector<Cache::Handle*> cache_handles(groups.size(),nullptr);
+    for(size_t g=0;g<groups.size();g++){
+        handles[g] = groups[g].handle;
+    }
+    if(s.ok() && !groups.empty()){
+        s = ReadBlocks(options,handles.data(),groups.size(),blocks.data(),cache_handles.data());
+    }
+
+    //3.每个block只建立一个迭代器，回答其中的所有key
+    Cache* block_cache = rep_->options.block_cache;
+    for(size_t g=0;g<groups.size();g++){
+        const BlockGroup& group = groups[g];
+        if(blocks[g]==nullptr){
+            continue;
+        }
+        Iterator* block_iter = blocks[g]->NewIterator(comparator,rep_->options.block_restart_key_cache);
+        std::string blob;
+        for(size_t i=0;i<group.keys.size();i++){
+            const size_t index = group.keys[i];
+            if(!blocks[g]->SeekForGet(block_iter,keys[index]) || !block_iter->Valid()){
+                continue;
+            }
+            Slice value = block_iter->value();
+            if(!rep_->blob_values){
+                (*handle_result)(arg,index,block_iter->key(),value);
+            }else if(MatchesTarget(block_iter->key(),keys[index])){
+                //只读取匹配的entry的blob
+                Status bs = ResolveValue(options,&value,&blob);
+                if(bs.ok()){
+                    (*handle_result)(arg,index,block_iter->key(),value);
+                }else if(s.ok()){
+                    s = bs;
+                }
             }
+        }
+        if(s.ok()){
             s = block_iter->status();
-            delete block_iter;
+        }
+        delete block_iter;
+        if(cache_handles[g]!=nullptr){
+            block_cache->Release(cache_handles[g]);
+        }else{
+            delete blocks[g];
+        }
+    }
+    return s;
+}
+
+Status Table::InternalGet(const ReadOptions& options,const Slice& k,void* arg,void(*handle_result)(void*,const Slice&,const Slice&)){
+    Status s;
+    LoadFilter();
+    //全表filter只需要探测一次，不必查找index block
+    if(!FullFilterMayMatch(options,k)){
+        return s;
+    }
+    Iterator* iiter = NewIndexIterator(options);
+    iiter->Seek(k);
+    if(iiter->Valid()){
+        Slice handle_value = iiter->value();
+        FilterBlockReader* filter = rep_->filter;
+        BlockHandle handle;
+        s = handle.DecodeFrom(&handle_value);
+        if(!s.ok() || (filter!=nullptr && !filter->KeyMayMatch(handle.offset(),k))){
+            //handle损坏，或filter判断key不在该data block中，不必读取
+        }else{
+            Block* block = nullptr;
+            Cache::Handle* cache_handle = nullptr;
+            s = ReadDataBlock(options,handle,&block,&cache_handle);
+            if(block!=nullptr){
+                Iterator* block_iter = NewBlockIterator(block,cache_handle);
+                //有hash索引时直接定位重启区间，或者确定key不在block中
+                if(block->SeekForGet(block_iter,k) && block_iter->Valid()){
+                    Slice value = block_iter->value();
+                    std::string blob;
+                    if(!rep_->blob_values){
+                        (*handle_result)(arg, block_iter->key(), value);
+                    }else if(MatchesTarget(block_iter->key(),k)){
+                        //不匹配的entry不交给调用者，避免读取无关的blob
+                        s = ResolveValue(options,&value,&blob);
+                        if(s.ok()){
+                            (*handle_result)(arg, block_iter->key(), value);
+                        }
+                    }
+                }
+                if(s.ok()){
+                    s = block_iter->status();
+                }
+                delete block_iter;
+            }
         }
     }
     if (s.ok()) {
-    s = iiter->status();
-  }
-  delete iiter;
-  return s;
+        s = iiter->status();
+    }
+    delete iiter;
+    return s;
 }
 
 } // namespace leveldb
@@ -1,19 +1,39 @@
 #pragma once
 #include<stdint.h>
+#include<algorithm>
+#include<map>
+#include<utility>
+#include<vector>
 #include "util/options.h"
 #include "util/status.h"
 #include "util/coding.h"
 #include "util/crc32c.h"
+#include "util/compression.h"
+#include "table/blob_file.h"
 #include "table/block_builder.h"
 #include "util/options.h"
 #include "table/format.h"
 #include "util/comparator.h"
+#include "util/env.h"
+#include "util/filter_policy.h"
+#include "table/filter_block.h"
+#include "util/slice_transform.h"
 
 namespace leveldb{
     
 class BlockBuilder;
 class BlockHandle;
 class WritableFile;
+
+//TableBuilder中需要压缩的block的统计
+struct TableCompressionStats{
+    uint64_t compressed_blocks = 0;//压缩后写入
+    uint64_t rejected_blocks = 0;//尝试压缩但节省不足12.5%或者压缩失败，按不压缩写入
+    uint64_t skipped_blocks = 0;//options.adaptive_compression判断数据不可压缩，没有尝试压缩
+    uint64_t raw_bytes = 0;//这些block压缩前的大小
+    uint64_t written_bytes = 0;//这些block实际写入的大小(不含trailer)
+};
+
 class TableBuilder{
 public:
     TableBuilder(const Options& options,WritableFile* file);
@@ -22,17 +42,34 @@ public:
     ~TableBuilder();
 
     Status ChangeOptions(const Options& options);
+    //options.min_blob_size>0时value写入blob_file，必须在第一次Add之前设置；不持有blob_file
+    //没有设置时所有value都保存在sstable中
+    void SetBlobFile(BlobFileBuilder* blob_file);
     void Add(const Slice& key,const Slice& value);
+    //options.min_blob_size>0时直接加入已有的blob引用，重写table时不必重新写入blob
+    void AddBlobReference(const Slice& key,const BlobIndex& index);
     void Flush();
     Status Finish();
     Status status() const;
     void Abandon();
     uint64_t NumEntries() const;
     uint64_t FileSize() const;
+    TableCompressionStats CompressionStats() const;
 private:
     bool ok() const { return status().ok();}
-    void WriteBlock(BlockBuilder* block,BlockHandle* handle);
+    //把编码后的value加入data block
+    void AddEntry(const Slice& key,const Slice& value);
+    //use_dict为true时用压缩字典压缩，只用于读取时经过Table::ReadBlocks等的data block和index分区
+    void WriteBlock(BlockBuilder* block,BlockHandle* handle,bool use_dict=false);
+    //按options.compression压缩后写入，压缩率不足12.5%或者压缩失败时不压缩
+    void CompressAndWriteBlock(const Slice& raw,const Slice& dict,BlockHandle* handle);
     void WriteRawBlock(const Slice& data,CompressionType,BlockHandle* handle);
+    //用缓存的data block训练压缩字典，然后依次压缩写入
+    void WriteBufferedBlocks();
+    //options.adaptive_compression时记录一次尝试压缩的结果，必要时开始跳过压缩
+    void UpdateCompressionRatio(double ratio,bool accepted);
+    //把key->handle加入index block，kPartitionedIndex时加入当前index分区
+    void AddIndexEntry(const Slice& key,const BlockHandle& handle);
 
     struct Rep;
     Rep* rep_;
@@ -40,7 +77,7 @@ private:
 
 struct TableBuilder::Rep{
     Rep(const Options& opt,WritableFile* f):
-        Options(opt),
+        options(opt),
         index_block_options(opt),
         file(f),
         offset(0),
@@ -48,9 +85,35 @@ struct TableBuilder::Rep{
         index_block(&index_block_options),
         num_entries(0),
         closed(false),
-        filter_block(opt.filter_policy==nullptr?nullptr:new FilterBlockBuilder(opt.filter_policy)),
-        pending_index_entry(false){
+        filter_block(nullptr),
+        full_filter_block(nullptr),
+        pending_index_entry(false),
+        compressor(GetCompressor(opt.compression)),
+        buffering(false),
+        buffered_bytes(0),
+        compression_ratio(0),
+        compression_backoff(0),
+        blocks_to_skip(0),
+        blob_values(opt.min_blob_size>0),
+        blob_file(nullptr){
             index_block_options.block_restart_interval=1;
+            index_block_options.data_block_hash_index=false;
+            if(opt.filter_policy!=nullptr){
+                switch(opt.filter_layout){
+                    case kBlockBasedFilter:
+                        filter_block = new FilterBlockBuilder(opt.filter_policy,opt.prefix_extractor);
+                        break;
+                    case kFullFilter:
+                        full_filter_block = new FullFilterBlockBuilder(opt.filter_policy,0,opt.prefix_extractor);
+                        break;
+                    case kPartitionedFilter:
+                        full_filter_block = new FullFilterBlockBuilder(opt.filter_policy,
+                            opt.filter_partition_keys>0 ? opt.filter_partition_keys : 1,opt.prefix_extractor);
+                        break;
+                }
+            }
+            buffering = compressor!=nullptr && compressor->SupportsDictionary() &&
+                        opt.compression_dict_bytes>0 && filter_block==nullptr;
         }
     
     Options options;//data block的选项
@@ -64,10 +127,38 @@ struct TableBuilder::Rep{
     int64_t num_entries; //当前data block的个数，初始0
     bool closed;//调用了Finsh() or Abandon(),初始false
     FilterBlockBuilder* filter_block;//根据filter数据快速定位key是否在block中
+    FullFilterBlockBuilder* full_filter_block;//全表或分区filter，与filter_block最多一个不为空
     bool pending_index_entry;//见下面的Add函数，初始false
     BlockHandle pending_handle;//添加到index block的data block的信息
+    //kPartitionedIndex时的index分区及其最后一个key，Finish时写入文件，index_block作为分区的顶层索引
+    std::vector<std::pair<std::string,BlockBuilder*>> index_partitions;
     std::string compressed_output;//压缩后的data block,临时存储，写入后即被清空
+    const Compressor* compressor;//options.compression对应的压缩算法，不压缩时为nullptr
+    //训练压缩字典之前data block暂存在buffered_blocks中，还没有写入文件
+    bool buffering;
+    std::vector<std::string> buffered_blocks;
+    std::vector<std::string> buffered_index_keys;//buffered_blocks[i]的index key，最后一个block的可能还未确定
+    size_t buffered_bytes;
+    std::string compression_dict;//data block和index分区使用的压缩字典，为空时不使用
+    TableCompressionStats compression_stats;
+    //options.adaptive_compression: 最近尝试压缩的block的压缩后/压缩前大小之比的滑动平均，
+    //某个block的压缩被拒绝且平均值超过7/8时跳过接下来的compression_backoff个block，之后再尝试一次；仍不可压缩时间隔加倍
+    double compression_ratio;
+    uint32_t compression_backoff;
+    uint32_t blocks_to_skip;
+    //options.min_blob_size>0时每个value带类型字节，blob_value是当前value的编码
+    bool blob_values;
+    BlobFileBuilder* blob_file;
+    std::string blob_value;
 };
+
+//adaptive_compression时连续跳过压缩的block数的初始值和上限
+static const uint32_t kInitialCompressionBackoff = 4;
+static const uint32_t kMaxCompressionBackoff = 64;
+
+//训练字典的样本大小与字典大小之比
+static const size_t kCompressionDictSampleRatio = 100;
+
 TableBuilder::TableBuilder(const Options& options,WritableFile* file)
     : rep_(new Rep(options,file)){
     if(rep_->filter_block != nullptr){
@@ -76,7 +167,11 @@ TableBuilder::TableBuilder(const Options& options,WritableFile* file)
 }
 TableBuilder::~TableBuilder(){
     assert(rep_->closed);
+    for(size_t i=0;i<rep_->index_partitions.size();i++){
+        delete rep_->index_partitions[i].second;
+    }
     delete rep_->filter_block;
+    delete rep_->full_filter_block;
     delete rep_;
 }
 Status TableBuilder::ChangeOptions(const Options& options){
@@ -86,10 +181,45 @@ Status TableBuilder::ChangeOptions(const Options& options){
     rep_->options = options;
     rep_->index_block_options = options;
     rep_->index_block_options.block_restart_interval = 1;
+    rep_->index_block_options.data_block_hash_index = false;
+    rep_->compressor = GetCompressor(options.compression);
     return Status::OK();
 }
 
+void TableBuilder::SetBlobFile(BlobFileBuilder* blob_file){
+    assert(rep_->num_entries==0);
+    rep_->blob_file = blob_file;
+}
+
 void TableBuilder::Add(const Slice& key,const Slice& value){
+    Rep* r = rep_;
+    if(!r->blob_values){
+        AddEntry(key,value);
+        return;
+    }
+    assert(!r->closed);
+    if(!ok()) return;
+    r->blob_value.clear();
+    if(r->blob_file!=nullptr && r->options.min_blob_size>0 && value.size()>=r->options.min_blob_size){
+        BlobIndex index;
+        r->status = r->blob_file->Add(value,&index);
+        if(!ok()) return;
+        EncodeBlobReference(index,&r->blob_value);
+    }else{
+        EncodeInlineValue(value,&r->blob_value);
+    }
+    AddEntry(key,r->blob_value);
+}
+
+void TableBuilder::AddBlobReference(const Slice& key,const BlobIndex& index){
+    Rep* r = rep_;
+    assert(r->blob_values);
+    r->blob_value.clear();
+    EncodeBlobReference(index,&r->blob_value);
+    AddEntry(key,r->blob_value);
+}
+
+void TableBuilder::AddEntry(const Slice& key,const Slice& value){
     Rep* r= rep_;
     assert(!r->closed);
     if(!ok()) return;
@@ -101,14 +231,19 @@ void TableBuilder::Add(const Slice& key,const Slice& value){
     if(r->pending_index_entry){
         assert(r->data_block.empty());
         r->options.comparator->FindShortestSeparator(& r->last_key,key);
-        std::string handle_encoding;
-        r->pending_handle.EncodeTo(&handle_encoding);
-        r->index_block.Add(r->last_key,Slice(handle_encoding));
+        if(r->buffering){
+            r->buffered_index_keys.push_back(r->last_key);
+        }else{
+            AddIndexEntry(r->last_key,r->pending_handle);
+        }
         r->pending_index_entry = false;
     }
     if(r->filter_block != nullptr){
         r->filter_block->AddKey(key);
     }
+    if(r->full_filter_block != nullptr){
+        r->full_filter_block->AddKey(key);
+    }
 
     //设置r->last_key = key,将(key,value)添加到r->data_block中，并更新entry数。
     r->last_key.assign(key.data(),key.size());
@@ -127,62 +262,143 @@ void TableBuilder::Flush(){
     if(!ok())return;
     if(r->data_block.empty())return;
     assert(!r->pending_index_entry);//保证pending_index_entry为false,即data block的Add已经完成
-    WriteBlock(&r->data_block,&r->pending_handle);
-    if(ok()){
+    if(r->buffering){
+        const Slice raw = r->data_block.Finish();
+        r->buffered_blocks.push_back(raw.ToString());
+        r->buffered_bytes += raw.size();
+        r->data_block.Reset();
         r->pending_index_entry = true;
-        r->status = r->file->Flush();
+    }else{
+        //不在每个block之后Flush，数据留在文件的写缓冲中，写满或Finish时才写入内核
+        WriteBlock(&r->data_block,&r->pending_handle,true);
+        if(ok()){
+            r->pending_index_entry = true;
+        }
     }
     if(r->filter_block!=nullptr){
         r->filter_block->StartBlock(r->offset);//将data_block在sstable中的偏移加入到filter block中，并指明开始新的data block
     }
+    if(r->full_filter_block!=nullptr){
+        r->full_filter_block->FinishDataBlock();
+    }
+    if(r->buffering && r->buffered_bytes>=r->options.compression_dict_bytes*kCompressionDictSampleRatio){
+        WriteBufferedBlocks();
+    }
+}
+
+void TableBuilder::WriteBufferedBlocks(){
+    Rep* r = rep_;
+    r->buffering = false;
+    if(r->compressor!=nullptr && r->compressor->SupportsDictionary() && !r->buffered_blocks.empty()){
+        std::vector<Slice> samples(r->buffered_blocks.begin(),r->buffered_blocks.end());
+        if(!r->compressor->TrainDictionary(samples,r->options.compression_dict_bytes,&r->compression_dict)){
+            r->compression_dict.clear();
+        }
+    }
+    for(size_t i=0;ok() && i<r->buffered_blocks.size();i++){
+        BlockHandle handle;
+        CompressAndWriteBlock(r->buffered_blocks[i],r->compression_dict,&handle);
+        if(!ok()){
+            break;
+        }
+        if(i<r->buffered_index_keys.size()){
+            AddIndexEntry(r->buffered_index_keys[i],handle);
+        }else{
+            //最后一个block的index key要等下一个key加入时才能确定
+            r->pending_handle = handle;
+        }
+    }
+    std::vector<std::string>().swap(r->buffered_blocks);
+    std::vector<std::string>().swap(r->buffered_index_keys);
+    r->buffered_bytes = 0;
 }
 
-void TableBuilder::WriteBlock(BlockBuilder* block,BlockHandle* handle){
+void TableBuilder::AddIndexEntry(const Slice& key,const BlockHandle& handle){
+    Rep* r = rep_;
+    std::string handle_encoding;
+    handle.EncodeTo(&handle_encoding);
+    if(r->options.index_layout!=kPartitionedIndex){
+        r->index_block.Add(key,Slice(handle_encoding));
+        return;
+    }
+    if(r->index_partitions.empty() ||
+       r->index_partitions.back().second->CurrentSizeEstimate()>=r->options.index_partition_size){
+        r->index_partitions.push_back(std::make_pair(std::string(),new BlockBuilder(&r->index_block_options)));
+    }
+    r->index_partitions.back().first.assign(key.data(),key.size());
+    r->index_partitions.back().second->Add(key,Slice(handle_encoding));
+}
+
+void TableBuilder::WriteBlock(BlockBuilder* block,BlockHandle* handle,bool use_dict){
     assert(ok());
     Rep* r = rep_;
     Slice raw = block->Finish();
-    Slice block_contents;
-    CompressionType type = r->options.compression;
-    switch(type){
-        case kNoCompression:
-            block_contents = raw;
-            break;
-        //采用Snappy压缩，Snappy是谷歌开源的压缩库
-        case kSnappyCompression:{
-           std::string* compressed = &r->compressed_output;
-           if (port::Snappy_Compress(raw.data(), raw.size(), compressed) &&
-                compressed->size() < raw.size() - (raw.size() / 8u)) {
+    CompressAndWriteBlock(raw,use_dict ? Slice(r->compression_dict) : Slice(),handle);
+    block->Reset();
+}
+void TableBuilder::CompressAndWriteBlock(const Slice& raw,const Slice& dict,BlockHandle* handle){
+    Rep* r = rep_;
+    Slice block_contents = raw;
+    CompressionType type = kNoCompression;
+    std::string* compressed = &r->compressed_output;
+    if(r->compressor!=nullptr){
+        TableCompressionStats* stats = &r->compression_stats;
+        stats->raw_bytes += raw.size();
+        if(r->options.adaptive_compression && r->blocks_to_skip>0){
+            //最近的数据不可压缩，不必尝试
+            r->blocks_to_skip--;
+            stats->skipped_blocks++;
+        }else{
+            const bool ok = r->compressor->Compress(raw,dict,compressed);
+            //压缩库不可用，或者压缩率不足12.5%时按不压缩写入
+            if(ok && compressed->size() < raw.size() - (raw.size() / 8u)){
                 block_contents = *compressed;
-            } else {
-                // Snappy not supported, or compressed(压缩比) less than 12.5%, so just
-                // store uncompressed form
-                block_contents = raw;
-                type = kNoCompression;
+                type = r->compressor->Type();
+                stats->compressed_blocks++;
+            }else{
+                stats->rejected_blocks++;
+            }
+            if(r->options.adaptive_compression){
+                //压缩后变大与不压缩一样，按1计算
+                const double ratio = raw.size()>0 && ok ? static_cast<double>(compressed->size())/raw.size() : 1.0;
+                UpdateCompressionRatio(std::min(ratio,1.0),type!=kNoCompression);
             }
-            break; 
         }
+        stats->written_bytes += block_contents.size();
     }
     WriteRawBlock(block_contents,type,handle);
     r->compressed_output.clear();
-    block->Reset();
+}
+
+void TableBuilder::UpdateCompressionRatio(double ratio,bool accepted){
+    Rep* r = rep_;
+    //前几个block的权重较大，之后逐渐平滑
+    const uint64_t probes = r->compression_stats.compressed_blocks+r->compression_stats.rejected_blocks;
+    const double weight = probes<4 ? 1.0/probes : 0.25;
+    r->compression_ratio += (ratio-r->compression_ratio)*weight;
+    //这次压缩有效，或者平均压缩率仍然足够时继续压缩
+    if(accepted || r->compression_ratio<0.875){
+        r->compression_backoff = 0;
+        return;
+    }
+    r->compression_backoff = r->compression_backoff==0 ? kInitialCompressionBackoff :
+                             std::min(r->compression_backoff*2,kMaxCompressionBackoff);
+    r->blocks_to_skip = r->compression_backoff;
 }
 void TableBuilder::WriteRawBlock(const Slice& block_contents,CompressionType type,BlockHandle* handle){
     Rep* r=rep_;
     handle->set_offset(r->offset);
     handle->set_size(block_contents.size());
-    r->status = r->file->Append(block_contents);
+    char trailer[kBlockTrailerSize];
+    trailer[0]=type;
+    uint32_t crc = crc32c::Value(block_contents.data(),block_contents.size());
+    crc = crc32c::Extend(crc,trailer,1);
+    EncodeFixed32(trailer+1,crc32c::Mask(crc));
+    //向block_data末尾加上type和校验和，这样就构成一个完成的Block；带缓冲的文件直接在缓冲区中拼接
+    r->status = r->file->AppendWithTrailer(block_contents,Slice(trailer,kBlockTrailerSize));
     if(r->status.ok()){
-        char trailer[kBlockTrailerSize];
-        trailer[0]=type;
-        uint32_t crc = crc32c::Value(block_contents.data(),block_contents.size());
-        crc = crc32c::Extend(crc,trailer,1);
-        EncodeFixed32(trailer+1,crc32c::Mask(crc));
-        //向block_data末尾加上type和校验和，这样就构成一个完成的Block
-        r->status = r->file->Append(Slice(trailer,kBlockTrailerSize));
-        if(r->status.ok()){
-            //新的block的偏移量应该加上type和校验和
-            r->offset += block_contents.size()+kBlockTrailerSize;
-        }
+        //新的block的偏移量应该加上type和校验和
+        r->offset += block_contents.size()+kBlockTrailerSize;
     }
 }
 //调用Finish函数，表明调用者将所有已经添加的K/V对持久化到sstable,并关闭sstable文件。
@@ -193,33 +409,111 @@ Status TableBuilder::Finish(){
     Flush();
     assert(!r->closed);
     r->closed = true;
+    //data block总量不足采样大小，用全部data block训练字典
+    if(ok() && r->buffering){
+        if(r->pending_index_entry){
+            r->options.comparator->FindShortSuccessor(&r->last_key);
+            r->buffered_index_keys.push_back(r->last_key);
+            r->pending_index_entry = false;
+        }
+        WriteBufferedBlocks();
+    }
     BlockHandle filter_block_handle,metaindex_block_handle,index_block_handle;
+    //metaindex block中的key必须有序
+    std::map<std::string,std::string> meta_entries;
     //2.写入filter block到文件中
-    if(ok() && r->filter_block != NULL){
+    if(ok() && r->filter_block != nullptr){
         //将filter_block的offset和size写入filter_block_handle中，并将filter_block写入sstable中
         WriteRawBlock(r->filter_block->Finish(),kNoCompression,&filter_block_handle);
+        if(ok()){
+            std::string handle_encoding;
+            filter_block_handle.EncodeTo(&handle_encoding);//将filter_block的offset和size编码到handle_encoding中
+            meta_entries[std::string("filter.") + r->options.filter_policy->Name()] = handle_encoding;
+        }
+    }
+    if(ok() && r->full_filter_block != nullptr){
+        FullFilterBlockBuilder* full = r->full_filter_block;
+        full->Finish();
+        if(r->options.filter_layout==kFullFilter && full->NumPartitions()>0){
+            WriteRawBlock(full->Partition(0),kNoCompression,&filter_block_handle);
+            if(ok()){
+                std::string handle_encoding;
+                filter_block_handle.EncodeTo(&handle_encoding);
+                meta_entries[std::string("fullfilter.") + r->options.filter_policy->Name()] = handle_encoding;
+            }
+        }else if(r->options.filter_layout==kPartitionedFilter && full->NumPartitions()>0){
+            //先写各个分区，再写分区索引
+            BlockBuilder partition_index(&r->index_block_options);
+            for(size_t i=0;ok() && i<full->NumPartitions();i++){
+                BlockHandle partition_handle;
+                WriteRawBlock(full->Partition(i),kNoCompression,&partition_handle);
+                std::string handle_encoding;
+                partition_handle.EncodeTo(&handle_encoding);
+                partition_index.Add(full->PartitionLastKey(i),handle_encoding);
+            }
+            if(ok()){
+                WriteBlock(&partition_index,&filter_block_handle);
+            }
+            if(ok()){
+                std::string handle_encoding;
+                filter_block_handle.EncodeTo(&handle_encoding);
+                meta_entries[std::string("partitionedfilter.") + r->options.filter_policy->Name()] = handle_encoding;
+            }
+        }
+    }
+    //filter中包含前缀时记录前缀的提取方式，读取时名字相同才能按前缀查filter
+    if(ok() && r->options.prefix_extractor!=nullptr && !meta_entries.empty()){
+        meta_entries["prefix.extractor"] = r->options.prefix_extractor->Name();
+    }
+    //最后一个data block的index entry
+    if(ok() && r->pending_index_entry){
+        r->options.comparator->FindShortSuccessor(&r->last_key);
+        AddIndexEntry(r->last_key,r->pending_handle);
+        r->pending_index_entry = false;
+    }
+    //index分区写在metaindex之前，顶层索引记录每个分区的最后一个key和位置
+    if(ok() && !r->index_partitions.empty()){
+        for(size_t i=0;ok() && i<r->index_partitions.size();i++){
+            BlockHandle partition_handle;
+            WriteBlock(r->index_partitions[i].second,&partition_handle,true);
+            if(ok()){
+                std::string handle_encoding;
+                partition_handle.EncodeTo(&handle_encoding);
+                r->index_block.Add(r->index_partitions[i].first,Slice(handle_encoding));
+            }
+        }
+        if(ok()){
+            std::string index_type;
+            PutFixed32(&index_type,kPartitionedIndex);
+            meta_entries["leveldb.index.type"] = index_type;
+        }
+    }
+    if(ok() && r->blob_values){
+        meta_entries["leveldb.blob.values"] = "";
+    }
+    //压缩字典，读取data block和index分区之前由Table::Open读入
+    if(ok() && !r->compression_dict.empty()){
+        BlockHandle dict_handle;
+        WriteRawBlock(r->compression_dict,kNoCompression,&dict_handle);
+        if(ok()){
+            std::string handle_encoding;
+            dict_handle.EncodeTo(&handle_encoding);
+            meta_entries["compression.dict"] = handle_encoding;
+        }
     }
     //3.写入metaindex block
     if(ok()){
-        BlockBuilder meta_index_block(&r->options);
-        if(r->filter_block!=nullptr){
-            std::string key = "filter.";
-            key.append(r->options.filter_policy->Name());
-            std::string handle_encoding;
-            filter_block_handle.EncodeTo(&handle_encoding);//将filter_block的offset和size编码到handle_encoding中
-            meta_index_block.Add(key,handle_encoding);//写入filter_block的信息
+        //hash索引只用于data block
+        Options meta_options = r->options;
+        meta_options.data_block_hash_index = false;
+        BlockBuilder meta_index_block(&meta_options);
+        for(std::map<std::string,std::string>::const_iterator it=meta_entries.begin();it!=meta_entries.end();++it){
+            meta_index_block.Add(it->first,it->second);
         }
         WriteBlock(&meta_index_block,&metaindex_block_handle);//将其他meta block写入文件，并将meta_block的offset和size写入metaindex_block_handle
     }
-    //4.写入index block,如果成功Flush过data block,那么需要维最后一块data block设置index block,并加入到index block中
+    //4.写入index block(kPartitionedIndex时为分区的顶层索引)，最后一块data block的index entry已经在前面加入
     if(ok()){
-        if(r->pending_index_entry){
-            r->options.comparator->FindShortSuccessor(&r->last_key);
-            std::string handle_encoding;
-            r->pending_handle.EncodeTo(&handle_encoding);
-            r->index_block.Add(r->last_key,Slice(handle_encoding));
-            r->pending_index_entry = false;
-        }
         //在向sstable写入index_block时，将index_block的offset和size写入index_block_handle中
         WriteBlock(&r->index_block,&index_block_handle);
     }
@@ -235,6 +529,10 @@ Status TableBuilder::Finish(){
             r->offset += footer_encoding.size();
         }
     }
+    //6.把写缓冲中剩余的数据写入文件，同步由调用者负责
+    if(ok()){
+        r->status = r->file->Flush();
+    }
     return r->status;
 }
 
@@ -245,5 +543,7 @@ void TableBuilder::Abandon(){
     r->closed = true;
 }
 uint64_t TableBuilder::NumEntries() const { return rep_->num_entries;}
-uint64_t TableBuilder::FileSize() const { return rep_->offset;}
+TableCompressionStats TableBuilder::CompressionStats() const { return rep_->compression_stats;}
+//训练字典前缓存的data block按未压缩的大小计入
+uint64_t TableBuilder::FileSize() const { return rep_->offset+rep_->buffered_bytes;}
 } // namespace leveldb
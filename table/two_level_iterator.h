@@ -6,18 +6,26 @@
 #include  "table/filter_block.h"
 #include  "util/coding.h"
 #include "table/iterator_wrapper.h"
+#include <deque>
+#include <utility>
+#include <vector>
 namespace leveldb{
+
+typedef Iterator* (*BlockFunction)(void*,const ReadOptions&,const Slice&);
+//一次读取index_values对应的多个block，(*iters)[i]为index_values[i]的迭代器，可以只返回前面的一部分
+typedef void (*PrefetchFunction)(void*,const ReadOptions&,const std::vector<std::string>& index_values,std::vector<Iterator*>* iters);
+
+//prefetch_function不为空时，顺序向后扫描会预读后续的block
 Iterator* NewTwoLevelIterator(
     Iterator* index_iter,
     Iterator* (*block_function)(void* arg,const ReadOptions& options,const Slice& index_value),
-    void* arg,const ReadOptions& options);
-
-typedef Iterator* (*BlockFunction)(void*,const ReadOptions&,const Slice&);
+    void* arg,const ReadOptions& options,PrefetchFunction prefetch_function=nullptr);
 
 class TwoLevelIterator:public Iterator{
 public:
-    TwoLevelIterator(Iterator* index_iter,BlockFunction block_function,void* arg,const ReadOptions& options);
-    ~TwoLevelIterator() override=default;
+    TwoLevelIterator(Iterator* index_iter,BlockFunction block_function,void* arg,const ReadOptions& options,
+                     PrefetchFunction prefetch_function);
+    ~TwoLevelIterator() override { ClearPrefetched();}
     void Seek(const Slice& target) override;
     void SeekToFirst() override;
     void SeekToLast() override;
@@ -50,8 +58,21 @@ private:
     void SkipEmptyDataBlocksForward();
     void SkipEmptyDataBlocksBackward();
     void SetDataIterator(Iterator* data_iter);
-    void InitDataBlock();
+    //forward为true表示从上一个block顺序移动到下一个block
+    void InitDataBlock(bool forward=false);
+    //从当前block开始一次读取readahead_blocks_个block放入prefetched_
+    void Readahead();
+    //取出预读的handle对应的迭代器，没有时返回nullptr；之前的预读block不会再用到，一并释放
+    Iterator* TakePrefetched(const Slice& handle);
+    void ClearPrefetched();
+
+    //连续向后移动这么多个block之后开始预读
+    static const int kReadaheadTrigger = 2;
+    static const size_t kInitialReadaheadBlocks = 2;
+    static const size_t kMaxReadaheadBlocks = 256;
+
     BlockFunction block_function_; //block操作函数
+    PrefetchFunction prefetch_function_;//为空时不预读
     void* arg_; //BlockFunction的自定义参数
     const ReadOptions options_;//BlockFunction的read option参数
     Status status_;//当前状态
@@ -59,14 +80,22 @@ private:
     IteratorWrapper data_iter_;//遍历block data的迭代器
     //如果data_iter_!=null,data_block_handle_保存的是传递给block_function的index value,以用来创建data_iter
     std::string data_block_handle_;
+    //预读的block，按index中的顺序保存index value和迭代器
+    std::deque<std::pair<std::string,Iterator*>> prefetched_;
+    int sequential_blocks_;//连续向后移动的block数
+    size_t readahead_blocks_;//下一次预读的block数
 
 };
-TwoLevelIterator::TwoLevelIterator(Iterator* index_iter,BlockFunction block_function,void* arg,const ReadOptions& options)
+TwoLevelIterator::TwoLevelIterator(Iterator* index_iter,BlockFunction block_function,void* arg,const ReadOptions& options,
+                                   PrefetchFunction prefetch_function)
     : block_function_(block_function),
+      prefetch_function_(options.readahead_size>0 ? prefetch_function : nullptr),
       arg_(arg),
       options_(options),
       index_iter_(index_iter),
-      data_iter_(nullptr){}
+      data_iter_(nullptr),
+      sequential_blocks_(0),
+      readahead_blocks_(kInitialReadaheadBlocks){}
 
 
 void TwoLevelIterator::Seek(const Slice& target){
@@ -102,13 +131,13 @@ void TwoLevelIterator::Prev() {
 }
 
 void TwoLevelIterator::SkipEmptyDataBlocksForward(){
-    while(data_iter_.iter()==nullptr || data_iter_.Valid()){
+    while(data_iter_.iter()==nullptr || !data_iter_.Valid()){
         if(!index_iter_.Valid()){
             SetDataIterator(nullptr);
             return;
         }
         index_iter_.Next();
-        InitDataBlock();
+        InitDataBlock(true);
         if(data_iter_.iter()!=nullptr) data_iter_.SeekToFirst();
     }
 }
@@ -129,7 +158,7 @@ void TwoLevelIterator::SetDataIterator(Iterator* data_iter){
     if(data_iter_.iter() !=nullptr)SaveError(data_iter_.status());
     data_iter_.Set(data_iter);
 }
-void TwoLevelIterator::InitDataBlock(){
+void TwoLevelIterator::InitDataBlock(bool forward){
     if(!index_iter_.Valid()){
         SetDataIterator(nullptr);
     }else{
@@ -137,7 +166,21 @@ void TwoLevelIterator::InitDataBlock(){
         if(data_iter_.iter() != nullptr && handle.compare(data_block_handle_)==0){
 
         }else{
-            Iterator* iter = (*block_function_)(arg_,options_,handle);
+            if(forward){
+                sequential_blocks_++;
+            }else{
+                sequential_blocks_ = 0;
+                readahead_blocks_ = kInitialReadaheadBlocks;
+            }
+            Iterator* iter = TakePrefetched(handle);
+            if(iter==nullptr && prefetch_function_!=nullptr && sequential_blocks_>=kReadaheadTrigger){
+                Readahead();
+                handle = index_iter_.value();
+                iter = TakePrefetched(handle);
+            }
+            if(iter==nullptr){
+                iter = (*block_function_)(arg_,options_,handle);
+            }
             data_block_handle_.assign(handle.data(),handle.size());
             SetDataIterator(iter);
 
@@ -146,10 +189,59 @@ void TwoLevelIterator::InitDataBlock(){
 
 }
 
+void TwoLevelIterator::Readahead(){
+    std::vector<std::string> index_values;
+    index_values.push_back(index_iter_.value().ToString());
+    const std::string current_key = index_iter_.key().ToString();
+    while(index_values.size()<readahead_blocks_){
+        index_iter_.Next();
+        if(!index_iter_.Valid()) break;
+        index_values.push_back(index_iter_.value().ToString());
+    }
+    //index中的key互不相同，回到当前block
+    index_iter_.Seek(current_key);
+    if(!index_iter_.Valid() || index_iter_.value()!=Slice(index_values[0])){
+        return;
+    }
+    std::vector<Iterator*> iters;
+    (*prefetch_function_)(arg_,options_,index_values,&iters);
+    if(iters.empty()){
+        //不支持预读，之后不再尝试
+        prefetch_function_ = nullptr;
+        return;
+    }
+    for(size_t i=0;i<iters.size();i++){
+        prefetched_.emplace_back(index_values[i],iters[i]);
+    }
+    //整个窗口都读到了才扩大窗口，否则已经达到readahead_size
+    if(iters.size()==readahead_blocks_ && readahead_blocks_<kMaxReadaheadBlocks){
+        readahead_blocks_ *= 2;
+    }
+}
+
+Iterator* TwoLevelIterator::TakePrefetched(const Slice& handle){
+    while(!prefetched_.empty()){
+        std::pair<std::string,Iterator*> front = prefetched_.front();
+        prefetched_.pop_front();
+        if(handle==Slice(front.first)){
+            return front.second;
+        }
+        delete front.second;
+    }
+    return nullptr;
+}
+
+void TwoLevelIterator::ClearPrefetched(){
+    for(size_t i=0;i<prefetched_.size();i++){
+        delete prefetched_[i].second;
+    }
+    prefetched_.clear();
+}
+
 Iterator* NewTwoLevelIterator(Iterator* index_iter,
                               BlockFunction block_function, void* arg,
-                              const ReadOptions& options) {
-  return new TwoLevelIterator(index_iter, block_function, arg, options);
+                              const ReadOptions& options,PrefetchFunction prefetch_function) {
+  return new TwoLevelIterator(index_iter, block_function, arg, options, prefetch_function);
 }
 
     
@@ -0,0 +1,140 @@
+#include<iostream>
+#include<chrono>
+#include<cstdio>
+#include<string>
+#include "table/table_builder.h"
+#include "table/table.h"
+#include "util/compression.h"
+#include "util/env.h"
+#include "util/random.h"
+#include "test/table_test_util.h"
+
+//不可压缩与可压缩的数据交替出现时，比较普通压缩和自适应压缩尝试压缩的次数、耗时和table大小
+
+static const leveldb::CompressionType kRunLengthCompression = static_cast<leveldb::CompressionType>(0x12);
+
+//测试用的游程编码，记录被调用的次数
+class RunLengthCompressor:public leveldb::Compressor{
+public:
+    RunLengthCompressor():calls_(0){}
+    const char* Name() const override { return "test.RunLength";}
+    leveldb::CompressionType Type() const override { return kRunLengthCompression;}
+    bool Compress(const leveldb::Slice& input,const leveldb::Slice& dict,std::string* output) const override{
+        calls_++;
+        output->clear();
+        leveldb::PutFixed32(output,static_cast<uint32_t>(input.size()));
+        for(size_t i=0;i<input.size();){
+            size_t run = 1;
+            while(i+run<input.size() && run<255 && input[i+run]==input[i]) run++;
+            output->push_back(static_cast<char>(run));
+            output->push_back(input[i]);
+            i += run;
+        }
+        return true;
+    }
+    bool GetUncompressedLength(const leveldb::Slice& input,size_t* result) const override{
+        if(input.size()<4) return false;
+        *result = leveldb::DecodeFixed32(input.data());
+        return true;
+    }
+    bool Uncompress(const leveldb::Slice& input,const leveldb::Slice& dict,char* output,size_t output_length) const override{
+        size_t n = 0;
+        for(size_t i=4;i+1<input.size();i+=2){
+            const size_t run = static_cast<unsigned char>(input[i]);
+            if(n+run>output_length) return false;
+            memset(output+n,input[i+1],run);
+            n += run;
+        }
+        return n==output_length;
+    }
+    uint64_t calls() const { return calls_;}
+private:
+    mutable uint64_t calls_;
+};
+
+static std::string Key(int i){
+    char buf[32];
+    snprintf(buf,sizeof(buf),"key%08d",i);
+    return buf;
+}
+
+//[0,n/3)和[2n/3,n)的value是随机字节，中间一段是可压缩的重复字节
+static std::string Value(int i,int n){
+    if(i>=n/3 && i<2*n/3){
+        return std::string(200,'a'+i%26);
+    }
+    leveldb::Random rnd(i+1);
+    std::string v(200,'\0');
+    for(size_t j=0;j<v.size();j++){
+        v[j] = static_cast<char>(rnd.Uniform(256));
+    }
+    return v;
+}
+
+static bool Test(bool adaptive,RunLengthCompressor* compressor,size_t* table_size){
+    const int kNumKeys = 30000;
+    std::vector<std::string> values(kNumKeys);
+    for(int i=0;i<kNumKeys;i++){
+        values[i] = Value(i,kNumKeys);
+    }
+    leveldb::Options options;
+    options.comparator = leveldb::BytewiseComparator();
+    options.compression = kRunLengthCompression;
+    options.adaptive_compression = adaptive;
+    StringSink sink;
+    const uint64_t calls_before = compressor->calls();
+    auto start = std::chrono::steady_clock::now();
+    leveldb::TableBuilder builder(options,&sink);
+    for(int i=0;i<kNumKeys;i++){
+        builder.Add(Key(i),values[i]);
+    }
+    if(!builder.Finish().ok()) return false;
+    const double millis = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-start).count();
+    const leveldb::TableCompressionStats stats = builder.CompressionStats();
+    *table_size = sink.contents().size();
+    std::cout<<(adaptive ? "adaptive: " : "always:   ")<<millis<<" ms, "<<compressor->calls()-calls_before<<" compress calls, "
+             <<"compressed "<<stats.compressed_blocks<<", rejected "<<stats.rejected_blocks<<", skipped "<<stats.skipped_blocks
+             <<", "<<stats.raw_bytes<<" -> "<<stats.written_bytes<<" bytes, table "<<*table_size<<" bytes"<<std::endl;
+    if(compressor->calls()-calls_before!=stats.compressed_blocks+stats.rejected_blocks){
+        std::cout<<"compress calls do not match stats"<<std::endl;
+        return false;
+    }
+    if(!adaptive && stats.skipped_blocks!=0){
+        return false;
+    }
+
+    StringSource* source = new StringSource(sink.contents());
+    leveldb::Table* table = nullptr;
+    leveldb::Status s = leveldb::Table::Open(options,source,sink.contents().size(),&table);
+    bool ok = s.ok();
+    if(ok){
+        leveldb::Iterator* iter = table->NewIterator(leveldb::ReadOptions());
+        int count = 0;
+        for(iter->SeekToFirst();iter->Valid();iter->Next()){
+            if(iter->key()!=leveldb::Slice(Key(count)) || iter->value()!=leveldb::Slice(values[count])) break;
+            count++;
+        }
+        if(count!=kNumKeys || !iter->status().ok()){
+            std::cout<<"scan mismatch at "<<count<<std::endl;
+            ok = false;
+        }
+        delete iter;
+    }
+    delete table;
+    delete source;
+    return ok;
+}
+
+int main(){
+    static RunLengthCompressor compressor;
+    leveldb::RegisterCompressor(&compressor);
+    size_t always_size,adaptive_size;
+    if(!Test(false,&compressor,&always_size)) return 1;
+    if(!Test(true,&compressor,&adaptive_size)) return 1;
+    //重新尝试压缩的间隔有上限，可压缩的一段中只有开头少数block没有压缩
+    if(adaptive_size>always_size+always_size/20){
+        std::cout<<"adaptive compression missed too many compressible blocks"<<std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,168 @@
+#include<iostream>
+#include<atomic>
+#include<chrono>
+#include<cstdio>
+#include<fstream>
+#include<string>
+#include<vector>
+#include "table/block.h"
+#include "table/format.h"
+#include "table/table_builder.h"
+#include "util/async_file.h"
+#include "util/env_posix.h"
+#include "util/thread_pool.h"
+#include "test/table_test_util.h"
+
+//逐个同步读取、批量读取和异步读取sstable中所有data block，比较结果和耗时
+
+static void FreeContents(leveldb::BlockContents* contents){
+    if(contents->heap_allocated){
+        delete[] contents->data.data();
+    }
+}
+
+//异步读取的结果，回调可能在其他线程
+struct AsyncResult{
+    explicit AsyncResult(size_t n):blocks(n),remaining(n),errors(0){}
+    std::vector<std::string> blocks;
+    std::atomic<size_t> remaining;
+    std::atomic<int> errors;
+};
+
+struct AsyncArg{
+    AsyncResult* result;
+    size_t index;
+};
+
+static void OnBlockRead(void* arg,const leveldb::Status& s,leveldb::BlockContents* contents){
+    AsyncArg* a = reinterpret_cast<AsyncArg*>(arg);
+    if(s.ok()){
+        a->result->blocks[a->index] = contents->data.ToString();
+        FreeContents(contents);
+    }else{
+        a->result->errors++;
+    }
+    a->result->remaining--;
+}
+
+static double Micros(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now()-start).count();
+}
+
+int main(){
+    const std::string fname = "/tmp/leveldb_async_read_test.ldb";
+    {
+        leveldb::Options options;
+        options.comparator = leveldb::BytewiseComparator();
+        options.compression = leveldb::kNoCompression;
+        StringSink sink;
+        leveldb::TableBuilder builder(options,&sink);
+        char buf[32];
+        for(int i=0;i<100000;i++){
+            snprintf(buf,sizeof(buf),"key%010d",i);
+            builder.Add(buf,std::string(100,'a'+i%26));
+        }
+        builder.Finish();
+        std::ofstream out(fname,std::ios::binary | std::ios::trunc);
+        out.write(sink.contents().data(),sink.contents().size());
+    }
+    uint64_t file_size;
+    {
+        std::ifstream in(fname,std::ios::binary | std::ios::ate);
+        file_size = static_cast<uint64_t>(in.tellg());
+    }
+
+    leveldb::RandomAccessFile* file = nullptr;
+    leveldb::Status s = leveldb::NewPosixRandomAccessFile(fname,false,leveldb::kRandomAccess,&file);
+    //从footer和index block中取出所有data block的handle
+    std::vector<leveldb::BlockHandle> handles;
+    if(s.ok()){
+        char footer_space[leveldb::Footer::kEncodedLength];
+        leveldb::Slice footer_input;
+        s = file->Read(file_size-leveldb::Footer::kEncodedLength,leveldb::Footer::kEncodedLength,&footer_input,footer_space);
+        leveldb::Footer footer;
+        if(s.ok()) s = footer.DecodeFrom(&footer_input);
+        leveldb::BlockContents index_contents;
+        if(s.ok()) s = leveldb::ReadBlock(file,leveldb::ReadOptions(),footer.index_handle(),&index_contents);
+        if(s.ok()){
+            leveldb::Block index_block(index_contents);
+            leveldb::Iterator* iter = index_block.NewIterator(leveldb::BytewiseComparator());
+            for(iter->SeekToFirst();iter->Valid();iter->Next()){
+                leveldb::Slice input = iter->value();
+                leveldb::BlockHandle handle;
+                handle.DecodeFrom(&input);
+                handles.push_back(handle);
+            }
+            delete iter;
+        }
+    }
+    if(!s.ok()){
+        std::cout<<s.ToString()<<std::endl;
+        delete file;
+        return 1;
+    }
+    leveldb::ReadOptions read_options;
+    read_options.verify_checksums = true;
+    const size_t num = handles.size();
+
+    //逐个同步读取作为基准
+    std::vector<std::string> expected(num);
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i=0;i<num;i++){
+        leveldb::BlockContents contents;
+        s = leveldb::ReadBlock(file,read_options,handles[i],&contents);
+        if(!s.ok()) break;
+        expected[i] = contents.data.ToString();
+        FreeContents(&contents);
+    }
+    std::cout<<num<<" blocks, ReadBlock: "<<Micros(start)<<" us"<<std::endl;
+
+    leveldb::ThreadPool pool(8);
+    leveldb::RandomAccessFile* pooled = leveldb::NewThreadPoolRandomAccessFile(file,&pool);
+    leveldb::RandomAccessFile* files[] = {file,pooled};
+    const char* names[] = {"posix","thread pool"};
+    bool ok = s.ok();
+    for(int f=0;ok && f<2;f++){
+        std::vector<leveldb::BlockContents> results(num);
+        std::vector<leveldb::Status> statuses(num);
+        start = std::chrono::steady_clock::now();
+        leveldb::MultiReadBlock(files[f],read_options,handles.data(),num,results.data(),statuses.data());
+        const double multi_micros = Micros(start);
+        for(size_t i=0;i<num;i++){
+            if(!statuses[i].ok() || results[i].data!=leveldb::Slice(expected[i])){
+                std::cout<<names[f]<<" MultiReadBlock mismatch at block "<<i<<std::endl;
+                ok = false;
+            }
+            FreeContents(&results[i]);
+        }
+
+        AsyncResult async_result(num);
+        std::vector<AsyncArg> args(num);
+        start = std::chrono::steady_clock::now();
+        for(size_t i=0;i<num;i++){
+            args[i] = AsyncArg{&async_result,i};
+            if(!leveldb::ReadBlockAsync(files[f],read_options,handles[i],&OnBlockRead,&args[i]).ok()){
+                async_result.errors++;
+                async_result.remaining--;
+            }
+        }
+        while(async_result.remaining.load()>0){
+            std::this_thread::yield();
+        }
+        const double async_micros = Micros(start);
+        if(async_result.errors.load()>0){
+            ok = false;
+        }
+        for(size_t i=0;ok && i<num;i++){
+            if(async_result.blocks[i]!=expected[i]){
+                std::cout<<names[f]<<" ReadBlockAsync mismatch at block "<<i<<std::endl;
+                ok = false;
+            }
+        }
+        std::cout<<names[f]<<": MultiReadBlock "<<multi_micros<<" us, ReadBlockAsync "<<async_micros<<" us"<<std::endl;
+    }
+    delete pooled;
+    delete file;
+    std::remove(fname.c_str());
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,261 @@
+#include<iostream>
+#include<atomic>
+#include<cstdio>
+#include<map>
+#include<set>
+#include<string>
+#include<vector>
+#include "table/blob_file.h"
+#include "table/blob_gc.h"
+#include "table/table_builder.h"
+#include "table/table.h"
+#include "util/cache.h"
+#include "util/env.h"
+#include "test/table_test_util.h"
+
+//大value写入blob文件，sstable中只保留引用：检查table大小、迭代器和点查按需读取blob，
+//以及重写table后回收blob文件
+
+static void SaveMultiValue(void* arg,size_t index,const leveldb::Slice& k,const leveldb::Slice& v){
+    (*reinterpret_cast<std::vector<std::string>*>(arg))[index].assign(v.data(),v.size());
+}
+
+static const int kNumKeys = 400;
+static const size_t kMinBlobSize = 4096;
+
+static std::string Key(int i){
+    char buf[32];
+    snprintf(buf,sizeof(buf),"key%06d",i*2);
+    return buf;
+}
+
+//每4个key有一个100KB的大value
+static std::string Value(int i){
+    char buf[32];
+    snprintf(buf,sizeof(buf),"%d:",i);
+    return std::string(buf)+std::string(i%4==0 ? 100*1024 : 100,'a'+i%26);
+}
+
+struct TableFile{
+    std::string contents;
+    StringSource* source = nullptr;
+    leveldb::Table* table = nullptr;
+    ~TableFile(){
+        delete table;
+        delete source;
+    }
+    bool Open(const leveldb::Options& options){
+        source = new StringSource(contents);
+        leveldb::Status s = leveldb::Table::Open(options,source,contents.size(),&table);
+        if(!s.ok()) std::cout<<s.ToString()<<std::endl;
+        return s.ok();
+    }
+};
+
+//检查table中keys对应的value，返回读取blob文件的次数；失败时返回-1
+static int CheckValues(leveldb::Table* table,const std::vector<int>& keys,const StringSource& blob_file){
+    const uint64_t reads = blob_file.reads();
+    leveldb::Iterator* iter = table->NewIterator(leveldb::ReadOptions());
+    size_t n = 0;
+    for(iter->SeekToFirst();iter->Valid();iter->Next(),n++){
+        if(n>=keys.size() || iter->key()!=leveldb::Slice(Key(keys[n])) || iter->value()!=leveldb::Slice(Value(keys[n]))){
+            break;
+        }
+    }
+    const bool ok = n==keys.size() && iter->status().ok();
+    if(!ok) std::cout<<"scan mismatch at "<<n<<" "<<iter->status().ToString()<<std::endl;
+    delete iter;
+    return ok ? static_cast<int>(blob_file.reads()-reads) : -1;
+}
+
+int main(){
+    leveldb::Options options;
+    options.comparator = leveldb::BytewiseComparator();
+    options.compression = leveldb::kNoCompression;
+    options.block_cache = leveldb::NewLRUCache(8<<20);
+    options.min_blob_size = kMinBlobSize;
+    leveldb::BlobSource blob_source;
+    options.blob_source = &blob_source;
+    bool ok = true;
+
+    //1.大value写入blob文件1
+    StringSink blob_sink1;
+    leveldb::BlobFileBuilder blob_builder1(&blob_sink1,1);
+    TableFile t1;
+    {
+        StringSink sink;
+        leveldb::TableBuilder builder(options,&sink);
+        builder.SetBlobFile(&blob_builder1);
+        for(int i=0;i<kNumKeys;i++){
+            builder.Add(Key(i),Value(i));
+        }
+        if(!builder.Finish().ok() || !blob_builder1.Flush().ok()) return 1;
+        t1.contents = sink.contents();
+    }
+    std::cout<<"table "<<t1.contents.size()<<" bytes, blob file "<<blob_sink1.contents().size()<<" bytes, "
+             <<blob_builder1.NumBlobs()<<" blobs"<<std::endl;
+    if(blob_builder1.NumBlobs()!=kNumKeys/4 || t1.contents.size()>64*1024) return 1;
+    StringSource blob_file1(blob_sink1.contents());
+    blob_source.AddFile(1,&blob_file1,blob_sink1.contents().size());
+    if(!t1.Open(options) || !t1.table->HasBlobValues()) return 1;
+
+    //2.只访问key时不读取blob；读取value时每个blob读取一次
+    std::vector<int> all_keys;
+    for(int i=0;i<kNumKeys;i++) all_keys.push_back(i);
+    leveldb::Iterator* iter = t1.table->NewIterator(leveldb::ReadOptions());
+    int count = 0;
+    for(iter->SeekToFirst();iter->Valid();iter->Next()) count++;
+    delete iter;
+    if(count!=kNumKeys || blob_file1.reads()!=0){
+        std::cout<<"key-only scan read "<<blob_file1.reads()<<" blobs"<<std::endl;
+        ok = false;
+    }
+    const int scan_reads = CheckValues(t1.table,all_keys,blob_file1);
+    if(ok && scan_reads!=kNumKeys/4){
+        std::cout<<"full scan read "<<scan_reads<<" blobs"<<std::endl;
+        ok = false;
+    }
+
+    //3.点查只读取匹配的key的blob，不存在的key(排在大value之前)不读取
+    leveldb::ReadOptions read_options;
+    read_options.verify_checksums = true;
+    for(int i=0;ok && i<kNumKeys;i+=3){
+        std::string value;
+        leveldb::Status s = leveldb::TableCache::Get(t1.table,read_options,Key(i),&value,SaveValue);
+        if(!s.ok() || value!=Value(i)){
+            std::cout<<"get mismatch for "<<Key(i)<<" "<<s.ToString()<<std::endl;
+            ok = false;
+        }
+        const uint64_t reads = blob_file1.reads();
+        std::string missing_key = Key(i);
+        missing_key.back()--;
+        value.clear();
+        s = leveldb::TableCache::Get(t1.table,read_options,missing_key,&value,SaveValue);
+        if(!s.ok() || !value.empty() || blob_file1.reads()!=reads){
+            std::cout<<"get of missing key "<<missing_key<<" read a blob"<<std::endl;
+            ok = false;
+        }
+    }
+    std::vector<leveldb::Slice> multi_keys;
+    std::vector<std::string> multi_key_strings;
+    for(int i=0;i<kNumKeys;i++) multi_key_strings.push_back(Key(i));
+    for(int i=0;i<kNumKeys;i++) multi_keys.push_back(multi_key_strings[i]);
+    std::vector<std::string> multi_values(kNumKeys);
+    if(ok && !t1.table->MultiGet(read_options,multi_keys.data(),kNumKeys,&multi_values,SaveMultiValue).ok()) ok = false;
+    for(int i=0;ok && i<kNumKeys;i++){
+        if(multi_values[i]!=Value(i)){
+            std::cout<<"multiget mismatch for "<<Key(i)<<std::endl;
+            ok = false;
+        }
+    }
+
+    //4.没有blob_source时报告错误
+    if(ok){
+        leveldb::Options no_source = options;
+        no_source.blob_source = nullptr;
+        TableFile t;
+        t.contents = t1.contents;
+        if(!t.Open(no_source)) return 1;
+        std::string value;
+        if(leveldb::TableCache::Get(t.table,leveldb::ReadOptions(),Key(0),&value,SaveValue).ok()){
+            std::cout<<"missing blob source not reported"<<std::endl;
+            ok = false;
+        }
+    }
+
+    //5.模拟compaction删除3/4的大value，引用原样保留
+    TableFile t2;
+    std::vector<int> t2_keys;
+    if(ok){
+        StringSink sink;
+        leveldb::TableBuilder builder(options,&sink);
+        leveldb::ReadOptions raw;
+        raw.resolve_blobs = false;
+        iter = t1.table->NewIterator(raw);
+        int i = 0;
+        for(iter->SeekToFirst();iter->Valid();iter->Next(),i++){
+            if(i%4==0 && i%16!=0) continue;
+            leveldb::Slice value;
+            leveldb::BlobIndex index;
+            bool is_reference = false;
+            if(!leveldb::DecodeBlobValue(iter->value(),&value,&index,&is_reference).ok()) return 1;
+            if(is_reference){
+                builder.AddBlobReference(iter->key(),index);
+            }else{
+                builder.Add(iter->key(),value);
+            }
+            t2_keys.push_back(i);
+        }
+        delete iter;
+        if(!builder.Finish().ok()) return 1;
+        t2.contents = sink.contents();
+        if(!t2.Open(options) || CheckValues(t2.table,t2_keys,blob_file1)<0) ok = false;
+    }
+
+    //6.blob文件1的垃圾超过一半，重写t2时搬到blob文件2，之后文件1不再被引用
+    std::map<uint64_t,uint64_t> file_sizes;
+    file_sizes[1] = blob_sink1.contents().size();
+    std::map<uint64_t,leveldb::BlobFileUsage> usage;
+    std::vector<uint64_t> obsolete;
+    std::set<uint64_t> relocate;
+    if(ok){
+        if(!leveldb::CollectBlobReferences(t2.table,&usage).ok()) return 1;
+        leveldb::PickBlobFilesForGC(file_sizes,usage,0.5,&obsolete,&relocate);
+        std::cout<<"blob file 1: "<<usage[1].live_blobs<<" live blobs, "<<usage[1].live_bytes<<" live bytes"<<std::endl;
+        if(usage[1].live_blobs!=kNumKeys/16 || !obsolete.empty() || relocate.count(1)==0){
+            std::cout<<"blob file 1 should be relocated"<<std::endl;
+            ok = false;
+        }
+    }
+    StringSink blob_sink2;
+    leveldb::BlobFileBuilder blob_builder2(&blob_sink2,2);
+    TableFile t3;
+    if(ok){
+        StringSink sink;
+        leveldb::TableBuilder builder(options,&sink);
+        builder.SetBlobFile(&blob_builder2);
+        if(!leveldb::RewriteTableWithBlobs(t2.table,leveldb::ReadOptions(),relocate,&blob_source,&builder).ok() ||
+           !builder.Finish().ok() || !blob_builder2.Flush().ok()){
+            return 1;
+        }
+        t3.contents = sink.contents();
+    }
+    StringSource blob_file2(blob_sink2.contents());
+    if(ok){
+        blob_source.AddFile(2,&blob_file2,blob_sink2.contents().size());
+        file_sizes[2] = blob_sink2.contents().size();
+        usage.clear();
+        obsolete.clear();
+        relocate.clear();
+        if(!t3.Open(options) || !leveldb::CollectBlobReferences(t3.table,&usage).ok()) return 1;
+        leveldb::PickBlobFilesForGC(file_sizes,usage,0.5,&obsolete,&relocate);
+        std::cout<<"after rewrite: blob file 2 "<<blob_sink2.contents().size()<<" bytes, obsolete files "<<obsolete.size()<<std::endl;
+        if(obsolete.size()!=1 || obsolete[0]!=1 || !relocate.empty()){
+            ok = false;
+        }
+        //删除文件1后t3仍然完整
+        blob_source.RemoveFile(1);
+        if(ok && CheckValues(t3.table,t2_keys,blob_file2)<0) ok = false;
+    }
+
+    //7.blob损坏时要求校验的读取发现
+    if(ok){
+        std::string corrupted = blob_sink2.contents();
+        corrupted[corrupted.size()/2] ^= 1;
+        StringSource corrupted_file(corrupted);
+        blob_source.AddFile(2,&corrupted_file,corrupted.size());
+        read_options.verify_checksums = true;
+        iter = t3.table->NewIterator(read_options);
+        for(iter->SeekToFirst();iter->Valid();iter->Next()){
+            iter->value();
+        }
+        if(!iter->status().IsCorruption()){
+            std::cout<<"corrupted blob not detected"<<std::endl;
+            ok = false;
+        }
+        delete iter;
+        blob_source.RemoveFile(2);
+    }
+    delete options.block_cache;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+#include<iostream>
+#include<algorithm>
+#include<chrono>
+#include<cstdio>
+#include<string>
+#include<vector>
+#include "table/block_builder.h"
+#include "table/block.h"
+#include "db/dbformat.h"
+#include "util/random.h"
+#include "test/table_test_util.h"
+
+//比较block有无重启点key缓存时Seek的结果和耗时，结果必须与在有序key上二分查找一致；
+//包装非字节序user comparator的InternalKeyComparator不能使用前缀缓存
+
+//按字节逆序比较的user comparator
+class ReverseBytewiseComparator:public leveldb::Comparator{
+public:
+    const char* Name() const override { return "test.ReverseBytewiseComparator";}
+    int Compare(const leveldb::Slice& a,const leveldb::Slice& b) const override { return -a.compare(b);}
+    void FindShortestSeparator(std::string* start,const leveldb::Slice& limit) const override{}
+    void FindShortSuccessor(std::string* key) const override{}
+};
+
+static bool test(const char* label,const leveldb::Comparator* comparator,const std::vector<std::string>& keys,
+                 const std::vector<std::string>& targets){
+    leveldb::Options options;
+    options.comparator = comparator;
+    leveldb::BlockBuilder builder(&options);
+    for(size_t i=0;i<keys.size();i++){
+        builder.Add(keys[i],"value");
+    }
+    const std::string raw = builder.Finish().ToString();
+    leveldb::BlockContents contents;
+    contents.data = raw;
+    contents.cachable = false;
+    contents.heap_allocated = false;
+    leveldb::Block block(contents);
+
+    //keys按comparator有序，第一个不小于target的key
+    std::vector<std::string> expected(targets.size());
+    for(size_t i=0;i<targets.size();i++){
+        std::vector<std::string>::const_iterator it = std::lower_bound(keys.begin(),keys.end(),targets[i],
+            [comparator](const std::string& a,const std::string& b){ return comparator->Compare(a,b)<0;});
+        expected[i] = it==keys.end() ? "" : *it;
+    }
+    double micros[2];
+    const int kRounds = 50;
+    for(int c=0;c<2;c++){
+        leveldb::Iterator* iter = block.NewIterator(comparator,c==1);
+        auto start = std::chrono::steady_clock::now();
+        for(int r=0;r<kRounds;r++){
+            for(size_t i=0;i<targets.size();i++){
+                iter->Seek(targets[i]);
+                if(r>0) continue;
+                const std::string found = iter->Valid() ? iter->key().ToString() : "";
+                if(found!=expected[i]){
+                    std::cout<<label<<(c==1 ? " (cached)" : "")<<": seek mismatch at target "<<i<<std::endl;
+                    delete iter;
+                    return false;
+                }
+            }
+        }
+        micros[c] = std::chrono::duration<double,std::nano>(std::chrono::steady_clock::now()-start).count()/(kRounds*targets.size());
+        //顺序遍历经过重启点时不拷贝key，结果不变
+        size_t count = 0;
+        for(iter->SeekToFirst();iter->Valid() && count<keys.size() && iter->key()==leveldb::Slice(keys[count]);iter->Next()){
+            count++;
+        }
+        delete iter;
+        if(count!=keys.size()){
+            std::cout<<label<<": scan mismatch at "<<count<<std::endl;
+            return false;
+        }
+    }
+    std::cout<<label<<": "<<keys.size()<<" keys, seek "<<micros[0]<<" ns -> "<<micros[1]<<" ns"<<std::endl;
+    return true;
+}
+
+static std::string InternalKey(const std::string& user_key,uint64_t seq){
+    std::string key = user_key;
+    leveldb::PutFixed64(&key,seq);
+    return key;
+}
+
+int main(){
+    leveldb::Random rnd(301);
+    //4KB和64KB大小的block，key为固定前缀加数字
+    const size_t sizes[] = {150,2400};
+    for(size_t s=0;s<2;s++){
+        std::vector<std::string> keys,targets;
+        char buf[32];
+        for(size_t i=0;i<sizes[s];i++){
+            snprintf(buf,sizeof(buf),"user%010d",static_cast<int>(i*2));
+            keys.push_back(buf);
+        }
+        for(size_t i=0;i<sizes[s]*2+2;i++){
+            snprintf(buf,sizeof(buf),"user%010d",static_cast<int>(i));
+            targets.push_back(buf);
+        }
+        for(size_t i=targets.size()-1;i>0;i--){
+            std::swap(targets[i],targets[rnd.Uniform(i+1)]);
+        }
+        if(!test(s==0 ? "bytewise 4KB" : "bytewise 64KB",leveldb::BytewiseComparator(),keys,targets)) return 1;
+    }
+
+    //长度不一的短user key(不足8字节时前缀补0)，每个user key有多个版本
+    TestInternalKeyComparator comparator;
+    std::vector<std::string> user_keys;
+    for(int i=0;i<3000;i++){
+        std::string k;
+        const int len = 1+rnd.Uniform(10);
+        for(int j=0;j<len;j++){
+            k.push_back(static_cast<char>(rnd.Uniform(4)));
+        }
+        user_keys.push_back(k);
+    }
+    std::sort(user_keys.begin(),user_keys.end());
+    user_keys.erase(std::unique(user_keys.begin(),user_keys.end()),user_keys.end());
+    std::vector<std::string> keys,targets;
+    for(size_t i=0;i<user_keys.size();i++){
+        const int versions = 1+i%3;
+        for(int v=versions;v>=1;v--){
+            keys.push_back(InternalKey(user_keys[i],v*10));
+        }
+        targets.push_back(InternalKey(user_keys[i],5));
+        targets.push_back(InternalKey(user_keys[i],15));
+        targets.push_back(InternalKey(user_keys[i]+std::string(1,'\0'),100));
+        targets.push_back(InternalKey(user_keys[i]+"\x05",100));
+    }
+    if(!test("internal keys",&comparator,keys,targets)) return 1;
+
+    //同样的key，user key按逆序排列
+    ReverseBytewiseComparator reverse;
+    leveldb::InternalComparator reverse_internal(&reverse);
+    std::reverse(user_keys.begin(),user_keys.end());
+    keys.clear();
+    for(size_t i=0;i<user_keys.size();i++){
+        const int versions = 1+i%3;
+        for(int v=versions;v>=1;v--){
+            keys.push_back(InternalKey(user_keys[i],v*10));
+        }
+    }
+    if(!test("reverse user keys",&reverse_internal,keys,targets)) return 1;
+    return 0;
+}
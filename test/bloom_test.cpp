@@ -0,0 +1,109 @@
+#include<iostream>
+#include<chrono>
+#include<cstdlib>
+#include<cstring>
+#include<string>
+#include<vector>
+#include "util/bloom.h"
+#include "util/coding.h"
+
+static leveldb::Slice Key(int i,char* buffer){
+    leveldb::EncodeFixed32(buffer,i);
+    return leveldb::Slice(buffer,sizeof(uint32_t));
+}
+
+//用不在filter中的10000个key测量假阳率
+static double FalsePositiveRate(const leveldb::FilterPolicy* policy,const std::string& filter){
+    char buffer[sizeof(int)];
+    int result = 0;
+    for(int i=0;i<10000;i++){
+        if(policy->KeyMayMatch(Key(i+1000000000,buffer),filter)){
+            result++;
+        }
+    }
+    return result/10000.0;
+}
+
+void test(const leveldb::FilterPolicy* policy,const leveldb::FilterPolicy* reader){
+    int mediocre_filters = 0;
+    int good_filters = 0;
+    for(int length=1;length<=10000;length = (length<10 ? length+1 : length*2)){
+        std::vector<std::string> key_storage;
+        std::vector<leveldb::Slice> keys;
+        char buffer[sizeof(int)];
+        for(int i=0;i<length;i++){
+            key_storage.push_back(Key(i,buffer).ToString());
+        }
+        for(size_t i=0;i<key_storage.size();i++){
+            keys.push_back(key_storage[i]);
+        }
+        std::string filter;
+        policy->CreateFilter(&keys[0],length,&filter);
+        //加入过的key必须全部匹配；另一种policy不认识该格式，一律认为可能匹配
+        if(FalsePositiveRate(reader,filter)!=1.0){
+            std::cout<<"length "<<length<<": "<<reader->Name()<<" misread a "<<policy->Name()<<" filter"<<std::endl;
+            return;
+        }
+        for(int i=0;i<length;i++){
+            if(!policy->KeyMayMatch(Key(i,buffer),filter) || !reader->KeyMayMatch(Key(i,buffer),filter)){
+                std::cout<<"length "<<length<<": false negative on key "<<i<<std::endl;
+                return;
+            }
+        }
+        double rate = FalsePositiveRate(policy,filter);
+        std::cout<<"length="<<length<<" bytes="<<filter.size()<<" false positives="<<rate*100<<"%"<<std::endl;
+        if(rate>0.02){
+            std::cout<<"false positive rate too high"<<std::endl;
+            return;
+        }
+        if(rate>0.0125) mediocre_filters++;
+        else good_filters++;
+    }
+    std::cout<<"good filters: "<<good_filters<<", mediocre filters: "<<mediocre_filters<<std::endl;
+}
+
+//filter在内存中不一定按64字节对齐，比较起始位置对齐和偏移32字节(每个line跨两个cache line)时的探测耗时
+static void MeasureAlignment(const leveldb::FilterPolicy* policy){
+    const int kKeys = 1000000;
+    std::vector<std::string> key_storage(kKeys);
+    std::vector<leveldb::Slice> keys(kKeys);
+    char buffer[sizeof(int)];
+    for(int i=0;i<kKeys;i++){
+        key_storage[i] = Key(i*3,buffer).ToString();
+        keys[i] = key_storage[i];
+    }
+    std::string filter;
+    policy->CreateFilter(&keys[0],kKeys,&filter);
+    char* base = static_cast<char*>(aligned_alloc(64,filter.size()/64*64+128));
+    const int offsets[] = {0,32};
+    for(int r=0;r<2;r++){
+        for(int o=0;o<2;o++){
+            memcpy(base+offsets[o],filter.data(),filter.size());
+            const leveldb::Slice aligned_filter(base+offsets[o],filter.size());
+            const int kProbes = 2000000;
+            int matches = 0;
+            auto start = std::chrono::steady_clock::now();
+            for(int i=0;i<kProbes;i++){
+                matches += policy->KeyMayMatch(Key(static_cast<int>((static_cast<uint64_t>(i)*2654435761u)%(kKeys*3)),buffer),aligned_filter);
+            }
+            const double ns = std::chrono::duration<double,std::nano>(std::chrono::steady_clock::now()-start).count()/kProbes;
+            if(r==1){
+                std::cout<<"filter offset "<<offsets[o]<<": "<<ns<<" ns/probe ("<<matches<<" matches)"<<std::endl;
+            }
+        }
+    }
+    free(base);
+}
+
+int main(){
+    const leveldb::FilterPolicy* bloom = leveldb::NewBloomFilterPolicy(10);
+    const leveldb::FilterPolicy* cache_line_bloom = leveldb::NewCacheLineBloomFilterPolicy(10);
+    std::cout<<"classic bloom"<<std::endl;
+    test(bloom,cache_line_bloom);
+    std::cout<<"cache line bloom"<<std::endl;
+    test(cache_line_bloom,bloom);
+    MeasureAlignment(cache_line_bloom);
+    delete cache_line_bloom;
+    delete bloom;
+    return 0;
+}
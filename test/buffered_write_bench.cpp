@@ -0,0 +1,126 @@
+#include<iostream>
+#include<chrono>
+#include<cstdio>
+#include<fstream>
+#include<sstream>
+#include<string>
+#include "table/table_builder.h"
+#include "util/env_posix.h"
+#include "util/random.h"
+#include "test/table_test_util.h"
+
+//TableBuilder只在Finish时Flush一次，block和trailer一次追加；
+//比较每次Append都write的文件和不同大小写缓冲的PosixWritableFile每MB的write次数和耗时，文件内容必须相同
+
+//没有写缓冲，每次Append都调用write
+class UnbufferedFile:public leveldb::WritableFile{
+public:
+    explicit UnbufferedFile(const std::string& fname):fp_(fopen(fname.c_str(),"wb")),writes_(0){ setvbuf(fp_,nullptr,_IONBF,0);}
+    ~UnbufferedFile() override { if(fp_!=nullptr) fclose(fp_);}
+    leveldb::Status Append(const leveldb::Slice& data) override{
+        writes_++;
+        if(fwrite(data.data(),1,data.size(),fp_)!=data.size()) return leveldb::Status::IOError("fwrite");
+        return leveldb::Status::OK();
+    }
+    leveldb::Status Close() override{
+        fclose(fp_);
+        fp_ = nullptr;
+        return leveldb::Status::OK();
+    }
+    leveldb::Status Flush() override { return leveldb::Status::OK();}
+    leveldb::Status Sync() override { return leveldb::Status::OK();}
+    uint64_t writes() const { return writes_;}
+private:
+    FILE* fp_;
+    uint64_t writes_;
+};
+
+static const int kNumKeys = 300000;
+
+static void BuildTable(leveldb::WritableFile* file){
+    leveldb::Options options;
+    options.comparator = leveldb::BytewiseComparator();
+    options.compression = leveldb::kNoCompression;
+    leveldb::TableBuilder builder(options,file);
+    leveldb::Random rnd(301);
+    std::string value;
+    char key[32];
+    for(int i=0;i<kNumKeys;i++){
+        snprintf(key,sizeof(key),"key%010d",i);
+        value.clear();
+        for(int j=0;j<100;j++){
+            value.push_back(static_cast<char>(' '+rnd.Uniform(95)));
+        }
+        builder.Add(key,value);
+    }
+    builder.Finish();
+}
+
+static std::string ReadFile(const std::string& fname){
+    std::ifstream in(fname,std::ios::binary);
+    std::stringstream ss;
+    ss<<in.rdbuf();
+    return ss.str();
+}
+
+static void Report(const char* name,uint64_t writes,size_t bytes,double seconds){
+    const double mb = static_cast<double>(bytes)/(1<<20);
+    std::cout<<name<<": "<<writes<<" writes, "<<writes/mb<<" writes/MB, "<<mb/seconds<<" MB/s"<<std::endl;
+}
+
+int main(){
+    const std::string fname = "/tmp/leveldb_buffered_write_bench.ldb";
+    StringSink sink;
+    BuildTable(&sink);
+    const std::string& expected = sink.contents();
+    bool ok = true;
+    //每个block一次Append，只在Finish时Flush一次
+    if(sink.flushes()!=1){
+        std::cout<<"TableBuilder flushed "<<sink.flushes()<<" times"<<std::endl;
+        ok = false;
+    }
+    std::cout<<expected.size()<<" bytes, "<<sink.appends()<<" appends"<<std::endl;
+
+    {
+        UnbufferedFile file(fname);
+        auto start = std::chrono::steady_clock::now();
+        BuildTable(&file);
+        file.Close();
+        auto end = std::chrono::steady_clock::now();
+        Report("unbuffered      ",file.writes(),expected.size(),std::chrono::duration<double>(end-start).count());
+        if(ReadFile(fname)!=expected){
+            std::cout<<"unbuffered file content mismatch"<<std::endl;
+            ok = false;
+        }
+    }
+
+    const size_t buffer_sizes[] = {64<<10,1<<20,4<<20,5000};
+    for(size_t i=0;ok && i<sizeof(buffer_sizes)/sizeof(buffer_sizes[0]);i++){
+        leveldb::WritableFile* file = nullptr;
+        leveldb::Status s = leveldb::NewPosixWritableFile(fname,buffer_sizes[i],false,&file);
+        if(!s.ok()){
+            std::cout<<s.ToString()<<std::endl;
+            ok = false;
+            break;
+        }
+        leveldb::PosixWritableFile* posix_file = static_cast<leveldb::PosixWritableFile*>(file);
+        auto start = std::chrono::steady_clock::now();
+        BuildTable(file);
+        s = file->Close();
+        auto end = std::chrono::steady_clock::now();
+        const size_t capacity = posix_file->buffer_size();
+        char name[64];
+        snprintf(name,sizeof(name),"buffer %8zu bytes",capacity);
+        Report(name,posix_file->write_calls(),expected.size(),std::chrono::duration<double>(end-start).count());
+        //缓冲区大小向上对齐，只有写满或Finish时才write
+        if(!s.ok() || capacity%leveldb::kWritableFileAlignment!=0 ||
+           posix_file->write_calls()>expected.size()/capacity+1 || posix_file->bytes_written()!=expected.size() ||
+           ReadFile(fname)!=expected){
+            std::cout<<"buffered file mismatch: "<<s.ToString()<<std::endl;
+            ok = false;
+        }
+        delete file;
+    }
+    std::remove(fname.c_str());
+    return ok ? 0 : 1;
+}
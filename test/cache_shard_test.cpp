@@ -0,0 +1,157 @@
+#include<iostream>
+#include<atomic>
+#include<chrono>
+#include<cstdio>
+#include<string>
+#include<thread>
+#include<vector>
+#include "util/cache.h"
+
+//自动选择的分片数遵守每个分片512KB的下限和10位的上限；
+//各分片的lookup/hit/insert计数之和等于实际的操作次数，锁被占用时加锁计入lock_waits
+
+static void DeleteNothing(const leveldb::Slice& key,void* value){}
+
+//Erase时在持有分片锁的情况下调用，直到主线程把状态置为2才返回
+static std::atomic<int> deleter_state(0);
+static void BlockingDeleter(const leveldb::Slice& key,void* value){
+    deleter_state.store(1);
+    while(deleter_state.load()!=2){
+        std::this_thread::yield();
+    }
+}
+
+static std::string Key(int i){
+    char buf[32];
+    snprintf(buf,sizeof(buf),"key%012d",i);
+    return buf;
+}
+
+static leveldb::CacheShardStats Sum(leveldb::Cache* cache,size_t* num_shards){
+    std::vector<leveldb::CacheShardStats> stats;
+    cache->GetShardStats(&stats);
+    *num_shards = stats.size();
+    leveldb::CacheShardStats total = leveldb::CacheShardStats();
+    for(size_t i=0;i<stats.size();i++){
+        total.capacity += stats[i].capacity;
+        total.usage += stats[i].usage;
+        total.lookups += stats[i].lookups;
+        total.hits += stats[i].hits;
+        total.inserts += stats[i].inserts;
+        total.lock_waits += stats[i].lock_waits;
+    }
+    return total;
+}
+
+//与DefaultCacheShardBits独立计算的期望值
+static int ExpectedShardBits(size_t capacity,unsigned int threads){
+    int bits = 0;
+    while((1u<<bits)<2*threads && bits<10) bits++;
+    while(bits>0 && capacity/(size_t(1)<<bits)<512*1024) bits--;
+    return bits;
+}
+
+static bool TestDefaultShardBits(){
+    bool ok = true;
+    const size_t capacities[] = {0,100<<10,512<<10,1<<20,(1<<20)+1,3<<20,8<<20,64<<20,size_t(1)<<30,size_t(1)<<40};
+    const unsigned int threads[] = {0,1,2,3,8,64,4096};
+    for(size_t c=0;c<sizeof(capacities)/sizeof(capacities[0]);c++){
+        for(size_t t=0;t<sizeof(threads)/sizeof(threads[0]);t++){
+            const int bits = leveldb::DefaultCacheShardBits(capacities[c],threads[t]);
+            const int expected = ExpectedShardBits(capacities[c],threads[t]==0 ? 1 : threads[t]);
+            if(bits!=expected || bits<0 || bits>10 || (bits>0 && (capacities[c]>>bits)<512*1024)){
+                std::cout<<"capacity "<<capacities[c]<<" threads "<<threads[t]<<": "<<bits<<" shard bits, expected "<<expected<<std::endl;
+                ok = false;
+            }
+        }
+    }
+    //线程很多、容量很大时不超过10位；显式指定的分片数也被限制
+    if(leveldb::DefaultCacheShardBits(size_t(1)<<40,4096)!=10) ok = false;
+    size_t num_shards = 0;
+    leveldb::Cache* cache = leveldb::NewLRUCache(1<<20,20);
+    Sum(cache,&num_shards);
+    delete cache;
+    if(num_shards!=1024){
+        std::cout<<"num_shard_bits=20 gave "<<num_shards<<" shards"<<std::endl;
+        ok = false;
+    }
+    //自动选择时小cache只有一个分片
+    cache = leveldb::NewLRUCache(256<<10);
+    Sum(cache,&num_shards);
+    delete cache;
+    if(num_shards!=1) ok = false;
+    return ok;
+}
+
+//多个线程插入和查找，各分片计数之和等于操作次数
+static bool TestCounters(){
+    const int kThreads = 4;
+    const int kKeysPerThread = 5000;
+    leveldb::Cache* cache = leveldb::NewLRUCache(64<<20,4);
+    std::vector<std::thread> threads;
+    for(int t=0;t<kThreads;t++){
+        threads.emplace_back([cache,t](){
+            for(int i=0;i<kKeysPerThread;i++){
+                const std::string key = Key(t*kKeysPerThread+i);
+                cache->Release(cache->Insert(key,nullptr,1,DeleteNothing));
+                //一次命中，一次不命中
+                leveldb::Cache::Handle* h = cache->Lookup(key);
+                if(h!=nullptr) cache->Release(h);
+                h = cache->Lookup(key+"-missing");
+                if(h!=nullptr) cache->Release(h);
+            }
+        });
+    }
+    for(size_t i=0;i<threads.size();i++){
+        threads[i].join();
+    }
+    std::vector<leveldb::CacheShardStats> stats;
+    cache->GetShardStats(&stats);
+    size_t num_shards = 0;
+    const leveldb::CacheShardStats total = Sum(cache,&num_shards);
+    const uint64_t n = kThreads*kKeysPerThread;
+    bool ok = num_shards==16 && total.inserts==n && total.lookups==2*n && total.hits==n &&
+              total.usage==n && total.usage==cache->TotalCharge();
+    for(size_t i=0;i<stats.size();i++){
+        //key均匀分布，每个分片都有数据
+        if(stats[i].inserts==0 || stats[i].hits>stats[i].lookups) ok = false;
+    }
+    std::cout<<num_shards<<" shards: "<<total.inserts<<" inserts, "<<total.lookups<<" lookups, "
+             <<total.hits<<" hits, "<<total.lock_waits<<" lock waits"<<std::endl;
+    delete cache;
+    return ok;
+}
+
+//一个线程在持有分片锁时阻塞，另一个线程的Lookup必须等锁，lock_waits加1
+static bool TestLockWaits(){
+    leveldb::Cache* cache = leveldb::NewLRUCache(1<<20,0);
+    cache->Release(cache->Insert("blocking",nullptr,1,BlockingDeleter));
+    std::thread holder([cache](){ cache->Erase("blocking");});
+    while(deleter_state.load()!=1){
+        std::this_thread::yield();
+    }
+    std::thread waiter([cache](){
+        leveldb::Cache::Handle* h = cache->Lookup("other");
+        if(h!=nullptr) cache->Release(h);
+    });
+    //GetShardStats本身要加锁，只能等待足够长的时间让waiter阻塞在锁上
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    deleter_state.store(2);
+    holder.join();
+    waiter.join();
+    size_t num_shards = 0;
+    const leveldb::CacheShardStats total = Sum(cache,&num_shards);
+    delete cache;
+    if(total.lock_waits!=1 || total.lookups!=1){
+        std::cout<<"lock waits "<<total.lock_waits<<", lookups "<<total.lookups<<std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(){
+    bool ok = TestDefaultShardBits();
+    ok = TestCounters() && ok;
+    ok = TestLockWaits() && ok;
+    return ok ? 0 : 1;
+}
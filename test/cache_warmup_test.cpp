@@ -0,0 +1,154 @@
+#include<iostream>
+#include<cstdio>
+#include<map>
+#include<set>
+#include<string>
+#include<vector>
+#include "table/cache_warmup.h"
+#include "table/table_builder.h"
+#include "table/table.h"
+#include "util/cache.h"
+#include "test/table_test_util.h"
+
+//block cache索引的编码和解析、损坏的索引文件，以及预热器按索引把block读回新的cache；
+//Wait之前多次Start时每个block只预取一次
+
+static const int kNumKeys = 5000;
+static const uint64_t kFileNumber = 7;
+
+static std::string Key(int i){
+    char buf[32];
+    snprintf(buf,sizeof(buf),"key%08d",i);
+    return buf;
+}
+
+static bool Open(const leveldb::Options& options,const std::string& contents,StringSource** source,leveldb::Table** table){
+    *source = new StringSource(contents);
+    leveldb::Status s = leveldb::Table::Open(options,*source,contents.size(),table);
+    if(!s.ok()){
+        std::cout<<s.ToString()<<std::endl;
+        delete *source;
+        return false;
+    }
+    return true;
+}
+
+static int Scan(leveldb::Table* table){
+    leveldb::Iterator* iter = table->NewIterator(leveldb::ReadOptions());
+    int count = 0;
+    for(iter->SeekToFirst();iter->Valid();iter->Next()){
+        count++;
+    }
+    delete iter;
+    return count;
+}
+
+static bool ExpectCorruption(const char* name,const std::string& contents){
+    std::vector<leveldb::CachedBlockRef> refs;
+    leveldb::Status s = leveldb::ParseBlockCacheIndex(contents,&refs);
+    if(!s.IsCorruption() || !refs.empty()){
+        std::cout<<name<<": expected corruption, got "<<s.ToString()<<std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(){
+    leveldb::Options options;
+    options.comparator = leveldb::BytewiseComparator();
+    options.compression = leveldb::kNoCompression;
+    StringSink sink;
+    {
+        leveldb::TableBuilder builder(options,&sink);
+        for(int i=0;i<kNumKeys;i++){
+            builder.Add(Key(i),std::string(100,'a'+i%26));
+        }
+        builder.Finish();
+    }
+    bool ok = true;
+
+    //1.扫描一遍填满cache，编码后解析出所有data block
+    options.block_cache = leveldb::NewLRUCache(8<<20);
+    StringSource* source = nullptr;
+    leveldb::Table* table = nullptr;
+    if(!Open(options,sink.contents(),&source,&table)) return 1;
+    if(Scan(table)!=kNumKeys) ok = false;
+    std::vector<std::string> resident;
+    options.block_cache->GetResidentKeys(&resident);
+    std::map<uint64_t,uint64_t> cache_id_to_file;
+    cache_id_to_file[table->CacheId()] = kFileNumber;
+    std::string index;
+    leveldb::EncodeBlockCacheIndex(options.block_cache,cache_id_to_file,&index);
+    std::vector<leveldb::CachedBlockRef> refs;
+    leveldb::Status s = leveldb::ParseBlockCacheIndex(index,&refs);
+    std::set<uint64_t> offsets;
+    for(size_t i=0;i<refs.size();i++){
+        if(refs[i].file_number!=kFileNumber) ok = false;
+        offsets.insert(refs[i].offset);
+    }
+    std::cout<<resident.size()<<" resident blocks, "<<refs.size()<<" in index"<<std::endl;
+    if(!s.ok() || refs.empty() || refs.size()!=resident.size() || offsets.size()!=refs.size()){
+        std::cout<<"round trip failed: "<<s.ToString()<<std::endl;
+        ok = false;
+    }
+    //不属于任何已知table的key被忽略
+    std::string empty_index;
+    leveldb::EncodeBlockCacheIndex(options.block_cache,std::map<uint64_t,uint64_t>(),&empty_index);
+    s = leveldb::ParseBlockCacheIndex(empty_index,&refs);
+    if(!s.ok() || !refs.empty()){
+        std::cout<<"index without tables should be empty"<<std::endl;
+        ok = false;
+    }
+    s = leveldb::ParseBlockCacheIndex(index,&refs);
+    delete table;
+    delete source;
+    delete options.block_cache;
+
+    //2.损坏的索引文件
+    std::string bad = index;
+    bad[0] ^= 1;
+    ok = ExpectCorruption("bad magic",bad) && ok;
+    bad = index;
+    bad[index.size()/2] ^= 1;
+    ok = ExpectCorruption("flipped byte",bad) && ok;
+    ok = ExpectCorruption("too short",index.substr(0,10)) && ok;
+    //crc正确但count大于实际条目数
+    bad.clear();
+    leveldb::PutFixed64(&bad,leveldb::kCacheIndexMagicNumber);
+    leveldb::PutVarint64(&bad,3);
+    leveldb::PutVarint64(&bad,kFileNumber);
+    leveldb::PutVarint64(&bad,0);
+    leveldb::PutFixed32(&bad,leveldb::crc32c::Mask(leveldb::crc32c::Value(bad.data()+8,bad.size()-8)));
+    ok = ExpectCorruption("truncated entries",bad) && ok;
+
+    //3.新的cache按索引预热，两次Start只预取一次，之后的扫描不再读取文件
+    options.block_cache = leveldb::NewLRUCache(8<<20);
+    if(ok && Open(options,sink.contents(),&source,&table)){
+        const uint64_t reads = source->reads();
+        {
+            leveldb::BlockCacheWarmer warmer(2,0);
+            warmer.AddTable(kFileNumber,table);
+            const size_t half = refs.size()/2;
+            warmer.Start(std::vector<leveldb::CachedBlockRef>(refs.begin(),refs.begin()+half));
+            warmer.Start(std::vector<leveldb::CachedBlockRef>(refs.begin()+half,refs.end()));
+            warmer.Wait();
+            std::cout<<"warmer requested "<<warmer.BlocksRequested()<<" blocks with "
+                     <<source->reads()-reads<<" reads, "<<warmer.Errors()<<" errors"<<std::endl;
+            if(warmer.BlocksRequested()!=refs.size() || warmer.Errors()!=0 || source->reads()==reads){
+                ok = false;
+            }
+        }
+        std::vector<std::string> warmed;
+        options.block_cache->GetResidentKeys(&warmed);
+        const uint64_t before_scan = source->reads();
+        if(warmed.size()!=refs.size() || Scan(table)!=kNumKeys || source->reads()!=before_scan){
+            std::cout<<"warmed cache has "<<warmed.size()<<" blocks, scan read the file "
+                     <<source->reads()-before_scan<<" times"<<std::endl;
+            ok = false;
+        }
+        delete table;
+        delete source;
+    }
+    delete options.block_cache;
+    return ok ? 0 : 1;
+}
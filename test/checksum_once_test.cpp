@@ -0,0 +1,187 @@
+#include<iostream>
+#include<atomic>
+#include<cstdio>
+#include<string>
+#include<vector>
+#include "table/table_builder.h"
+#include "table/table.h"
+#include "util/cache.h"
+#include "util/env.h"
+#include "test/table_test_util.h"
+
+//要求校验checksum的读取只在block进入block cache时校验一次：
+//预热放入的block已经校验过，命中时不再读取；不校验的读取放入的block会被重新读取校验一次；
+//不校验的读取放入cache的损坏block，之后要求校验的读取仍能发现；
+//零拷贝文件的block不经过cache，同样只校验一次
+
+static const int kNumKeys = 5000;
+
+static std::string Key(int i){
+    char buf[32];
+    snprintf(buf,sizeof(buf),"key%08d",i);
+    return buf;
+}
+
+static std::string Value(int i){
+    return std::string(100,'a'+i%26);
+}
+
+static std::string BuildTable(const leveldb::Options& options){
+    StringSink sink;
+    leveldb::TableBuilder builder(options,&sink);
+    for(int i=0;i<kNumKeys;i++){
+        builder.Add(Key(i),Value(i));
+    }
+    builder.Finish();
+    return sink.contents();
+}
+
+//全表扫描，返回读到的key数；status写入*s
+static int Scan(leveldb::Table* table,bool verify,leveldb::Status* s){
+    leveldb::ReadOptions read_options;
+    read_options.verify_checksums = verify;
+    leveldb::Iterator* iter = table->NewIterator(read_options);
+    int count = 0;
+    for(iter->SeekToFirst();iter->Valid();iter->Next()){
+        count++;
+    }
+    *s = iter->status();
+    delete iter;
+    return count;
+}
+
+//所有data block的偏移
+static std::vector<uint64_t> DataBlockOffsets(leveldb::Table* table){
+    std::vector<uint64_t> offsets;
+    leveldb::Iterator* iter = table->NewIterator(leveldb::ReadOptions());
+    for(iter->SeekToFirst();iter->Valid();iter->Next()){
+        const uint64_t offset = table->ApproximateOffsetOf(iter->key());
+        if(offsets.empty() || offsets.back()!=offset) offsets.push_back(offset);
+    }
+    delete iter;
+    return offsets;
+}
+
+//直接返回内存中数据的文件，模拟mmap
+class ZeroCopySource:public leveldb::RandomAccessFile{
+public:
+    explicit ZeroCopySource(const std::string& contents):contents_(contents){}
+    leveldb::Status Read(uint64_t offset,size_t n,leveldb::Slice* result,char* scratch) const override{
+        if(offset+n>contents_.size()){
+            *result = leveldb::Slice();
+            return leveldb::Status::IOError("read past end of file");
+        }
+        *result = leveldb::Slice(contents_.data()+offset,n);
+        return leveldb::Status::OK();
+    }
+    bool SupportsZeroCopy() const override { return true;}
+    //修改文件内容，用于确认校验过的block不再校验
+    void Corrupt(size_t offset){ contents_[offset] ^= 1;}
+private:
+    std::string contents_;
+};
+
+static bool Open(const leveldb::Options& options,const std::string& contents,StringSource** source,leveldb::Table** table){
+    *source = new StringSource(contents);
+    leveldb::Status s = leveldb::Table::Open(options,*source,contents.size(),table);
+    if(!s.ok()){
+        std::cout<<s.ToString()<<std::endl;
+        delete *source;
+        return false;
+    }
+    return true;
+}
+
+int main(){
+    leveldb::Options options;
+    options.comparator = leveldb::BytewiseComparator();
+    options.compression = leveldb::kNoCompression;
+    options.block_cache = leveldb::NewLRUCache(8<<20);
+    const std::string contents = BuildTable(options);
+    bool ok = true;
+    leveldb::Status s;
+
+    //1.不校验的读取放入的block被重新读取校验一次；预热时校验，之后要求校验的扫描全部命中
+    StringSource* source = nullptr;
+    leveldb::Table* table = nullptr;
+    if(!Open(options,contents,&source,&table)) return 1;
+    const std::vector<uint64_t> offsets = DataBlockOffsets(table);
+    //DataBlockOffsets的扫描不校验，把所有block放入了cache
+    uint64_t reads = source->reads();
+    if(Scan(table,true,&s)!=kNumKeys || !s.ok()) ok = false;
+    const uint64_t reread = source->reads()-reads;
+    reads = source->reads();
+    if(Scan(table,true,&s)!=kNumKeys || !s.ok()) ok = false;
+    std::cout<<offsets.size()<<" data blocks, verified scan after unverified fill: "<<reread
+             <<" reads, second verified scan: "<<source->reads()-reads<<" reads"<<std::endl;
+    //迭代器会合并相邻block的读取，读取次数少于block数
+    if(reread==0 || source->reads()!=reads){
+        ok = false;
+    }
+    delete table;
+    delete source;
+
+    if(ok && Open(options,contents,&source,&table)){
+        s = table->PrefetchBlocks(offsets,nullptr);
+        reads = source->reads();
+        if(!s.ok() || Scan(table,true,&s)!=kNumKeys || !s.ok() || source->reads()!=reads){
+            std::cout<<"verified scan after prefetch read the file "<<source->reads()-reads<<" times"<<std::endl;
+            ok = false;
+        }
+        delete table;
+        delete source;
+    }
+
+    //2.修改一个value字节，不校验的扫描照常放入cache，要求校验的扫描发现损坏
+    std::string corrupted = contents;
+    corrupted[offsets[1]+200] ^= 1;
+    if(ok && Open(options,corrupted,&source,&table)){
+        if(Scan(table,false,&s)!=kNumKeys || !s.ok()){
+            std::cout<<"unverified scan should not detect corruption"<<std::endl;
+            ok = false;
+        }
+        if(Scan(table,true,&s)==kNumKeys || !s.IsCorruption()){
+            std::cout<<"verified scan missed corruption: "<<s.ToString()<<std::endl;
+            ok = false;
+        }
+        delete table;
+        delete source;
+    }
+    if(ok && Open(options,corrupted,&source,&table)){
+        s = table->PrefetchBlocks(offsets,nullptr);
+        if(!s.IsCorruption()){
+            std::cout<<"prefetch missed corruption: "<<s.ToString()<<std::endl;
+            ok = false;
+        }
+        delete table;
+        delete source;
+    }
+
+    //3.零拷贝文件: 第一次要求校验的扫描发现不了损坏的block之后，修改内存，再次扫描不重新校验；
+    //新打开的table仍能发现损坏
+    if(ok){
+        ZeroCopySource* zero_copy = new ZeroCopySource(contents);
+        s = leveldb::Table::Open(options,zero_copy,contents.size(),&table);
+        if(s.ok()){
+            if(Scan(table,true,&s)!=kNumKeys || !s.ok()) ok = false;
+            zero_copy->Corrupt(offsets[1]+200);
+            if(Scan(table,true,&s)!=kNumKeys || !s.ok()){
+                std::cout<<"zero-copy blocks were verified again: "<<s.ToString()<<std::endl;
+                ok = false;
+            }
+            delete table;
+            if(leveldb::Table::Open(options,zero_copy,contents.size(),&table).ok()){
+                if(Scan(table,true,&s)==kNumKeys || !s.IsCorruption()){
+                    std::cout<<"zero-copy verified scan missed corruption: "<<s.ToString()<<std::endl;
+                    ok = false;
+                }
+                delete table;
+            }
+        }else{
+            ok = false;
+        }
+        delete zero_copy;
+    }
+    delete options.block_cache;
+    return ok ? 0 : 1;
+}
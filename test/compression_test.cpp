@@ -0,0 +1,205 @@
+#include<iostream>
+#include<cstdio>
+#include<map>
+#include<string>
+#include<vector>
+#include "table/table_builder.h"
+#include "table/table.h"
+#include "util/bloom.h"
+#include "util/cache.h"
+#include "util/compression.h"
+#include "util/env.h"
+#include "test/table_test_util.h"
+
+//内置压缩算法和注册的字典压缩算法生成的table都能正确读取；
+//字典压缩时检查先缓存再写入的data block、之后直接写入的data block以及index分区
+
+static const leveldb::CompressionType kSubstitutionCompression = static_cast<leveldb::CompressionType>(0x11);
+
+//测试用的字典压缩: 输入中字典的每次出现替换成0xff 0x00，原有的0xff写成0xff 0x01
+//没有字典时不压缩；训练出的字典是样本中出现最多的子串
+class SubstitutionCompressor:public leveldb::Compressor{
+public:
+    const char* Name() const override { return "test.Substitution";}
+    leveldb::CompressionType Type() const override { return kSubstitutionCompression;}
+    bool Compress(const leveldb::Slice& input,const leveldb::Slice& dict,std::string* output) const override{
+        if(dict.empty()) return false;
+        output->clear();
+        leveldb::PutFixed32(output,static_cast<uint32_t>(input.size()));
+        for(size_t i=0;i<input.size();){
+            if(i+dict.size()<=input.size() && memcmp(input.data()+i,dict.data(),dict.size())==0){
+                output->push_back('\xff');
+                output->push_back('\x00');
+                i += dict.size();
+            }else if(input[i]=='\xff'){
+                output->push_back('\xff');
+                output->push_back('\x01');
+                i++;
+            }else{
+                output->push_back(input[i++]);
+            }
+        }
+        return true;
+    }
+    bool GetUncompressedLength(const leveldb::Slice& input,size_t* result) const override{
+        if(input.size()<4) return false;
+        *result = leveldb::DecodeFixed32(input.data());
+        return true;
+    }
+    bool Uncompress(const leveldb::Slice& input,const leveldb::Slice& dict,char* output,size_t output_length) const override{
+        std::string result;
+        for(size_t i=4;i<input.size();i++){
+            if(input[i]!='\xff'){
+                result.push_back(input[i]);
+            }else if(i+1<input.size() && input[i+1]=='\x00' && !dict.empty()){
+                result.append(dict.data(),dict.size());
+                i++;
+            }else if(i+1<input.size() && input[i+1]=='\x01'){
+                result.push_back('\xff');
+                i++;
+            }else{
+                return false;
+            }
+        }
+        if(result.size()!=output_length) return false;
+        memcpy(output,result.data(),output_length);
+        return true;
+    }
+    bool SupportsDictionary() const override { return true;}
+    bool TrainDictionary(const std::vector<leveldb::Slice>& samples,size_t max_length,std::string* dict) const override{
+        const size_t n = std::min<size_t>(max_length,32);
+        std::map<std::string,int> counts;
+        for(size_t s=0;s<samples.size();s++){
+            for(size_t i=0;i+n<=samples[s].size();i++){
+                counts[std::string(samples[s].data()+i,n)]++;
+            }
+        }
+        int best = 0;
+        for(std::map<std::string,int>::const_iterator it=counts.begin();it!=counts.end();++it){
+            if(it->second>best){
+                best = it->second;
+                *dict = it->first;
+            }
+        }
+        return best>1;
+    }
+};
+
+static std::string Key(int i){
+    char buf[32];
+    snprintf(buf,sizeof(buf),"key%08d",i);
+    return buf;
+}
+
+//每个value都包含同一段较长的文本，字典压缩时被替换掉
+static std::string Value(int i){
+    char buf[32];
+    snprintf(buf,sizeof(buf),"%d:",i);
+    return std::string(buf)+"the quick brown fox jumps over the lazy dog, "+std::string(i%5,'x');
+}
+
+//生成并读取table，返回table大小，读取结果不对时返回0
+static size_t BuildAndCheck(const leveldb::Options& build_options,int num_keys){
+    StringSink sink;
+    leveldb::TableBuilder builder(build_options,&sink);
+    for(int i=0;i<num_keys;i++){
+        builder.Add(Key(i),Value(i));
+    }
+    if(!builder.Finish().ok() || builder.FileSize()!=sink.contents().size()){
+        std::cout<<"build failed"<<std::endl;
+        return 0;
+    }
+    leveldb::Options options = build_options;
+    options.block_cache = leveldb::NewLRUCache(8<<20);
+    StringSource* source = new StringSource(sink.contents());
+    leveldb::Table* table = nullptr;
+    leveldb::Status s = leveldb::Table::Open(options,source,sink.contents().size(),&table);
+    bool ok = s.ok();
+    if(ok){
+        leveldb::ReadOptions read_options;
+        read_options.verify_checksums = true;
+        leveldb::Iterator* iter = table->NewIterator(read_options);
+        int count = 0;
+        for(iter->SeekToFirst();iter->Valid();iter->Next()){
+            if(iter->key()!=leveldb::Slice(Key(count)) || iter->value()!=leveldb::Slice(Value(count))) break;
+            count++;
+        }
+        if(count!=num_keys || !iter->status().ok()){
+            std::cout<<"scan mismatch at "<<count<<" "<<iter->status().ToString()<<std::endl;
+            ok = false;
+        }
+        delete iter;
+        for(int i=0;ok && i<num_keys;i+=37){
+            std::string value;
+            s = leveldb::TableCache::Get(table,read_options,Key(i),&value,SaveValue);
+            if(!s.ok() || value!=Value(i)){
+                std::cout<<"get mismatch for "<<Key(i)<<" "<<s.ToString()<<std::endl;
+                ok = false;
+            }
+        }
+    }else{
+        std::cout<<s.ToString()<<std::endl;
+    }
+    delete table;
+    delete source;
+    delete options.block_cache;
+    return ok ? sink.contents().size() : 0;
+}
+
+int main(){
+    const int kNumKeys = 20000;
+    leveldb::Options options;
+    options.comparator = leveldb::BytewiseComparator();
+    options.compression = leveldb::kNoCompression;
+    const size_t raw_size = BuildAndCheck(options,kNumKeys);
+    if(raw_size==0) return 1;
+    std::cout<<"no compression: "<<raw_size<<" bytes"<<std::endl;
+
+    //压缩库没有编译进来时按不压缩写入
+    const leveldb::CompressionType types[] = {leveldb::kSnappyCompression,leveldb::kLZ4Compression,leveldb::kZstdCompression};
+    for(size_t t=0;t<sizeof(types)/sizeof(types[0]);t++){
+        options.compression = types[t];
+        const size_t size = BuildAndCheck(options,kNumKeys);
+        if(size==0) return 1;
+        std::cout<<leveldb::GetCompressor(types[t])->Name()<<": "<<size<<" bytes"<<std::endl;
+    }
+
+    static SubstitutionCompressor substitution;
+    leveldb::RegisterCompressor(&substitution);
+    if(leveldb::GetCompressor(kSubstitutionCompression)!=&substitution){
+        std::cout<<"register failed"<<std::endl;
+        return 1;
+    }
+    options.compression = kSubstitutionCompression;
+    //没有字典时这个算法不压缩
+    if(BuildAndCheck(options,kNumKeys)!=raw_size){
+        std::cout<<"substitution without dictionary should not compress"<<std::endl;
+        return 1;
+    }
+    //采样大小约3KB，第一个data block之后训练字典，之后的block直接写入
+    options.compression_dict_bytes = 32;
+    const size_t dict_size = BuildAndCheck(options,kNumKeys);
+    if(dict_size==0 || dict_size>=raw_size*3/4) return 1;
+    std::cout<<"substitution with dictionary: "<<dict_size<<" bytes"<<std::endl;
+
+    //index分区也用字典压缩；table小于采样大小时在Finish中训练
+    options.index_layout = leveldb::kPartitionedIndex;
+    options.index_partition_size = 256;
+    if(BuildAndCheck(options,kNumKeys)==0) return 1;
+    options.compression_dict_bytes = 64*1024;
+    if(BuildAndCheck(options,500)==0) return 1;
+
+    //全表filter与字典压缩同时使用；基于block的filter需要data block的偏移，不使用字典
+    const leveldb::FilterPolicy* policy = leveldb::NewBloomFilterPolicy(10);
+    options.filter_policy = policy;
+    options.filter_layout = leveldb::kFullFilter;
+    options.compression_dict_bytes = 32;
+    if(BuildAndCheck(options,kNumKeys)==0) return 1;
+    options.filter_layout = leveldb::kBlockBasedFilter;
+    options.index_layout = leveldb::kSingleIndex;
+    const size_t block_filter_size = BuildAndCheck(options,kNumKeys);
+    delete policy;
+    if(block_filter_size==0) return 1;
+    std::cout<<"substitution with block-based filter: "<<block_filter_size<<" bytes"<<std::endl;
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include<iostream>
+#include<chrono>
+#include<string>
+#include<vector>
+#include "util/crc32c.h"
+#include "util/random.h"
+
+//检查各个crc32c实现在不同长度和对齐下与查表实现结果相同，并比较不同数据大小下的吞吐量
+
+typedef uint32_t (*ExtendFunction)(uint32_t crc,const char* data,size_t n);
+
+struct Implementation{
+    const char* name;
+    ExtendFunction extend;
+};
+
+static std::vector<Implementation> AvailableImplementations(){
+    std::vector<Implementation> impls;
+    impls.push_back({"portable",leveldb::crc32c::ExtendPortable});
+#ifdef LEVELDB_HAVE_X86_TARGET_ATTRIBUTE
+    if(leveldb::CpuHasSSE42() && leveldb::CpuHasPCLMUL()){
+        impls.push_back({"sse4.2",leveldb::crc32c::ExtendSSE42});
+    }
+#endif
+#ifdef LEVELDB_HAVE_ARM64_CRC32
+    if(leveldb::CpuHasARMCRC32()){
+        impls.push_back({"armv8",leveldb::crc32c::ExtendARM64});
+    }
+#endif
+    impls.push_back({"dispatched",leveldb::crc32c::Extend});
+    return impls;
+}
+
+static bool CheckImplementation(const Implementation& impl,const std::string& data){
+    //标准测试向量
+    char buf[32];
+    memset(buf,0,sizeof(buf));
+    if(impl.extend(0,buf,sizeof(buf))!=0x8a9136aa) return false;
+    memset(buf,0xff,sizeof(buf));
+    if(impl.extend(0,buf,sizeof(buf))!=0x62a8ab43) return false;
+    if(impl.extend(0,"123456789",9)!=0xe3069283) return false;
+
+    //覆盖三路交替计算的长短两种分段以及首尾不对齐的部分
+    const size_t lengths[] = {0,1,7,8,9,63,255,256,767,768,769,1000,4096,24575,24576,24577,100000,300000};
+    for(size_t i=0;i<sizeof(lengths)/sizeof(lengths[0]);i++){
+        for(size_t offset=0;offset<8;offset++){
+            const size_t n = lengths[i];
+            if(offset+n>data.size()) continue;
+            const uint32_t expected = leveldb::crc32c::ExtendPortable(0,data.data()+offset,n);
+            if(impl.extend(0,data.data()+offset,n)!=expected) return false;
+            //分两次Extend结果相同
+            const uint32_t first = impl.extend(0,data.data()+offset,n/3);
+            if(impl.extend(first,data.data()+offset+n/3,n-n/3)!=expected) return false;
+        }
+    }
+    return true;
+}
+
+int main(){
+    leveldb::Random rnd(301);
+    std::string data(1<<20,'\0');
+    for(size_t i=0;i<data.size();i++){
+        data[i] = static_cast<char>(rnd.Uniform(256));
+    }
+    const std::vector<Implementation> impls = AvailableImplementations();
+    for(size_t i=0;i<impls.size();i++){
+        if(!CheckImplementation(impls[i],data)){
+            std::cout<<impls[i].name<<" mismatch"<<std::endl;
+            return 1;
+        }
+    }
+
+    //每个大小总共计算256MB
+    const size_t sizes[] = {16,64,256,4096,65536,1<<20};
+    const size_t kTotalBytes = 256<<20;
+    for(size_t s=0;s<sizeof(sizes)/sizeof(sizes[0]);s++){
+        const size_t n = sizes[s];
+        std::cout<<"size "<<n<<":";
+        for(size_t i=0;i<impls.size();i++){
+            uint32_t crc = 0;
+            auto start = std::chrono::steady_clock::now();
+            for(size_t done=0;done<kTotalBytes;done+=n){
+                crc = impls[i].extend(crc,data.data()+done%data.size(),n);
+            }
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+            std::cout<<" "<<impls[i].name<<" "<<kTotalBytes/seconds/(1<<30)<<" GB/s";
+            if(crc==0) std::cout<<"*";
+        }
+        std::cout<<std::endl;
+    }
+    return 0;
+}
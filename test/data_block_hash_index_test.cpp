@@ -0,0 +1,190 @@
+#include<iostream>
+#include<chrono>
+#include<cstdio>
+#include<string>
+#include<vector>
+#include "table/table_builder.h"
+#include "table/table.h"
+#include "util/cache.h"
+#include "util/env.h"
+#include "test/table_test_util.h"
+
+//data block带hash索引和不带hash索引时点查结果相同，比较点查耗时；
+//同时用一个与InternalKeyComparator同名的comparator检查按user key建立索引时多版本的查找
+
+struct GetResult{
+    bool internal_keys;
+    std::string target;
+    std::string value;
+    bool found;
+};
+
+//与db中的SaveValue相同，只接受user key相同的entry
+static void SaveMatch(void* arg,const leveldb::Slice& k,const leveldb::Slice& v){
+    GetResult* r = reinterpret_cast<GetResult*>(arg);
+    const size_t n = r->internal_keys ? r->target.size()-8 : r->target.size();
+    const size_t kn = r->internal_keys ? k.size()-8 : k.size();
+    if(leveldb::Slice(k.data(),kn)==leveldb::Slice(r->target.data(),n)){
+        r->found = true;
+        r->value.assign(v.data(),v.size());
+    }
+}
+
+static std::string UserKey(int i){
+    char buf[32];
+    snprintf(buf,sizeof(buf),"key%010d",i);
+    return buf;
+}
+
+static std::string InternalKey(const std::string& user_key,uint64_t seq){
+    std::string key = user_key;
+    leveldb::PutFixed64(&key,seq);
+    return key;
+}
+
+static leveldb::Table* Build(const leveldb::Options& options,const std::vector<std::pair<std::string,std::string>>& kvs,
+                             std::string* contents,leveldb::RandomAccessFile** file){
+    StringSink sink;
+    leveldb::TableBuilder builder(options,&sink);
+    for(size_t i=0;i<kvs.size();i++){
+        builder.Add(kvs[i].first,kvs[i].second);
+    }
+    builder.Finish();
+    *contents = sink.contents();
+    *file = new StringSource(*contents);
+    leveldb::Table* table = nullptr;
+    leveldb::Status s = leveldb::Table::Open(options,*file,contents->size(),&table);
+    if(!s.ok()){
+        std::cout<<s.ToString()<<std::endl;
+    }
+    return table;
+}
+
+//比较两个table对targets的查找结果，返回每次查找的耗时
+static bool Compare(leveldb::Table* plain,leveldb::Table* hashed,const std::vector<std::string>& targets,
+                    bool internal_keys,double* plain_micros,double* hashed_micros){
+    std::vector<GetResult> expected(targets.size());
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i=0;i<targets.size();i++){
+        expected[i] = GetResult{internal_keys,targets[i],"",false};
+        leveldb::TableCache::Get(plain,leveldb::ReadOptions(),targets[i],&expected[i],SaveMatch);
+    }
+    *plain_micros = std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now()-start).count()/targets.size();
+    std::vector<GetResult> actual(targets.size());
+    start = std::chrono::steady_clock::now();
+    for(size_t i=0;i<targets.size();i++){
+        actual[i] = GetResult{internal_keys,targets[i],"",false};
+        leveldb::TableCache::Get(hashed,leveldb::ReadOptions(),targets[i],&actual[i],SaveMatch);
+    }
+    *hashed_micros = std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now()-start).count()/targets.size();
+    for(size_t i=0;i<targets.size();i++){
+        if(expected[i].found!=actual[i].found || expected[i].value!=actual[i].value){
+            std::cout<<"mismatch for target "<<i<<std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool TestBytewise(){
+    const int kNumKeys = 200000;
+    std::vector<std::pair<std::string,std::string>> kvs;
+    for(int i=0;i<kNumKeys;i++){
+        kvs.push_back(std::make_pair(UserKey(i*2),UserKey(i*2)+"-value"));
+    }
+    leveldb::Options options;
+    options.comparator = leveldb::BytewiseComparator();
+    options.compression = leveldb::kNoCompression;
+    options.block_cache = leveldb::NewLRUCache(64<<20);
+    std::string plain_contents,hashed_contents;
+    leveldb::RandomAccessFile* plain_file = nullptr;
+    leveldb::RandomAccessFile* hashed_file = nullptr;
+    leveldb::Table* plain = Build(options,kvs,&plain_contents,&plain_file);
+    options.data_block_hash_index = true;
+    leveldb::Table* hashed = Build(options,kvs,&hashed_contents,&hashed_file);
+    bool ok = plain!=nullptr && hashed!=nullptr;
+
+    //一半存在，一半不存在(落在存在的key之间)
+    std::vector<std::string> targets;
+    for(int i=0;i<kNumKeys*2;i++){
+        targets.push_back(UserKey(static_cast<int>((static_cast<uint64_t>(i)*7919)%(kNumKeys*2))));
+    }
+    double plain_micros,hashed_micros;
+    //第一遍填充cache
+    ok = ok && Compare(plain,hashed,targets,false,&plain_micros,&hashed_micros);
+    ok = ok && Compare(plain,hashed,targets,false,&plain_micros,&hashed_micros);
+    if(ok){
+        std::cout<<"bytewise: table size "<<plain_contents.size()<<" -> "<<hashed_contents.size()
+                 <<", get "<<plain_micros<<" us -> "<<hashed_micros<<" us"<<std::endl;
+    }
+    //带hash索引的table也能正常遍历
+    if(ok){
+        leveldb::Iterator* iter = hashed->NewIterator(leveldb::ReadOptions());
+        int count = 0;
+        for(iter->SeekToFirst();iter->Valid();iter->Next()){
+            if(iter->key()!=leveldb::Slice(kvs[count].first)) break;
+            count++;
+        }
+        if(count!=kNumKeys){
+            std::cout<<"scan mismatch "<<count<<std::endl;
+            ok = false;
+        }
+        delete iter;
+    }
+    delete plain;
+    delete hashed;
+    delete plain_file;
+    delete hashed_file;
+    delete options.block_cache;
+    return ok;
+}
+
+static bool TestInternalKeys(){
+    //每个user key有1~3个版本，同一个user key的版本可能跨越重启区间
+    const int kNumUserKeys = 50000;
+    TestInternalKeyComparator comparator;
+    std::vector<std::pair<std::string,std::string>> kvs;
+    for(int i=0;i<kNumUserKeys;i++){
+        const int versions = 1+i%3;
+        for(int v=versions;v>=1;v--){
+            char value[32];
+            snprintf(value,sizeof(value),"v%d-%d",i,v);
+            kvs.push_back(std::make_pair(InternalKey(UserKey(i*2),v*10),value));
+        }
+    }
+    leveldb::Options options;
+    options.comparator = &comparator;
+    options.compression = leveldb::kNoCompression;
+    std::string plain_contents,hashed_contents;
+    leveldb::RandomAccessFile* plain_file = nullptr;
+    leveldb::RandomAccessFile* hashed_file = nullptr;
+    leveldb::Table* plain = Build(options,kvs,&plain_contents,&plain_file);
+    options.data_block_hash_index = true;
+    leveldb::Table* hashed = Build(options,kvs,&hashed_contents,&hashed_file);
+    bool ok = plain!=nullptr && hashed!=nullptr;
+
+    //不同快照下查找存在和不存在的user key
+    std::vector<std::string> targets;
+    const uint64_t snapshots[] = {5,10,15,25,100};
+    for(int i=0;i<kNumUserKeys*2;i+=3){
+        for(size_t s=0;s<sizeof(snapshots)/sizeof(snapshots[0]);s++){
+            targets.push_back(InternalKey(UserKey(i),snapshots[s]));
+        }
+    }
+    double plain_micros,hashed_micros;
+    ok = ok && Compare(plain,hashed,targets,true,&plain_micros,&hashed_micros);
+    if(ok){
+        std::cout<<"internal keys: get "<<plain_micros<<" us -> "<<hashed_micros<<" us"<<std::endl;
+    }
+    delete plain;
+    delete hashed;
+    delete plain_file;
+    delete hashed_file;
+    return ok;
+}
+
+int main(){
+    if(!TestBytewise()) return 1;
+    if(!TestInternalKeys()) return 1;
+    return 0;
+}
@@ -0,0 +1,225 @@
+#include<iostream>
+#include<cstdio>
+#include<fstream>
+#include<sstream>
+#include<string>
+#include<vector>
+#include "table/table_builder.h"
+#include "table/table.h"
+#include "util/env_posix.h"
+#include "util/random.h"
+#include "test/table_test_util.h"
+
+//O_DIRECT写入的文件内容与内存中的结果相同，中途Flush后文件大小正确；写入和后台读取之后文件的页不在page cache中；
+//O_DIRECT读取任意偏移和长度的结果正确，通过它打开的Table可以完整扫描
+
+static const int kNumKeys = 100000;
+
+static std::string Key(int i){
+    char buf[32];
+    snprintf(buf,sizeof(buf),"key%010d",i);
+    return buf;
+}
+
+static void BuildTable(const leveldb::Options& options,leveldb::WritableFile* file){
+    leveldb::TableBuilder builder(options,file);
+    leveldb::Random rnd(301);
+    std::string value;
+    for(int i=0;i<kNumKeys;i++){
+        value.clear();
+        for(int j=0;j<100;j++){
+            value.push_back(static_cast<char>(' '+rnd.Uniform(95)));
+        }
+        builder.Add(Key(i),value);
+    }
+    builder.Finish();
+}
+
+static std::string ReadFile(const std::string& fname){
+    std::ifstream in(fname,std::ios::binary);
+    std::stringstream ss;
+    ss<<in.rdbuf();
+    return ss.str();
+}
+
+static uint64_t FileSize(const std::string& fname){
+    struct stat st;
+    return stat(fname.c_str(),&st)==0 ? static_cast<uint64_t>(st.st_size) : 0;
+}
+
+//文件在page cache中的页所占的比例
+static double ResidentRatio(const std::string& fname){
+    const size_t size = static_cast<size_t>(FileSize(fname));
+    int fd = open(fname.c_str(),O_RDONLY);
+    void* base = mmap(nullptr,size,PROT_READ,MAP_SHARED,fd,0);
+    close(fd);
+    if(base==MAP_FAILED) return 1.0;
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    std::vector<unsigned char> vec((size+page-1)/page);
+    size_t resident = 0;
+    if(mincore(base,size,vec.data())==0){
+        for(size_t i=0;i<vec.size();i++){
+            if(vec[i] & 1) resident++;
+        }
+    }
+    munmap(base,size);
+    return static_cast<double>(resident)/vec.size();
+}
+
+static void DropCache(const std::string& fname){
+    int fd = open(fname.c_str(),O_RDONLY);
+    posix_fadvise(fd,0,0,POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+//随机大小的Append，中途Flush后文件大小等于已追加的数据量
+static bool TestWritableFile(const std::string& fname){
+    leveldb::WritableFile* file = nullptr;
+    leveldb::Status s = leveldb::NewPosixWritableFile(fname,8192,true,&file);
+    if(!s.ok()){
+        std::cout<<s.ToString()<<std::endl;
+        return false;
+    }
+    leveldb::PosixWritableFile* posix_file = static_cast<leveldb::PosixWritableFile*>(file);
+    std::cout<<"O_DIRECT writes "<<(posix_file->use_direct_io() ? "enabled" : "not supported")<<std::endl;
+    leveldb::Random rnd(17);
+    std::string expected;
+    bool ok = true;
+    for(int i=0;ok && i<500;i++){
+        std::string data(rnd.Uniform(i%50==0 ? 40000 : 3000),'\0');
+        for(size_t j=0;j<data.size();j++){
+            data[j] = static_cast<char>(rnd.Uniform(256));
+        }
+        s = i%3==0 ? file->AppendWithTrailer(data,"trailer") : file->Append(data);
+        expected += data;
+        if(i%3==0) expected += "trailer";
+        if(s.ok() && i%7==0){
+            s = file->Flush();
+            if(s.ok() && FileSize(fname)!=expected.size()){
+                std::cout<<"size after flush "<<FileSize(fname)<<", expected "<<expected.size()<<std::endl;
+                ok = false;
+            }
+        }
+        if(!s.ok()){
+            std::cout<<s.ToString()<<std::endl;
+            ok = false;
+        }
+    }
+    s = file->Close();
+    delete file;
+    if(!s.ok() || ReadFile(fname)!=expected){
+        std::cout<<"direct write content mismatch: "<<s.ToString()<<std::endl;
+        ok = false;
+    }
+    return ok;
+}
+
+//任意偏移和长度的读取，以及越过文件末尾的读取
+static bool TestRandomReads(const std::string& fname,const std::string& expected){
+    leveldb::Options options;
+    options.use_direct_reads_for_background = true;
+    options.direct_io_readahead_size = 64*1024;
+    leveldb::RandomAccessFile* file = nullptr;
+    leveldb::Status s = leveldb::NewBackgroundRandomAccessFile(options,fname,&file);
+    if(!s.ok()){
+        std::cout<<s.ToString()<<std::endl;
+        return false;
+    }
+    leveldb::Random rnd(29);
+    std::string scratch(300000,'\0');
+    bool ok = true;
+    for(int i=0;ok && i<2000;i++){
+        const uint64_t offset = rnd.Uniform(static_cast<int>(expected.size()+100));
+        const size_t n = rnd.Uniform(i%10==0 ? 300000 : 5000);
+        leveldb::Slice result;
+        s = file->Read(offset,n,&result,&scratch[0]);
+        const size_t want = offset>=expected.size() ? 0 : std::min<size_t>(n,expected.size()-offset);
+        if(!s.ok() || result.size()!=want || (want>0 && result!=leveldb::Slice(expected.data()+offset,want))){
+            std::cout<<"read "<<offset<<"+"<<n<<" mismatch: "<<s.ToString()<<std::endl;
+            ok = false;
+        }
+    }
+    delete file;
+    return ok;
+}
+
+//通过后台文件打开Table并完整扫描
+static bool TestBackgroundScan(const std::string& fname){
+    leveldb::Options options;
+    options.comparator = leveldb::BytewiseComparator();
+    options.use_direct_reads_for_background = true;
+    leveldb::RandomAccessFile* file = nullptr;
+    leveldb::Status s = leveldb::NewBackgroundRandomAccessFile(options,fname,&file);
+    leveldb::Table* table = nullptr;
+    if(s.ok()){
+        s = leveldb::Table::Open(options,file,FileSize(fname),&table);
+    }
+    if(!s.ok()){
+        std::cout<<s.ToString()<<std::endl;
+        delete file;
+        return false;
+    }
+    leveldb::ReadOptions read_options;
+    read_options.fill_cache = false;
+    read_options.verify_checksums = true;
+    leveldb::Iterator* iter = table->NewIterator(read_options);
+    int count = 0;
+    bool ok = true;
+    for(iter->SeekToFirst();ok && iter->Valid();iter->Next()){
+        if(iter->key()!=leveldb::Slice(Key(count)) || iter->value().size()!=100){
+            ok = false;
+        }
+        count++;
+    }
+    if(!iter->status().ok() || count!=kNumKeys){
+        std::cout<<"background scan got "<<count<<" keys: "<<iter->status().ToString()<<std::endl;
+        ok = false;
+    }
+    delete iter;
+    delete table;
+    delete file;
+    return ok;
+}
+
+int main(){
+    const std::string fname = "/tmp/leveldb_direct_io_test.ldb";
+    bool ok = TestWritableFile(fname);
+
+    leveldb::Options options;
+    options.comparator = leveldb::BytewiseComparator();
+    options.compression = leveldb::kNoCompression;
+    StringSink sink;
+    BuildTable(options,&sink);
+    const std::string& expected = sink.contents();
+    for(int direct=0;ok && direct<2;direct++){
+        options.use_direct_io_for_table_builds = direct==1;
+        leveldb::WritableFile* file = nullptr;
+        leveldb::Status s = leveldb::NewTableWritableFile(options,fname,&file);
+        if(!s.ok()){
+            std::cout<<s.ToString()<<std::endl;
+            ok = false;
+            break;
+        }
+        const bool use_direct_io = static_cast<leveldb::PosixWritableFile*>(file)->use_direct_io();
+        BuildTable(options,file);
+        s = file->Close();
+        delete file;
+        //O_DIRECT写入的页不进入page cache
+        const double resident = ResidentRatio(fname);
+        std::cout<<(direct ? "O_DIRECT" : "buffered")<<" table build: "<<resident*100<<"% of pages cached"<<std::endl;
+        if(!s.ok() || ReadFile(fname)!=expected || (use_direct_io && resident>0.05)){
+            std::cout<<"table build mismatch: "<<s.ToString()<<std::endl;
+            ok = false;
+        }
+    }
+    if(ok){
+        ok = TestRandomReads(fname,expected);
+    }
+    if(ok){
+        DropCache(fname);
+        ok = TestBackgroundScan(fname);
+        std::cout<<"after O_DIRECT background scan: "<<ResidentRatio(fname)*100<<"% of pages cached"<<std::endl;
+    }
+    std::remove(fname.c_str());
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+#include<iostream>
+#include<chrono>
+#include<cstdio>
+#include<string>
+#include "table/table_builder.h"
+#include "table/table.h"
+#include "util/bloom.h"
+#include "util/xor_filter.h"
+#include "util/cache.h"
+#include "util/env.h"
+#include "test/table_test_util.h"
+
+//点查不存在的key时，比较有无bloom filter的data block读取次数和耗时
+
+static void CountResult(void* arg,const leveldb::Slice& k,const leveldb::Slice& v){
+    (*reinterpret_cast<int*>(arg))++;
+}
+
+void bench(const leveldb::FilterPolicy* policy,leveldb::FilterLayout layout,const char* label){
+    const int kNumKeys = 200000;
+    leveldb::Options options;
+    options.comparator = leveldb::BytewiseComparator();
+    options.compression = leveldb::kNoCompression;
+    options.filter_policy = policy;
+    options.filter_layout = layout;
+    //分区filter经过block cache读取，其他情况不使用cache，以便统计data block的读取次数
+    if(layout==leveldb::kPartitionedFilter){
+        options.block_cache = leveldb::NewLRUCache(64<<20);
+    }
+    StringSink sink;
+    leveldb::TableBuilder builder(options,&sink);
+    char buf[32];
+    //只写入偶数key，查询奇数key必然不存在
+    for(int i=0;i<kNumKeys;i++){
+        snprintf(buf,sizeof(buf),"key%010d",i*2);
+        builder.Add(buf,std::string(100,'v'));
+    }
+    builder.Finish();
+
+    StringSource* source = new StringSource(sink.contents());
+    leveldb::Table* table = nullptr;
+    leveldb::Status s = leveldb::Table::Open(options,source,sink.contents().size(),&table);
+    if(!s.ok()){
+        std::cout<<s.ToString()<<std::endl;
+        return;
+    }
+    //存在的key必须全部找到
+    int found = 0;
+    for(int i=0;i<kNumKeys;i+=97){
+        snprintf(buf,sizeof(buf),"key%010d",i*2);
+        leveldb::TableCache::Get(table,leveldb::ReadOptions(),buf,&found,CountResult);
+    }
+    if(found!=(kNumKeys+96)/97){
+        std::cout<<label<<": lost keys, found "<<found<<std::endl;
+    }
+    const uint64_t reads_before = source->reads();
+    auto start = std::chrono::steady_clock::now();
+    for(int i=0;i<kNumKeys;i++){
+        snprintf(buf,sizeof(buf),"key%010d",i*2+1);
+        leveldb::TableCache::Get(table,leveldb::ReadOptions(),buf,&found,CountResult);
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::cout<<label<<": "<<std::chrono::duration<double,std::micro>(end-start).count()/kNumKeys<<" us/get"
+             <<", block reads per miss: "<<static_cast<double>(source->reads()-reads_before)/kNumKeys
+             <<std::endl;
+    delete table;
+    delete source;
+    delete options.block_cache;
+}
+
+int main(){
+    bench(nullptr,leveldb::kBlockBasedFilter,"no filter");
+    const leveldb::FilterPolicy* bloom = leveldb::NewBloomFilterPolicy(10);
+    bench(bloom,leveldb::kBlockBasedFilter,"bloom, block based");
+    bench(bloom,leveldb::kFullFilter,"bloom, full");
+    bench(bloom,leveldb::kPartitionedFilter,"bloom, partitioned");
+    delete bloom;
+    const leveldb::FilterPolicy* cache_line_bloom = leveldb::NewCacheLineBloomFilterPolicy(10);
+    bench(cache_line_bloom,leveldb::kBlockBasedFilter,"cache line bloom, block based");
+    bench(cache_line_bloom,leveldb::kFullFilter,"cache line bloom, full");
+    delete cache_line_bloom;
+    const leveldb::FilterPolicy* xor_filter = leveldb::NewXorFilterPolicy(10);
+    bench(xor_filter,leveldb::kFullFilter,"xor, full");
+    bench(xor_filter,leveldb::kPartitionedFilter,"xor, partitioned");
+    delete xor_filter;
+    return 0;
+}
@@ -0,0 +1,48 @@
+#include<iostream>
+#include<chrono>
+#include<string>
+#include "util/hash.h"
+#include "util/random.h"
+
+//比较Hash和Hash64在不同key长度下的吞吐，16字节对应block cache的key；
+//Hash64Fixed16是Hash64对16字节key的特化，两者的结果必须相同，否则cache的分片会错乱
+template<typename Func>
+double bench(const std::string& data,size_t len,Func func){
+    const size_t kIters = 20000000/(len/16+1);
+    uint64_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i=0;i<kIters;i++){
+        sink += func(data.data()+(i&63),len);
+    }
+    auto end = std::chrono::steady_clock::now();
+    if(sink==42) std::cout<<"";
+    return std::chrono::duration<double,std::nano>(end-start).count()/kIters;
+}
+
+int main(){
+    leveldb::Random rnd(301);
+    std::string data;
+    for(int i=0;i<4096+64;i++){
+        data.push_back(static_cast<char>(rnd.Uniform(256)));
+    }
+    for(int i=0;i<100000;i++){
+        const char* p = data.data()+rnd.Uniform(4096);
+        const uint64_t seed = i%2==0 ? 0 : (static_cast<uint64_t>(rnd.Next())<<32 | rnd.Next());
+        if(leveldb::Hash64Fixed16(p,seed)!=leveldb::Hash64(p,16,seed)){
+            std::cout<<"Hash64Fixed16 differs from Hash64 at offset "<<(p-data.data())<<" seed "<<seed<<std::endl;
+            return 1;
+        }
+    }
+    const size_t lens[] = {8,16,24,64,256,4096};
+    for(size_t len:lens){
+        double h32 = bench(data,len,[](const char* p,size_t n){ return static_cast<uint64_t>(leveldb::Hash(p,n,0));});
+        double h64 = bench(data,len,[](const char* p,size_t n){ return leveldb::Hash64(p,n,0);});
+        std::cout<<"len="<<len<<" Hash: "<<h32<<" ns/op, Hash64: "<<h64<<" ns/op";
+        if(len==16){
+            double f16 = bench(data,len,[](const char* p,size_t){ return leveldb::Hash64Fixed16(p,0);});
+            std::cout<<", Hash64Fixed16: "<<f16<<" ns/op";
+        }
+        std::cout<<std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include<iostream>
+#include<cstdio>
+#include<string>
+#include "db/memtable.h"
+#include "util/comparator.h"
+#include "util/slice_transform.h"
+
+//memtable的前缀bloom filter: prefix_seek时前缀不存在的Seek直接得到无效的迭代器，前缀存在时结果正确；
+//不指定prefix_seek的迭代器和Get不受影响
+
+static const int kNumPrefixes = 1000;
+static const int kKeysPerPrefix = 10;
+
+//前缀为8字节"pre%05d"
+static std::string Key(int prefix,int suffix){
+    char buf[32];
+    snprintf(buf,sizeof(buf),"pre%05d-%04d",prefix,suffix);
+    return buf;
+}
+
+//查找user_key的所有版本
+static std::string SeekKey(const std::string& user_key){
+    std::string result = user_key;
+    leveldb::PutFixed64(&result,leveldb::PackSequenceAndType(leveldb::kMaxSequenceNumber,leveldb::kValueTypeForSeek));
+    return result;
+}
+
+int main(){
+    const leveldb::SliceTransform* extractor = leveldb::NewFixedPrefixTransform(8);
+    leveldb::InternalComparator comparator(leveldb::BytewiseComparator());
+    leveldb::MemTable* mem = new leveldb::MemTable(comparator,extractor);
+    mem->Ref();
+    //只写入偶数前缀
+    leveldb::SequenceNumber seq = 1;
+    for(int p=0;p<kNumPrefixes;p++){
+        for(int i=0;i<kKeysPerPrefix;i++){
+            mem->Add(seq++,leveldb::kTypeValue,Key(p*2,i),"v"+Key(p*2,i));
+        }
+    }
+    bool ok = true;
+
+    leveldb::ReadOptions read_options;
+    read_options.prefix_seek = true;
+    leveldb::Iterator* iter = mem->NewIterator(read_options);
+    leveldb::Iterator* full_iter = mem->NewIterator();
+    int false_positives = 0;
+    for(int p=0;ok && p<kNumPrefixes;p++){
+        //不存在的前缀被跳过，没有被过滤时也不能返回该前缀的key
+        const std::string absent = Key(p*2+1,0);
+        iter->Seek(SeekKey(absent));
+        if(iter->Valid()){
+            false_positives++;
+            if(leveldb::ExtractUserKey(iter->key()).starts_with(absent.substr(0,8))){
+                std::cout<<"found absent prefix "<<p*2+1<<std::endl;
+                ok = false;
+            }
+        }
+        //普通迭代器仍然定位到下一个key
+        full_iter->Seek(SeekKey(absent));
+        if(p+1<kNumPrefixes && (!full_iter->Valid() || leveldb::ExtractUserKey(full_iter->key())!=leveldb::Slice(Key(p*2+2,0)))){
+            std::cout<<"full iterator lost key after prefix "<<p*2+1<<std::endl;
+            ok = false;
+        }
+        //存在的前缀可以找到，并且可以继续遍历该前缀下的key
+        const int suffix = p%kKeysPerPrefix;
+        iter->Seek(SeekKey(Key(p*2,suffix)));
+        for(int i=suffix;ok && i<kKeysPerPrefix;i++){
+            if(!iter->Valid() || leveldb::ExtractUserKey(iter->key())!=leveldb::Slice(Key(p*2,i)) ||
+               iter->value()!=leveldb::Slice("v"+Key(p*2,i))){
+                std::cout<<"prefix seek missed "<<Key(p*2,i)<<std::endl;
+                ok = false;
+            }
+            iter->Next();
+        }
+    }
+    //被过滤的Seek之后SeekToFirst恢复正常
+    iter->Seek(SeekKey(Key(1,0)));
+    iter->SeekToFirst();
+    if(!iter->Valid() || leveldb::ExtractUserKey(iter->key())!=leveldb::Slice(Key(0,0))){
+        std::cout<<"SeekToFirst after filtered seek failed"<<std::endl;
+        ok = false;
+    }
+    delete full_iter;
+    delete iter;
+
+    //Get也使用前缀bloom filter
+    std::string value;
+    leveldb::Status s;
+    for(int p=0;ok && p<kNumPrefixes;p++){
+        leveldb::LookupKey present(Key(p*2,3),seq);
+        if(!mem->Get(present,&value,&s) || value!="v"+Key(p*2,3)){
+            std::cout<<"Get missed "<<Key(p*2,3)<<std::endl;
+            ok = false;
+        }
+        leveldb::LookupKey absent(Key(p*2+1,3),seq);
+        if(mem->Get(absent,&value,&s)){
+            std::cout<<"Get found "<<Key(p*2+1,3)<<std::endl;
+            ok = false;
+        }
+    }
+
+    std::cout<<kNumPrefixes<<" absent prefixes, "<<false_positives<<" not filtered"<<std::endl;
+    //默认512K位，1000个前缀时假阳率远小于1%
+    if(false_positives>kNumPrefixes/100) ok = false;
+    mem->Unref();
+    delete extractor;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,107 @@
+#include<iostream>
+#include<chrono>
+#include<cstdio>
+#include<fstream>
+#include<string>
+#include "table/table_builder.h"
+#include "table/table.h"
+#include "util/cache.h"
+#include "util/env_posix.h"
+#include "test/table_test_util.h"
+
+//比较pread和mmap两种RandomAccessFile读取sstable的结果和点查耗时
+
+static const int kNumKeys = 200000;
+
+static std::string Key(int i){
+    char buf[32];
+    snprintf(buf,sizeof(buf),"key%010d",i);
+    return buf;
+}
+
+static bool test(const std::string& fname,bool use_mmap,leveldb::CompressionType compression){
+    leveldb::Options options;
+    options.comparator = leveldb::BytewiseComparator();
+    options.compression = compression;
+    options.block_cache = leveldb::NewLRUCache(64<<20);
+    leveldb::RandomAccessFile* file = nullptr;
+    leveldb::Status s = leveldb::NewPosixRandomAccessFile(fname,use_mmap,leveldb::kRandomAccess,&file);
+    leveldb::Table* table = nullptr;
+    if(s.ok()){
+        std::ifstream in(fname,std::ios::binary | std::ios::ate);
+        s = leveldb::Table::Open(options,file,static_cast<uint64_t>(in.tellg()),&table);
+    }
+    if(!s.ok()){
+        std::cout<<s.ToString()<<std::endl;
+        delete file;
+        delete options.block_cache;
+        return false;
+    }
+    bool ok = true;
+    //顺序扫描结果必须完整
+    leveldb::Iterator* iter = table->NewIterator(leveldb::ReadOptions());
+    int count = 0;
+    for(iter->SeekToFirst();iter->Valid();iter->Next()){
+        if(iter->key()!=leveldb::Slice(Key(count)) || iter->value().size()!=100){
+            ok = false;
+            break;
+        }
+        count++;
+    }
+    delete iter;
+    if(!ok || count!=kNumKeys){
+        std::cout<<"scan mismatch at "<<count<<std::endl;
+        ok = false;
+    }
+
+    std::string value;
+    auto start = std::chrono::steady_clock::now();
+    for(int i=0;ok && i<kNumKeys;i++){
+        const std::string key = Key((i*7919)%kNumKeys);
+        value.clear();
+        leveldb::TableCache::Get(table,leveldb::ReadOptions(),key,&value,SaveValue);
+        if(value.size()!=100){
+            std::cout<<"get "<<key<<" failed"<<std::endl;
+            ok = false;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    if(ok){
+        std::cout<<(use_mmap ? "mmap " : "pread")
+                 <<(compression==leveldb::kNoCompression ? " uncompressed" : " snappy      ")
+                 <<": "<<std::chrono::duration<double,std::micro>(end-start).count()/kNumKeys<<" us/get"
+                 <<", cache usage "<<options.block_cache->TotalCharge()<<" bytes"<<std::endl;
+    }
+    delete table;
+    delete file;
+    delete options.block_cache;
+    return ok;
+}
+
+static void WriteTable(const std::string& fname,leveldb::CompressionType compression){
+    leveldb::Options options;
+    options.comparator = leveldb::BytewiseComparator();
+    options.compression = compression;
+    StringSink sink;
+    leveldb::TableBuilder builder(options,&sink);
+    for(int i=0;i<kNumKeys;i++){
+        builder.Add(Key(i),std::string(100,'a'+i%26));
+    }
+    builder.Finish();
+    std::ofstream out(fname,std::ios::binary | std::ios::trunc);
+    out.write(sink.contents().data(),sink.contents().size());
+}
+
+int main(){
+    const std::string fname = "/tmp/leveldb_mmap_read_test.ldb";
+    const leveldb::CompressionType types[] = {leveldb::kNoCompression,leveldb::kSnappyCompression};
+    for(size_t t=0;t<2;t++){
+        WriteTable(fname,types[t]);
+        if(!test(fname,false,types[t]) || !test(fname,true,types[t])){
+            std::remove(fname.c_str());
+            return 1;
+        }
+    }
+    std::remove(fname.c_str());
+    return 0;
+}
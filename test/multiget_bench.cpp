@@ -0,0 +1,94 @@
+#include<iostream>
+#include<algorithm>
+#include<chrono>
+#include<cstdio>
+#include<string>
+#include<vector>
+#include "table/table_builder.h"
+#include "table/table.h"
+#include "util/cache.h"
+#include "util/env.h"
+#include "util/random.h"
+#include "test/table_test_util.h"
+
+//比较逐个InternalGet和Table::MultiGet的结果、文件读取次数和耗时
+
+static void SaveMultiValue(void* arg,size_t index,const leveldb::Slice& k,const leveldb::Slice& v){
+    (*reinterpret_cast<std::vector<std::string>*>(arg))[index].assign(v.data(),v.size());
+}
+
+static std::string Key(int i){
+    char buf[32];
+    snprintf(buf,sizeof(buf),"key%010d",i);
+    return buf;
+}
+
+int main(){
+    const int kNumKeys = 200000;
+    const int kBatchSize = 64;
+    const int kNumBatches = 2000;
+    leveldb::Options options;
+    options.comparator = leveldb::BytewiseComparator();
+    options.compression = leveldb::kNoCompression;
+    StringSink sink;
+    leveldb::TableBuilder builder(options,&sink);
+    for(int i=0;i<kNumKeys;i++){
+        builder.Add(Key(i*2),Key(i*2)+"-value");
+    }
+    builder.Finish();
+
+    //不使用cache，比较的是每批key需要的文件读取次数
+    StringSource* source = new StringSource(sink.contents());
+    leveldb::Table* table = nullptr;
+    leveldb::Status s = leveldb::Table::Open(options,source,sink.contents().size(),&table);
+    if(!s.ok()){
+        std::cout<<s.ToString()<<std::endl;
+        return 1;
+    }
+
+    //每批key集中在一段范围内，其中一半不存在
+    leveldb::Random rnd(301);
+    std::vector<std::vector<std::string>> batches(kNumBatches);
+    for(int b=0;b<kNumBatches;b++){
+        const int base = rnd.Uniform(kNumKeys*2-4000);
+        for(int i=0;i<kBatchSize;i++){
+            batches[b].push_back(Key(base+rnd.Uniform(4000)));
+        }
+        std::sort(batches[b].begin(),batches[b].end());
+    }
+
+    std::vector<std::vector<std::string>> expected(kNumBatches);
+    uint64_t reads_before = source->reads();
+    auto start = std::chrono::steady_clock::now();
+    for(int b=0;b<kNumBatches;b++){
+        for(int i=0;i<kBatchSize;i++){
+            std::string value;
+            leveldb::TableCache::Get(table,leveldb::ReadOptions(),batches[b][i],&value,SaveValue);
+            expected[b].push_back(value);
+        }
+    }
+    double micros = std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now()-start).count();
+    std::cout<<"InternalGet: "<<micros/kNumBatches<<" us/batch, reads/batch "
+             <<static_cast<double>(source->reads()-reads_before)/kNumBatches<<std::endl;
+
+    bool ok = true;
+    reads_before = source->reads();
+    start = std::chrono::steady_clock::now();
+    for(int b=0;ok && b<kNumBatches;b++){
+        std::vector<leveldb::Slice> keys(batches[b].begin(),batches[b].end());
+        std::vector<std::string> values(kBatchSize);
+        s = table->MultiGet(leveldb::ReadOptions(),keys.data(),keys.size(),&values,SaveMultiValue);
+        if(!s.ok() || values!=expected[b]){
+            std::cout<<"MultiGet mismatch in batch "<<b<<" "<<s.ToString()<<std::endl;
+            ok = false;
+        }
+    }
+    micros = std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now()-start).count();
+    if(ok){
+        std::cout<<"MultiGet:    "<<micros/kNumBatches<<" us/batch, reads/batch "
+                 <<static_cast<double>(source->reads()-reads_before)/kNumBatches<<std::endl;
+    }
+    delete table;
+    delete source;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+#include<iostream>
+#include<cstdio>
+#include<string>
+#include<vector>
+#include "table/table_builder.h"
+#include "table/table.h"
+#include "util/cache.h"
+#include "util/env.h"
+#include "test/table_test_util.h"
+
+//分区index与单个index block的查找、遍历结果相同，比较Open时读取的字节数和常驻的index大小
+
+static void SaveKey(void* arg,const leveldb::Slice& k,const leveldb::Slice& v){
+    reinterpret_cast<std::string*>(arg)->assign(k.data(),k.size());
+}
+
+static void SaveMultiValue(void* arg,size_t index,const leveldb::Slice& k,const leveldb::Slice& v){
+    (*reinterpret_cast<std::vector<std::string>*>(arg))[index].assign(k.data(),k.size());
+}
+
+static const int kNumKeys = 500000;
+
+static std::string Key(int i){
+    char buf[32];
+    snprintf(buf,sizeof(buf),"key%010d",i);
+    return buf;
+}
+
+struct OpenTable{
+    std::string contents;
+    StringSource* source;
+    leveldb::Table* table;
+    leveldb::Cache* cache;
+    uint64_t open_bytes;
+};
+
+static bool Open(leveldb::IndexLayout layout,OpenTable* t){
+    leveldb::Options options;
+    options.comparator = leveldb::BytewiseComparator();
+    options.compression = leveldb::kNoCompression;
+    options.index_layout = layout;
+    StringSink sink;
+    leveldb::TableBuilder builder(options,&sink);
+    for(int i=0;i<kNumKeys;i++){
+        builder.Add(Key(i*2),"v");
+    }
+    if(!builder.Finish().ok()) return false;
+    t->contents = sink.contents();
+    t->cache = leveldb::NewLRUCache(64<<20);
+    options.block_cache = t->cache;
+    t->source = new StringSource(t->contents);
+    t->table = nullptr;
+    leveldb::Status s = leveldb::Table::Open(options,t->source,t->contents.size(),&t->table);
+    t->open_bytes = t->source->bytes();
+    if(!s.ok()){
+        std::cout<<s.ToString()<<std::endl;
+        return false;
+    }
+    return true;
+}
+
+static void Close(OpenTable* t){
+    delete t->table;
+    delete t->source;
+    delete t->cache;
+}
+
+int main(){
+    OpenTable single,partitioned;
+    if(!Open(leveldb::kSingleIndex,&single) || !Open(leveldb::kPartitionedIndex,&partitioned)){
+        return 1;
+    }
+    bool ok = true;
+    std::cout<<"open bytes: single "<<single.open_bytes<<", partitioned "<<partitioned.open_bytes<<std::endl;
+
+    //集中在一小段范围内的点查只读取少量index分区
+    const size_t partitioned_cache_before = partitioned.cache->TotalCharge();
+    for(int i=0;ok && i<2000;i++){
+        std::string a,b;
+        const std::string key = Key(1000+i);
+        leveldb::TableCache::Get(single.table,leveldb::ReadOptions(),key,&a,SaveKey);
+        leveldb::TableCache::Get(partitioned.table,leveldb::ReadOptions(),key,&b,SaveKey);
+        if(a!=b || (i%2==0 && a!=key)){
+            std::cout<<"get mismatch for "<<key<<std::endl;
+            ok = false;
+        }
+    }
+    if(ok){
+        std::cout<<"hot range gets: cache usage single "<<single.cache->TotalCharge()<<" bytes, partitioned "
+                 <<partitioned.cache->TotalCharge()-partitioned_cache_before<<" bytes (including index partitions)"<<std::endl;
+    }
+
+    //全范围点查
+    for(int i=0;ok && i<kNumKeys*2+2;i+=7){
+        std::string a,b;
+        leveldb::TableCache::Get(single.table,leveldb::ReadOptions(),Key(i),&a,SaveKey);
+        leveldb::TableCache::Get(partitioned.table,leveldb::ReadOptions(),Key(i),&b,SaveKey);
+        if(a!=b){
+            std::cout<<"get mismatch for "<<Key(i)<<std::endl;
+            ok = false;
+        }
+        if(single.table->ApproximateOffsetOf(Key(i))!=partitioned.table->ApproximateOffsetOf(Key(i)) && i<kNumKeys*2-2){
+            std::cout<<"offset mismatch for "<<Key(i)<<std::endl;
+            ok = false;
+        }
+    }
+
+    //正向和反向遍历
+    leveldb::Iterator* iter = partitioned.table->NewIterator(leveldb::ReadOptions());
+    int count = 0;
+    for(iter->SeekToFirst();ok && iter->Valid();iter->Next()){
+        if(iter->key()!=leveldb::Slice(Key(count*2))) break;
+        count++;
+    }
+    if(ok && count!=kNumKeys){
+        std::cout<<"forward scan mismatch at "<<count<<std::endl;
+        ok = false;
+    }
+    count = kNumKeys;
+    for(iter->SeekToLast();ok && iter->Valid();iter->Prev()){
+        count--;
+        if(iter->key()!=leveldb::Slice(Key(count*2))) break;
+    }
+    if(ok && count!=0){
+        std::cout<<"backward scan mismatch at "<<count<<std::endl;
+        ok = false;
+    }
+    for(int i=1;ok && i<kNumKeys*2;i+=9973){
+        iter->Seek(Key(i));
+        if(!iter->Valid() || iter->key()!=leveldb::Slice(Key((i+1)/2*2))){
+            std::cout<<"seek mismatch for "<<Key(i)<<std::endl;
+            ok = false;
+        }
+    }
+    delete iter;
+
+    //批量点查
+    std::vector<std::string> keys;
+    for(int i=0;i<kNumKeys*2;i+=1001){
+        keys.push_back(Key(i));
+    }
+    std::vector<leveldb::Slice> slices(keys.begin(),keys.end());
+    std::vector<std::string> a(keys.size()),b(keys.size());
+    ok = ok && single.table->MultiGet(leveldb::ReadOptions(),slices.data(),slices.size(),&a,SaveMultiValue).ok();
+    ok = ok && partitioned.table->MultiGet(leveldb::ReadOptions(),slices.data(),slices.size(),&b,SaveMultiValue).ok();
+    if(ok && a!=b){
+        std::cout<<"multiget mismatch"<<std::endl;
+        ok = false;
+    }
+    Close(&single);
+    Close(&partitioned);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,255 @@
+#include<iostream>
+#include<chrono>
+#include<cstdio>
+#include<fstream>
+#include<string>
+#include "table/plain_table.h"
+#include "table/table_builder.h"
+#include "table/table.h"
+#include "util/cache.h"
+#include "util/env_posix.h"
+#include "test/table_test_util.h"
+
+//mmap打开的PlainTable与block格式的sstable点查结果相同，比较点查耗时；
+//检查Seek、双向扫描、不存在的key、多版本查找，以及按magic number区分两种格式
+
+static const int kNumKeys = 200000;
+
+//只写入偶数key，奇数key用来检查不存在的key
+static std::string Key(int i){
+    char buf[32];
+    snprintf(buf,sizeof(buf),"key%010d",i*2);
+    return buf;
+}
+
+static std::string MissingKey(int i){
+    char buf[32];
+    snprintf(buf,sizeof(buf),"key%010d",i*2+1);
+    return buf;
+}
+
+static std::string Value(int i){
+    return std::string(100,'a'+i%26);
+}
+
+static void WriteFile(const std::string& fname,const std::string& contents){
+    std::ofstream out(fname,std::ios::binary | std::ios::trunc);
+    out.write(contents.data(),contents.size());
+}
+
+static bool OpenFile(const std::string& fname,leveldb::RandomAccessFile** file,uint64_t* size){
+    leveldb::Status s = leveldb::NewPosixRandomAccessFile(fname,true,leveldb::kRandomAccess,file);
+    if(!s.ok()){
+        std::cout<<s.ToString()<<std::endl;
+        return false;
+    }
+    std::ifstream in(fname,std::ios::binary | std::ios::ate);
+    *size = static_cast<uint64_t>(in.tellg());
+    return true;
+}
+
+static bool CheckPlainTable(leveldb::PlainTable* table){
+    bool ok = table->NumEntries()==static_cast<uint64_t>(kNumKeys);
+    std::string value;
+    for(int i=0;ok && i<kNumKeys;i+=7){
+        value.clear();
+        leveldb::Status s = table->Get(leveldb::ReadOptions(),Key(i),&value,SaveValue);
+        if(!s.ok() || value!=Value(i)){
+            std::cout<<"plain get "<<Key(i)<<" failed"<<std::endl;
+            ok = false;
+        }
+        value.clear();
+        s = table->Get(leveldb::ReadOptions(),MissingKey(i),&value,SaveValue);
+        if(!s.ok() || !value.empty()){
+            std::cout<<"plain get "<<MissingKey(i)<<" should miss"<<std::endl;
+            ok = false;
+        }
+    }
+    leveldb::Iterator* iter = table->NewIterator(leveldb::ReadOptions());
+    int count = 0;
+    for(iter->SeekToFirst();ok && iter->Valid();iter->Next()){
+        if(iter->key()!=leveldb::Slice(Key(count)) || iter->value()!=leveldb::Slice(Value(count))){
+            ok = false;
+        }
+        count++;
+    }
+    if(ok && count!=kNumKeys){
+        std::cout<<"forward scan got "<<count<<" keys"<<std::endl;
+        ok = false;
+    }
+    count = kNumKeys;
+    for(iter->SeekToLast();ok && iter->Valid();iter->Prev()){
+        count--;
+        if(iter->key()!=leveldb::Slice(Key(count))){
+            std::cout<<"backward scan mismatch at "<<count<<std::endl;
+            ok = false;
+        }
+    }
+    if(ok && count!=0){
+        std::cout<<"backward scan stopped at "<<count<<std::endl;
+        ok = false;
+    }
+    for(int i=0;ok && i<kNumKeys;i+=997){
+        iter->Seek(MissingKey(i));
+        const bool expect_valid = i+1<kNumKeys;
+        if(iter->Valid()!=expect_valid || (expect_valid && iter->key()!=leveldb::Slice(Key(i+1)))){
+            std::cout<<"seek "<<MissingKey(i)<<" mismatch"<<std::endl;
+            ok = false;
+        }
+        iter->Seek(Key(i));
+        if(!iter->Valid() || iter->key()!=leveldb::Slice(Key(i))){
+            std::cout<<"seek "<<Key(i)<<" mismatch"<<std::endl;
+            ok = false;
+        }
+    }
+    if(ok && !iter->status().ok()){
+        std::cout<<iter->status().ToString()<<std::endl;
+        ok = false;
+    }
+    delete iter;
+    return ok;
+}
+
+//每个user key三个版本，查找指定sequence时返回不大于它的最新版本
+static bool CheckInternalKeys(){
+    TestInternalKeyComparator comparator;
+    leveldb::Options options;
+    options.comparator = &comparator;
+    StringSink sink;
+    leveldb::PlainTableBuilder builder(options,&sink);
+    const int n = 1000;
+    for(int i=0;i<n;i++){
+        for(uint64_t seq=30;seq>=10;seq-=10){
+            std::string key = Key(i);
+            leveldb::PutFixed64(&key,seq);
+            builder.Add(key,Key(i)+"@"+std::to_string(seq));
+        }
+    }
+    if(!builder.Finish().ok()) return false;
+    const std::string fname = "/tmp/leveldb_plain_table_internal.ldb";
+    WriteFile(fname,sink.contents());
+    leveldb::RandomAccessFile* file = nullptr;
+    uint64_t size = 0;
+    if(!OpenFile(fname,&file,&size)) return false;
+    leveldb::PlainTable* table = nullptr;
+    leveldb::Status s = leveldb::PlainTable::Open(options,file,size,&table);
+    bool ok = s.ok();
+    const uint64_t lookups[] = {35,30,25,10,5};
+    const char* expected[] = {"30","30","20","10",nullptr};
+    for(int i=0;ok && i<n;i+=13){
+        for(int j=0;j<5;j++){
+            std::string key = Key(i);
+            leveldb::PutFixed64(&key,lookups[j]);
+            std::string value;
+            s = table->Get(leveldb::ReadOptions(),key,&value,SaveValue);
+            const std::string want = expected[j]==nullptr ? "" : Key(i)+"@"+expected[j];
+            if(!s.ok() || value!=want){
+                std::cout<<"internal key get "<<Key(i)<<"@"<<lookups[j]<<" got '"<<value<<"'"<<std::endl;
+                ok = false;
+            }
+        }
+    }
+    delete table;
+    delete file;
+    std::remove(fname.c_str());
+    return ok;
+}
+
+int main(){
+    const std::string block_fname = "/tmp/leveldb_plain_table_bench_block.ldb";
+    const std::string plain_fname = "/tmp/leveldb_plain_table_bench_plain.ldb";
+    leveldb::Options options;
+    options.comparator = leveldb::BytewiseComparator();
+    options.compression = leveldb::kNoCompression;
+    options.block_cache = leveldb::NewLRUCache(64<<20);
+    {
+        StringSink block_sink,plain_sink;
+        leveldb::TableBuilder block_builder(options,&block_sink);
+        leveldb::PlainTableBuilder plain_builder(options,&plain_sink);
+        for(int i=0;i<kNumKeys;i++){
+            block_builder.Add(Key(i),Value(i));
+            plain_builder.Add(Key(i),Value(i));
+        }
+        if(!block_builder.Finish().ok() || !plain_builder.Finish().ok()){
+            std::cout<<"build failed"<<std::endl;
+            return 1;
+        }
+        WriteFile(block_fname,block_sink.contents());
+        WriteFile(plain_fname,plain_sink.contents());
+        std::cout<<"block table "<<block_sink.contents().size()<<" bytes, plain table "
+                 <<plain_sink.contents().size()<<" bytes"<<std::endl;
+    }
+
+    leveldb::RandomAccessFile* block_file = nullptr;
+    leveldb::RandomAccessFile* plain_file = nullptr;
+    uint64_t block_size = 0,plain_size = 0;
+    if(!OpenFile(block_fname,&block_file,&block_size) || !OpenFile(plain_fname,&plain_file,&plain_size)){
+        return 1;
+    }
+    bool ok = true;
+    //两种格式按magic number区分，Table::Open拒绝PlainTable
+    leveldb::TableFormat block_format,plain_format;
+    leveldb::Status s = leveldb::ReadTableFormat(block_file,block_size,&block_format);
+    if(s.ok()) s = leveldb::ReadTableFormat(plain_file,plain_size,&plain_format);
+    if(!s.ok() || block_format!=leveldb::kBlockBasedTable || plain_format!=leveldb::kPlainTable){
+        std::cout<<"ReadTableFormat failed: "<<s.ToString()<<std::endl;
+        ok = false;
+    }
+    leveldb::Table* wrong = nullptr;
+    s = leveldb::Table::Open(options,plain_file,plain_size,&wrong);
+    if(!s.IsNotSupportedError()){
+        std::cout<<"Table::Open on a plain table: "<<s.ToString()<<std::endl;
+        delete wrong;
+        ok = false;
+    }
+    leveldb::PlainTable* bad = nullptr;
+    s = leveldb::PlainTable::Open(options,block_file,block_size,&bad);
+    if(!s.IsCorruption()){
+        std::cout<<"PlainTable::Open on a block table: "<<s.ToString()<<std::endl;
+        delete bad;
+        ok = false;
+    }
+
+    leveldb::Table* block_table = nullptr;
+    leveldb::PlainTable* plain_table = nullptr;
+    s = leveldb::Table::Open(options,block_file,block_size,&block_table);
+    if(s.ok()) s = leveldb::PlainTable::Open(options,plain_file,plain_size,&plain_table);
+    if(!s.ok()){
+        std::cout<<s.ToString()<<std::endl;
+        ok = false;
+    }
+    ok = ok && CheckPlainTable(plain_table) && CheckInternalKeys();
+
+    std::string value;
+    for(int round=0;ok && round<2;round++){
+        //第一轮预热block cache
+        auto start = std::chrono::steady_clock::now();
+        for(int i=0;ok && i<kNumKeys;i++){
+            const int k = static_cast<int>((i*7919ull)%kNumKeys);
+            value.clear();
+            leveldb::TableCache::Get(block_table,leveldb::ReadOptions(),Key(k),&value,SaveValue);
+            if(value.size()!=100) ok = false;
+        }
+        auto mid = std::chrono::steady_clock::now();
+        for(int i=0;ok && i<kNumKeys;i++){
+            const int k = static_cast<int>((i*7919ull)%kNumKeys);
+            value.clear();
+            plain_table->Get(leveldb::ReadOptions(),Key(k),&value,SaveValue);
+            if(value.size()!=100) ok = false;
+        }
+        auto end = std::chrono::steady_clock::now();
+        if(ok && round==1){
+            std::cout<<"block table: "<<std::chrono::duration<double,std::nano>(mid-start).count()/kNumKeys<<" ns/get"
+                     <<", plain table: "<<std::chrono::duration<double,std::nano>(end-mid).count()/kNumKeys<<" ns/get"<<std::endl;
+        }
+    }
+    if(!ok) std::cout<<"plain table check failed"<<std::endl;
+    delete block_table;
+    delete plain_table;
+    delete block_file;
+    delete plain_file;
+    delete options.block_cache;
+    std::remove(block_fname.c_str());
+    std::remove(plain_fname.c_str());
+    return ok ? 0 : 1;
+}
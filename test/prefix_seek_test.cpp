@@ -0,0 +1,92 @@
+#include<iostream>
+#include<cstdio>
+#include<string>
+#include "table/table_builder.h"
+#include "table/table.h"
+#include "util/bloom.h"
+#include "util/cache.h"
+#include "util/env.h"
+#include "util/slice_transform.h"
+#include "test/table_test_util.h"
+
+//前缀查找: 前缀不存在时不读取data block，前缀存在时结果正确
+
+//前缀为8字节"pre%05d"
+static std::string Key(int prefix,int suffix){
+    char buf[32];
+    snprintf(buf,sizeof(buf),"pre%05d-%04d",prefix,suffix);
+    return buf;
+}
+
+static bool test(leveldb::FilterLayout layout,const char* label){
+    const int kNumPrefixes = 2000;
+    const int kKeysPerPrefix = 10;
+    const leveldb::FilterPolicy* policy = leveldb::NewBloomFilterPolicy(10);
+    const leveldb::SliceTransform* extractor = leveldb::NewFixedPrefixTransform(8);
+    leveldb::Options options;
+    options.comparator = leveldb::BytewiseComparator();
+    options.compression = leveldb::kNoCompression;
+    options.filter_policy = policy;
+    options.filter_layout = layout;
+    options.filter_partition_keys = 1024;
+    options.prefix_extractor = extractor;
+    options.block_cache = leveldb::NewLRUCache(8<<20);
+    StringSink sink;
+    leveldb::TableBuilder builder(options,&sink);
+    //只写入偶数前缀
+    for(int p=0;p<kNumPrefixes;p++){
+        for(int i=0;i<kKeysPerPrefix;i++){
+            builder.Add(Key(p*2,i),"value");
+        }
+    }
+    builder.Finish();
+
+    StringSource* source = new StringSource(sink.contents());
+    leveldb::Table* table = nullptr;
+    leveldb::Status s = leveldb::Table::Open(options,source,sink.contents().size(),&table);
+    bool ok = s.ok();
+    leveldb::ReadOptions read_options;
+    read_options.prefix_seek = true;
+    leveldb::Iterator* iter = ok ? table->NewIterator(read_options) : nullptr;
+    const uint64_t reads_before = source->reads();
+    int false_positives = 0;
+    for(int p=0;ok && p<kNumPrefixes;p++){
+        iter->Seek(Key(p*2+1,0));
+        if(iter->Valid() && iter->key().starts_with(Key(p*2+1,0).substr(0,8))){
+            std::cout<<label<<": found absent prefix "<<p*2+1<<std::endl;
+            ok = false;
+        }
+        if(iter->Valid()) false_positives++;
+    }
+    const uint64_t absent_reads = source->reads()-reads_before;
+    for(int p=0;ok && p<kNumPrefixes;p+=7){
+        const std::string target = Key(p*2,0).substr(0,8);
+        iter->Seek(target);
+        int count = 0;
+        for(;iter->Valid() && iter->key().starts_with(target);iter->Next()){
+            count++;
+        }
+        if(count!=kKeysPerPrefix){
+            std::cout<<label<<": prefix "<<target<<" found "<<count<<" keys"<<std::endl;
+            ok = false;
+        }
+    }
+    if(ok){
+        std::cout<<label<<": absent prefix seeks="<<kNumPrefixes<<" not filtered="<<false_positives
+                 <<" block reads="<<absent_reads<<std::endl;
+    }
+    delete iter;
+    delete table;
+    delete source;
+    delete options.block_cache;
+    delete extractor;
+    delete policy;
+    return ok;
+}
+
+int main(){
+    if(!test(leveldb::kBlockBasedFilter,"block based")) return 1;
+    if(!test(leveldb::kFullFilter,"full")) return 1;
+    if(!test(leveldb::kPartitionedFilter,"partitioned")) return 1;
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include<iostream>
+#include<chrono>
+#include<cstdio>
+#include<string>
+#include "table/table_builder.h"
+#include "table/table.h"
+#include "util/cache.h"
+#include "util/env.h"
+#include "test/table_test_util.h"
+
+//比较不同重启间隔下正向和反向全表扫描的耗时，以及Prev缓存解码的重启区间前后的反向扫描耗时，
+//并检查反向扫描与Next/Prev交替移动的结果
+
+static const int kNumKeys = 200000;
+
+static std::string Key(int i){
+    char buf[32];
+    snprintf(buf,sizeof(buf),"key%010d",i);
+    return buf;
+}
+
+static std::string Value(int i){
+    return std::string(20+i%7,'a'+i%26);
+}
+
+static bool Test(int restart_interval,bool prev_cache){
+    leveldb::Options options;
+    options.comparator = leveldb::BytewiseComparator();
+    options.compression = leveldb::kNoCompression;
+    options.block_restart_interval = restart_interval;
+    options.block_prev_cache = prev_cache;
+    StringSink sink;
+    leveldb::TableBuilder builder(options,&sink);
+    for(int i=0;i<kNumKeys;i++){
+        builder.Add(Key(i),Value(i));
+    }
+    if(!builder.Finish().ok()) return false;
+
+    options.block_cache = leveldb::NewLRUCache(64<<20);
+    StringSource* source = new StringSource(sink.contents());
+    leveldb::Table* table = nullptr;
+    leveldb::Status s = leveldb::Table::Open(options,source,sink.contents().size(),&table);
+    if(!s.ok()){
+        std::cout<<s.ToString()<<std::endl;
+        delete source;
+        delete options.block_cache;
+        return false;
+    }
+    bool ok = true;
+    leveldb::Iterator* iter = table->NewIterator(leveldb::ReadOptions());
+    //第一遍扫描填充cache
+    for(iter->SeekToFirst();iter->Valid();iter->Next()){}
+
+    auto start = std::chrono::steady_clock::now();
+    int count = 0;
+    for(iter->SeekToFirst();iter->Valid();iter->Next()){
+        count++;
+    }
+    const double forward = std::chrono::duration<double,std::nano>(std::chrono::steady_clock::now()-start).count()/kNumKeys;
+    if(count!=kNumKeys){
+        std::cout<<"forward scan mismatch at "<<count<<std::endl;
+        ok = false;
+    }
+
+    start = std::chrono::steady_clock::now();
+    count = 0;
+    for(iter->SeekToLast();iter->Valid();iter->Prev()){
+        count++;
+    }
+    const double backward = std::chrono::duration<double,std::nano>(std::chrono::steady_clock::now()-start).count()/kNumKeys;
+    if(ok && count!=kNumKeys){
+        std::cout<<"backward scan count "<<count<<std::endl;
+        ok = false;
+    }
+
+    //反向扫描的结果与写入的key/value相同
+    count = kNumKeys;
+    for(iter->SeekToLast();ok && iter->Valid();iter->Prev()){
+        count--;
+        if(iter->key()!=leveldb::Slice(Key(count)) || iter->value()!=leveldb::Slice(Value(count))) break;
+    }
+    if(ok && (count!=0 || !iter->status().ok())){
+        std::cout<<"backward scan mismatch at "<<count<<std::endl;
+        ok = false;
+    }
+
+    //Seek之后交替Next和Prev
+    for(int i=0;ok && i<kNumKeys;i+=997){
+        iter->Seek(Key(i));
+        int pos = i;
+        for(int j=0;ok && j<40;j++){
+            if(j%5==4 && pos+1<kNumKeys){
+                iter->Next();
+                pos++;
+            }else if(pos>0){
+                iter->Prev();
+                pos--;
+            }else{
+                break;
+            }
+            if(!iter->Valid() || iter->key()!=leveldb::Slice(Key(pos)) || iter->value()!=leveldb::Slice(Value(pos))){
+                std::cout<<"mixed move mismatch at "<<pos<<std::endl;
+                ok = false;
+            }
+        }
+    }
+    delete iter;
+    if(ok){
+        std::cout<<"restart interval "<<restart_interval<<(prev_cache ? ", prev cache   " : ", no prev cache")
+                 <<": forward "<<forward<<" ns/key, backward "<<backward<<" ns/key"<<std::endl;
+    }
+    delete table;
+    delete source;
+    delete options.block_cache;
+    return ok;
+}
+
+int main(){
+    const int intervals[] = {16,64};
+    for(size_t i=0;i<sizeof(intervals)/sizeof(intervals[0]);i++){
+        if(!Test(intervals[i],false) || !Test(intervals[i],true)) return 1;
+    }
+    return 0;
+}
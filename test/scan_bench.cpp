@@ -0,0 +1,114 @@
+#include<iostream>
+#include<chrono>
+#include<cstdio>
+#include<string>
+#include "table/table_builder.h"
+#include "table/table.h"
+#include "util/cache.h"
+#include "util/env.h"
+#include "test/table_test_util.h"
+
+//比较关闭和开启预读时顺序扫描和短范围扫描的文件读取次数和耗时；预读窗口越大，顺序扫描的读取次数不应增加
+
+static const int kNumKeys = 200000;
+
+static std::string Key(int i){
+    char buf[32];
+    snprintf(buf,sizeof(buf),"key%010d",i);
+    return buf;
+}
+
+//顺序扫描的读取次数写入*full_scan_reads
+static bool Scan(const std::string& contents,bool use_cache,size_t readahead_size,uint64_t* full_scan_reads){
+    leveldb::Options options;
+    options.comparator = leveldb::BytewiseComparator();
+    options.block_cache = use_cache ? leveldb::NewLRUCache(64<<20) : nullptr;
+    StringSource* source = new StringSource(contents);
+    leveldb::Table* table = nullptr;
+    leveldb::Status s = leveldb::Table::Open(options,source,contents.size(),&table);
+    if(!s.ok()){
+        std::cout<<s.ToString()<<std::endl;
+        delete source;
+        delete options.block_cache;
+        return false;
+    }
+    leveldb::ReadOptions read_options;
+    read_options.readahead_size = readahead_size;
+    bool ok = true;
+
+    //全表顺序扫描
+    uint64_t reads_before = source->reads();
+    auto start = std::chrono::steady_clock::now();
+    leveldb::Iterator* iter = table->NewIterator(read_options);
+    int count = 0;
+    for(iter->SeekToFirst();iter->Valid();iter->Next()){
+        if(iter->key()!=leveldb::Slice(Key(count))){
+            ok = false;
+            break;
+        }
+        count++;
+    }
+    if(!iter->status().ok()) ok = false;
+    delete iter;
+    double micros = std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now()-start).count();
+    if(!ok || count!=kNumKeys){
+        std::cout<<"scan mismatch at "<<count<<std::endl;
+        ok = false;
+    }
+    const uint64_t scan_reads = source->reads()-reads_before;
+    *full_scan_reads = scan_reads;
+
+    //短范围扫描(每次Seek后读取20个key)不应因为预读读取多余的block
+    reads_before = source->reads();
+    iter = table->NewIterator(read_options);
+    for(int i=0;ok && i<1000;i++){
+        const int base = (i*7919)%(kNumKeys-20);
+        iter->Seek(Key(base));
+        for(int j=0;j<20;j++){
+            if(!iter->Valid() || iter->key()!=leveldb::Slice(Key(base+j))){
+                std::cout<<"short scan mismatch at "<<base+j<<std::endl;
+                ok = false;
+                break;
+            }
+            iter->Next();
+        }
+    }
+    delete iter;
+    const uint64_t short_reads = source->reads()-reads_before;
+
+    if(ok){
+        std::cout<<(use_cache ? "cache   " : "no cache")<<" readahead "<<readahead_size/1024<<"KB: full scan "
+                 <<micros/1000<<" ms, "<<scan_reads<<" reads; 1000 short scans "<<short_reads<<" reads"<<std::endl;
+    }
+    delete table;
+    delete source;
+    delete options.block_cache;
+    return ok;
+}
+
+int main(){
+    leveldb::Options options;
+    options.comparator = leveldb::BytewiseComparator();
+    options.compression = leveldb::kNoCompression;
+    StringSink sink;
+    leveldb::TableBuilder builder(options,&sink);
+    for(int i=0;i<kNumKeys;i++){
+        builder.Add(Key(i),std::string(100,'a'+i%26));
+    }
+    builder.Finish();
+
+    const size_t sizes[] = {0,64*1024,256*1024,1024*1024};
+    for(int c=0;c<2;c++){
+        uint64_t previous_reads = 0;
+        for(size_t i=0;i<sizeof(sizes)/sizeof(sizes[0]);i++){
+            uint64_t reads = 0;
+            if(!Scan(sink.contents(),c==1,sizes[i],&reads)) return 1;
+            if(i>0 && reads>previous_reads){
+                std::cout<<"readahead "<<sizes[i]/1024<<"KB needs more reads than "<<sizes[i-1]/1024<<"KB"<<std::endl;
+                return 1;
+            }
+            previous_reads = reads;
+        }
+    }
+    return 0;
+}
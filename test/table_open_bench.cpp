@@ -0,0 +1,142 @@
+#include<iostream>
+#include<atomic>
+#include<chrono>
+#include<cstdio>
+#include<string>
+#include<thread>
+#include<vector>
+#include "table/table_builder.h"
+#include "table/table.h"
+#include "util/bloom.h"
+#include "util/env.h"
+#include "util/thread_pool.h"
+#include "test/table_test_util.h"
+
+//打开大量table时，比较逐个打开与并发打开(读取文件尾部、延迟加载filter)的耗时、读取次数和各阶段耗时，
+//并检查两种方式打开的table点查结果相同
+
+static const int kReadLatencyMicros = 100;
+
+//每次读取有固定延迟的内存文件，模拟磁盘
+class SlowSource:public leveldb::RandomAccessFile{
+public:
+    SlowSource(const std::string* contents,std::atomic<uint64_t>* reads):contents_(contents),reads_(reads){}
+    leveldb::Status Read(uint64_t offset,size_t n,leveldb::Slice* result,char* scratch) const override{
+        reads_->fetch_add(1);
+        std::this_thread::sleep_for(std::chrono::microseconds(kReadLatencyMicros));
+        if(offset>=contents_->size()){
+            *result = leveldb::Slice();
+            return leveldb::Status::OK();
+        }
+        if(offset+n>contents_->size()) n = contents_->size()-offset;
+        memcpy(scratch,contents_->data()+offset,n);
+        *result = leveldb::Slice(scratch,n);
+        return leveldb::Status::OK();
+    }
+private:
+    const std::string* contents_;
+    std::atomic<uint64_t>* reads_;
+};
+
+static const int kNumTables = 2000;
+static const int kKeysPerTable = 200;
+
+static std::string Key(int table,int i){
+    char buf[32];
+    snprintf(buf,sizeof(buf),"key%05d-%06d",table,i);
+    return buf;
+}
+
+static void PrintStats(const char* label,double millis,uint64_t reads,const leveldb::TableOpenStats& stats){
+    std::cout<<label<<": "<<millis<<" ms, "<<reads<<" reads, "<<stats.bytes_read/1024<<" KB; phases(ms) tail "
+             <<stats.tail_micros/1000<<", index "<<stats.index_micros/1000<<", meta "<<stats.meta_micros/1000
+             <<", filter "<<stats.filter_micros/1000<<std::endl;
+}
+
+int main(){
+    const leveldb::FilterPolicy* policy = leveldb::NewBloomFilterPolicy(10);
+    leveldb::Options options;
+    options.comparator = leveldb::BytewiseComparator();
+    options.compression = leveldb::kNoCompression;
+    options.filter_policy = policy;
+    options.filter_layout = leveldb::kFullFilter;
+    std::vector<std::string> contents(kNumTables);
+    for(int t=0;t<kNumTables;t++){
+        StringSink sink;
+        leveldb::TableBuilder builder(options,&sink);
+        for(int i=0;i<kKeysPerTable;i++){
+            builder.Add(Key(t,i*2),std::string(50,'a'+i%26));
+        }
+        if(!builder.Finish().ok()) return 1;
+        contents[t] = sink.contents();
+    }
+
+    //1.逐个打开，footer、index、metaindex、filter分别读取
+    std::atomic<uint64_t> serial_reads(0);
+    std::vector<leveldb::RandomAccessFile*> serial_files(kNumTables);
+    std::vector<leveldb::Table*> serial_tables(kNumTables,nullptr);
+    leveldb::TableOpenStats serial_stats;
+    auto start = std::chrono::steady_clock::now();
+    for(int t=0;t<kNumTables;t++){
+        serial_files[t] = new SlowSource(&contents[t],&serial_reads);
+        leveldb::Status s = leveldb::Table::Open(options,serial_files[t],contents[t].size(),&serial_tables[t],&serial_stats);
+        if(!s.ok()){
+            std::cout<<s.ToString()<<std::endl;
+            return 1;
+        }
+    }
+    double millis = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-start).count();
+    PrintStats("serial open",millis,serial_reads.load(),serial_stats);
+
+    //2.在线程池中并发打开，一次读取文件尾部，filter推迟到第一次点查
+    leveldb::Options bulk_options = options;
+    bulk_options.table_open_tail_size = 16*1024;
+    bulk_options.lazy_filter_loading = true;
+    std::atomic<uint64_t> bulk_reads(0);
+    std::vector<leveldb::TableOpenRequest> reqs(kNumTables);
+    for(int t=0;t<kNumTables;t++){
+        reqs[t].file = new SlowSource(&contents[t],&bulk_reads);
+        reqs[t].file_size = contents[t].size();
+    }
+    leveldb::ThreadPool pool(16);
+    start = std::chrono::steady_clock::now();
+    leveldb::Status s = leveldb::Table::OpenTables(bulk_options,reqs.data(),reqs.size(),&pool);
+    millis = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-start).count();
+    if(!s.ok()){
+        std::cout<<s.ToString()<<std::endl;
+        return 1;
+    }
+    leveldb::TableOpenStats bulk_stats;
+    for(int t=0;t<kNumTables;t++){
+        bulk_stats.Add(reqs[t].stats);
+    }
+    PrintStats("bulk open  ",millis,bulk_reads.load(),bulk_stats);
+
+    //3.点查结果相同；不存在的key由延迟加载的filter排除
+    bool ok = true;
+    const uint64_t reads_before = bulk_reads.load();
+    for(int t=0;ok && t<kNumTables;t+=7){
+        for(int i=0;i<10;i++){
+            const std::string key = Key(t,i*37%(kKeysPerTable*2));
+            std::string a,b;
+            leveldb::TableCache::Get(serial_tables[t],leveldb::ReadOptions(),key,&a,SaveValue);
+            leveldb::TableCache::Get(reqs[t].table,leveldb::ReadOptions(),key,&b,SaveValue);
+            if(a!=b){
+                std::cout<<"get mismatch for "<<key<<std::endl;
+                ok = false;
+                break;
+            }
+        }
+    }
+    if(ok){
+        std::cout<<"gets after bulk open: "<<bulk_reads.load()-reads_before<<" reads (filters loaded lazily)"<<std::endl;
+    }
+    for(int t=0;t<kNumTables;t++){
+        delete serial_tables[t];
+        delete serial_files[t];
+        delete reqs[t].table;
+        delete reqs[t].file;
+    }
+    delete policy;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include<stdint.h>
+#include<string.h>
+#include<atomic>
+#include<string>
+#include "table/table.h"
+#include "util/coding.h"
+#include "util/comparator.h"
+#include "util/env.h"
+
+//各个table测试共用的内存文件、点查回调和comparator
+
+//把写入的内容保存在内存中，记录Append和Flush的次数
+class StringSink:public leveldb::WritableFile{
+public:
+    leveldb::Status Append(const leveldb::Slice& data) override{
+        appends_++;
+        contents_.append(data.data(),data.size());
+        return leveldb::Status::OK();
+    }
+    leveldb::Status AppendWithTrailer(const leveldb::Slice& data,const leveldb::Slice& trailer) override{
+        appends_++;
+        contents_.append(data.data(),data.size());
+        contents_.append(trailer.data(),trailer.size());
+        return leveldb::Status::OK();
+    }
+    leveldb::Status Close() override { return leveldb::Status::OK();}
+    leveldb::Status Flush() override { flushes_++; return leveldb::Status::OK();}
+    leveldb::Status Sync() override { return leveldb::Status::OK();}
+    const std::string& contents() const { return contents_;}
+    int appends() const { return appends_;}
+    int flushes() const { return flushes_;}
+private:
+    std::string contents_;
+    int appends_ = 0;
+    int flushes_ = 0;
+};
+
+//从内存读取的文件，记录读取次数和请求的字节数，可以在多个线程中同时读
+class StringSource:public leveldb::RandomAccessFile{
+public:
+    explicit StringSource(const std::string& contents):contents_(contents),reads_(0),bytes_(0){}
+    leveldb::Status Read(uint64_t offset,size_t n,leveldb::Slice* result,char* scratch) const override{
+        reads_++;
+        bytes_ += n;
+        if(offset>=contents_.size()){
+            *result = leveldb::Slice();
+            return leveldb::Status::OK();
+        }
+        if(offset+n>contents_.size()) n = contents_.size()-offset;
+        memcpy(scratch,contents_.data()+offset,n);
+        *result = leveldb::Slice(scratch,n);
+        return leveldb::Status::OK();
+    }
+    uint64_t reads() const { return reads_.load();}
+    uint64_t bytes() const { return bytes_.load();}
+private:
+    std::string contents_;
+    mutable std::atomic<uint64_t> reads_;
+    mutable std::atomic<uint64_t> bytes_;
+};
+
+//Table::InternalGet只对TableCache开放
+namespace leveldb{
+class TableCache{
+public:
+    static Status Get(Table* table,const ReadOptions& options,const Slice& key,void* arg,
+                      void(*handle_result)(void*,const Slice&,const Slice&)){
+        return table->InternalGet(options,key,arg,handle_result);
+    }
+};
+}
+
+//点查回调，把value保存到arg指向的std::string
+inline void SaveValue(void* arg,const leveldb::Slice& k,const leveldb::Slice& v){
+    reinterpret_cast<std::string*>(arg)->assign(v.data(),v.size());
+}
+
+//与InternalKeyComparator同名，table据此按user key建立hash索引
+//key = user_key + fixed64(sequence)，user key升序，sequence降序
+class TestInternalKeyComparator:public leveldb::Comparator{
+public:
+    const char* Name() const override { return "leveldb.InternalKeyComparator";}
+    int Compare(const leveldb::Slice& a,const leveldb::Slice& b) const override{
+        int r = leveldb::Slice(a.data(),a.size()-8).compare(leveldb::Slice(b.data(),b.size()-8));
+        if(r==0){
+            const uint64_t sa = leveldb::DecodeFixed64(a.data()+a.size()-8);
+            const uint64_t sb = leveldb::DecodeFixed64(b.data()+b.size()-8);
+            r = sa>sb ? -1 : (sa<sb ? 1 : 0);
+        }
+        return r;
+    }
+    void FindShortestSeparator(std::string* start,const leveldb::Slice& limit) const override{}
+    void FindShortSuccessor(std::string* key) const override{}
+    const leveldb::Comparator* user_comparator() const override { return leveldb::BytewiseComparator();}
+};
@@ -0,0 +1,118 @@
+#include<iostream>
+#include<string>
+#include<vector>
+#include "util/bloom.h"
+#include "util/xor_filter.h"
+#include "util/coding.h"
+
+//比较XOR filter与bloom filter的空间和实测假阳率；
+//XorRotl在r=0时没有移位64位的未定义行为，用-fsanitize=undefined编译时构建和查询XOR filter不报错
+
+static leveldb::Slice Key(int i,char* buffer){
+    leveldb::EncodeFixed32(buffer,i);
+    return leveldb::Slice(buffer,sizeof(uint32_t));
+}
+
+static double FalsePositiveRate(const leveldb::FilterPolicy* policy,const std::string& filter){
+    char buffer[sizeof(int)];
+    int result = 0;
+    const int kProbes = 100000;
+    for(int i=0;i<kProbes;i++){
+        if(policy->KeyMayMatch(Key(i+1000000000,buffer),filter)){
+            result++;
+        }
+    }
+    return static_cast<double>(result)/kProbes;
+}
+
+//返回false表示出现了假阴性
+static bool Measure(const char* label,const leveldb::FilterPolicy* policy,int length){
+    std::vector<std::string> key_storage;
+    std::vector<leveldb::Slice> keys;
+    char buffer[sizeof(int)];
+    for(int i=0;i<length;i++){
+        key_storage.push_back(Key(i,buffer).ToString());
+    }
+    for(size_t i=0;i<key_storage.size();i++){
+        keys.push_back(key_storage[i]);
+    }
+    std::string filter;
+    policy->CreateFilter(&keys[0],length,&filter);
+    for(int i=0;i<length;i++){
+        if(!policy->KeyMayMatch(Key(i,buffer),filter)){
+            std::cout<<label<<" length "<<length<<": false negative on key "<<i<<std::endl;
+            return false;
+        }
+    }
+    std::cout<<label<<" keys="<<length<<" bits/key="<<filter.size()*8.0/length
+             <<" false positives="<<FalsePositiveRate(policy,filter)*100<<"%"<<std::endl;
+    return true;
+}
+
+//与逐位旋转比较，包括XorSlot使用的r=0
+static bool CheckRotl(){
+    const uint64_t x = 0x0123456789abcdefull;
+    const int rotations[] = {0,1,21,42,63};
+    for(int r:rotations){
+        uint64_t expected = x;
+        for(int i=0;i<r;i++){
+            expected = (expected<<1) | (expected>>63);
+        }
+        if(leveldb::XorRotl(x,r)!=expected){
+            std::cout<<"XorRotl(x,"<<r<<") mismatch"<<std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+//构建一个XOR格式(而不是退回bloom)的filter，所有key都能查到
+static bool CheckXor8(const leveldb::FilterPolicy* policy){
+    std::vector<std::string> key_storage;
+    std::vector<leveldb::Slice> keys;
+    char buffer[sizeof(int)];
+    //key太少时xor格式比bloom大，会退回bloom
+    for(int i=0;i<10000;i++){
+        key_storage.push_back(Key(i*7,buffer).ToString());
+    }
+    for(size_t i=0;i<key_storage.size();i++){
+        keys.push_back(key_storage[i]);
+    }
+    std::string filter;
+    policy->CreateFilter(&keys[0],static_cast<int>(keys.size()),&filter);
+    if(filter.empty() || static_cast<uint8_t>(filter.back())!=leveldb::kXorFilterTag){
+        std::cout<<"filter fell back to bloom"<<std::endl;
+        return false;
+    }
+    for(size_t i=0;i<keys.size();i++){
+        if(!policy->KeyMayMatch(keys[i],filter)){
+            std::cout<<"xor8 false negative on key "<<i<<std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(){
+    const leveldb::FilterPolicy* xor_filter = leveldb::NewXorFilterPolicy(10);
+    const leveldb::FilterPolicy* bloom10 = leveldb::NewBloomFilterPolicy(10);
+    //与XOR filter假阳率相近的bloom filter
+    const leveldb::FilterPolicy* bloom12 = leveldb::NewBloomFilterPolicy(12);
+    if(!CheckRotl() || !CheckXor8(xor_filter)) return 1;
+    for(int length=10;length<=1000000;length*=10){
+        if(!Measure("xor8    ",xor_filter,length)) return 1;
+        if(!Measure("bloom10 ",bloom10,length)) return 1;
+        if(!Measure("bloom12 ",bloom12,length)) return 1;
+    }
+
+    leveldb::FilterPolicyStats stats;
+    xor_filter->GetStats(&stats);
+    std::cout<<"xor filters="<<stats.filters<<" keys="<<stats.keys
+             <<" bytes="<<stats.filter_bytes<<" bloom bytes="<<stats.bloom_bytes
+             <<" saved="<<(1.0-static_cast<double>(stats.filter_bytes)/stats.bloom_bytes)*100<<"%"
+             <<" bloom fallbacks="<<stats.bloom_fallbacks<<std::endl;
+    delete bloom12;
+    delete bloom10;
+    delete xor_filter;
+    return 0;
+}
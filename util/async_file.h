@@ -0,0 +1,101 @@
+#pragma once
+#include<stddef.h>
+#include<vector>
+#include "port/port.h"
+#include "util/env.h"
+#include "util/mutexlock.h"
+#include "util/thread_pool.h"
+
+namespace leveldb{
+
+namespace{
+
+//等待一组并发任务完成
+class ReadLatch{
+public:
+    explicit ReadLatch(size_t count):cv_(&mutex_),count_(count){}
+    void CountDown(){
+        MutexLock l(&mutex_);
+        if(--count_==0) cv_.SignalAll();
+    }
+    void Wait(){
+        MutexLock l(&mutex_);
+        while(count_>0) cv_.Wait();
+    }
+private:
+    port::Mutex mutex_;
+    port::CondVar cv_;
+    size_t count_;
+};
+
+/**
+ * 没有原生异步I/O时的实现: 在线程池中调用base的同步Read
+ * ReadAsync的回调在线程池的线程中执行，MultiRead把请求分散到线程池中并发读取，
+ * 所以不能在pool自己的线程中调用MultiRead
+ */
+class ThreadPoolRandomAccessFile:public RandomAccessFile{
+public:
+    //不持有base和pool，两者必须比该对象活得更久
+    ThreadPoolRandomAccessFile(const RandomAccessFile* base,ThreadPool* pool):base_(base),pool_(pool){}
+
+    Status Read(uint64_t offset,size_t n,Slice* result,char* scratch) const override{
+        return base_->Read(offset,n,result,scratch);
+    }
+    bool SupportsZeroCopy() const override { return base_->SupportsZeroCopy();}
+    void Hint(AccessPattern pattern) const override { base_->Hint(pattern);}
+
+    void MultiRead(ReadRequest* reqs,size_t num) const override{
+        if(num<=1){
+            base_->MultiRead(reqs,num);
+            return;
+        }
+        ReadLatch latch(num);
+        std::vector<Task> tasks(num);
+        for(size_t i=0;i<num;i++){
+            tasks[i] = Task{base_,&reqs[i],&LatchCallback,&latch};
+            pool_->Schedule(&RunTask,&tasks[i]);
+        }
+        latch.Wait();
+    }
+
+    Status ReadAsync(ReadRequest* req,ReadCallback callback,void* arg) const override{
+        //RunOwnedTask中释放
+        Task* task = new Task{base_,req,callback,arg};
+        pool_->Schedule(&RunOwnedTask,task);
+        return Status::OK();
+    }
+
+private:
+    struct Task{
+        const RandomAccessFile* file;
+        ReadRequest* req;
+        ReadCallback callback;
+        void* arg;
+    };
+
+    static void RunTask(void* arg){
+        Task* task = reinterpret_cast<Task*>(arg);
+        ReadRequest* req = task->req;
+        req->status = task->file->Read(req->offset,req->len,&req->result,req->scratch);
+        (*task->callback)(task->arg,req);
+    }
+    static void RunOwnedTask(void* arg){
+        RunTask(arg);
+        delete reinterpret_cast<Task*>(arg);
+    }
+    static void LatchCallback(void* arg,ReadRequest* req){
+        reinterpret_cast<ReadLatch*>(arg)->CountDown();
+    }
+
+    const RandomAccessFile* const base_;
+    ThreadPool* const pool_;
+};
+
+} // namespace
+
+//返回一个在pool中完成异步和批量读取的file，调用者负责释放返回值
+RandomAccessFile* NewThreadPoolRandomAccessFile(const RandomAccessFile* base,ThreadPool* pool){
+    return new ThreadPoolRandomAccessFile(base,pool);
+}
+
+} // namespace leveldb
@@ -0,0 +1,222 @@
+#pragma once
+#include<stddef.h>
+#include<stdint.h>
+#include<string>
+#include "util/filter_policy.h"
+#include "util/hash.h"
+#include "util/slice.h"
+#include "util/cpu_features.h"
+#ifdef LEVELDB_HAVE_X86_TARGET_ATTRIBUTE
+#include<immintrin.h>
+#endif
+
+namespace leveldb{
+
+namespace{
+
+//Hash64的低32位作为起始位置，高32位作为步长，两者相互独立，双重hash模拟k个hash函数
+static uint64_t BloomHash(const Slice& key){
+    return Hash64(key.data(),key.size(),0xbc9f1d34);
+}
+
+//经典bloom filter的探测，filter中每个探测位置都可能落在不同的cache line上
+static bool ClassicBloomMayMatch(const Slice& key,const char* array,size_t len,size_t k){
+    const size_t bits = (len-1)*8;
+    const uint64_t hash = BloomHash(key);
+    uint32_t h = static_cast<uint32_t>(hash);
+    const uint32_t delta = static_cast<uint32_t>(hash>>32);
+    for(size_t j=0;j<k;j++){
+        const uint32_t bitpos = h % bits;
+        if((array[bitpos/8] & (1<<(bitpos%8)))==0) return false;
+        h += delta;
+    }
+    return true;
+}
+
+/**
+ * cache line分块的bloom filter，格式:
+ * line 0(64字节) | line 1 | ... | line n-1 | k(1字节) | kCacheLineBloomTag(1字节)
+ * hash的高32位选择line，低32位分别乘以kCacheLineBloomMultipliers[i]后取高9位作为line内的第i个位置，
+ * 一个key的k次探测只访问一个cache line
+ * 使用单独的名字leveldb.CacheLineBloomFilter，读取时还要检查末尾的tag，不是该格式时认为可能匹配；
+ * tag大于30，按经典格式读到时同样认为可能匹配
+ * line按filter的起始位置划分，filter在内存中(block内或mmap的文件中)不一定按64字节对齐，
+ * 这时一个line会跨两个cache line；bloom_test测得1M个key的filter不对齐时每次探测慢约1%~12%，
+ * 不为此拷贝filter
+ */
+static const size_t kCacheLineBytes = 64;
+static const size_t kCacheLineBits = kCacheLineBytes*8;
+static const size_t kMaxCacheLineProbes = 8;
+static const uint8_t kCacheLineBloomTag = 0xff;
+
+//8个奇数乘数，各自得到近似独立的9位位置
+static const uint32_t kCacheLineBloomMultipliers[kMaxCacheLineProbes] = {
+    0x47b6137bU,0x44974d91U,0x8824ad5bU,0xa2b7289dU,
+    0x705495c7U,0x2df1424bU,0x9efc4947U,0x5c6bfb31U
+};
+
+static inline uint32_t CacheLineBitPos(uint32_t h,size_t i){
+    return (h*kCacheLineBloomMultipliers[i])>>23;
+}
+
+//hash的高32位映射到[0,num_lines)，用乘法代替取模
+static inline size_t CacheLineIndex(uint64_t hash,size_t num_lines){
+    return static_cast<size_t>(((hash>>32)*num_lines)>>32);
+}
+
+static bool CacheLineProbeScalar(const char* line,uint32_t h,size_t k){
+    for(size_t i=0;i<k;i++){
+        const uint32_t bitpos = CacheLineBitPos(h,i);
+        if((line[bitpos/8] & (1<<(bitpos%8)))==0) return false;
+    }
+    return true;
+}
+
+#ifdef LEVELDB_HAVE_X86_TARGET_ATTRIBUTE
+#define LEVELDB_HAVE_AVX2_PROBE 1
+//8个位置用一条乘法同时算出，gather取出所在的32位字后一次测试
+//line内按小端的32位字寻址，与标量版本按字节寻址的位布局一致
+__attribute__((target("avx2")))
+static bool CacheLineProbeAVX2(const char* line,uint32_t h,size_t k){
+    const __m256i mults = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kCacheLineBloomMultipliers));
+    const __m256i pos = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(h),mults),23);
+    const __m256i words = _mm256_i32gather_epi32(reinterpret_cast<const int*>(line),_mm256_srli_epi32(pos,5),4);
+    __m256i bits = _mm256_sllv_epi32(_mm256_set1_epi32(1),_mm256_and_si256(pos,_mm256_set1_epi32(31)));
+    //只保留前k个探测
+    const __m256i lanes = _mm256_setr_epi32(0,1,2,3,4,5,6,7);
+    bits = _mm256_and_si256(bits,_mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(k)),lanes));
+    //(~words & bits)==0 即所有位都已置位
+    return _mm256_testc_si256(words,bits);
+}
+#endif
+
+static bool CacheLineBloomMayMatch(const Slice& key,const Slice& bloom_filter){
+    const size_t len = bloom_filter.size();
+    const char* array = bloom_filter.data();
+    if(len<2+kCacheLineBytes || (len-2)%kCacheLineBytes!=0 || static_cast<uint8_t>(array[len-1])!=kCacheLineBloomTag){
+        return true;
+    }
+    const size_t k = static_cast<uint8_t>(array[len-2]);
+    if(k<1 || k>kMaxCacheLineProbes) return true;
+    const size_t num_lines = (len-2)/kCacheLineBytes;
+    const uint64_t hash = BloomHash(key);
+    const char* line = array + CacheLineIndex(hash,num_lines)*kCacheLineBytes;
+    const uint32_t h = static_cast<uint32_t>(hash);
+#ifdef LEVELDB_HAVE_AVX2_PROBE
+    if(CpuHasAVX2()){
+        return CacheLineProbeAVX2(line,h,k);
+    }
+#endif
+    return CacheLineProbeScalar(line,h,k);
+}
+
+//经典格式的bloom filter
+static bool BloomFilterMayMatch(const Slice& key,const Slice& bloom_filter){
+    const size_t len = bloom_filter.size();
+    if(len<2) return false;
+    const char* array = bloom_filter.data();
+    //使用filter中记录的k，这样不同bits_per_key生成的filter也可以读取
+    const size_t k = static_cast<uint8_t>(array[len-1]);
+    if(k>30){
+        return true;
+    }
+    return ClassicBloomMayMatch(key,array,len,k);
+}
+
+/**
+ * filter格式: bit数组(bits/8字节) | k(1字节)
+ * k<=30，大于30的值保留给以后的新格式，读到时一律认为可能匹配
+ */
+class BloomFilterPolicy:public FilterPolicy{
+public:
+    explicit BloomFilterPolicy(int bits_per_key):bits_per_key_(bits_per_key){
+        //k = ln2 * (m/n) 时假阳率最低
+        k_ = static_cast<size_t>(bits_per_key * 0.69);
+        if(k_<1) k_ = 1;
+        if(k_>30) k_ = 30;
+    }
+    const char* Name() const override { return "leveldb.Hash64BloomFilter";}
+
+    void CreateFilter(const Slice* keys,int n,std::string* dst) const override{
+        size_t bits = n * bits_per_key_;
+        //key很少时假阳率会很高，至少使用64位
+        if(bits<64) bits = 64;
+        size_t bytes = (bits+7)/8;
+        bits = bytes * 8;
+
+        const size_t init_size = dst->size();
+        dst->resize(init_size + bytes,0);
+        dst->push_back(static_cast<char>(k_));//记录k
+        char* array = &(*dst)[init_size];
+        for(int i=0;i<n;i++){
+            const uint64_t hash = BloomHash(keys[i]);
+            uint32_t h = static_cast<uint32_t>(hash);
+            const uint32_t delta = static_cast<uint32_t>(hash>>32);
+            for(size_t j=0;j<k_;j++){
+                const uint32_t bitpos = h % bits;
+                array[bitpos/8] |= (1<<(bitpos%8));
+                h += delta;
+            }
+        }
+    }
+
+    bool KeyMayMatch(const Slice& key,const Slice& bloom_filter) const override{
+        return BloomFilterMayMatch(key,bloom_filter);
+    }
+
+private:
+    size_t bits_per_key_;
+    size_t k_;
+};
+
+class CacheLineBloomFilterPolicy:public FilterPolicy{
+public:
+    explicit CacheLineBloomFilterPolicy(int bits_per_key):bits_per_key_(bits_per_key){
+        //分块后同样的bits_per_key假阳率略高，k最多为一次SIMD能算出的位置数
+        k_ = static_cast<size_t>(bits_per_key * 0.69);
+        if(k_<1) k_ = 1;
+        if(k_>kMaxCacheLineProbes) k_ = kMaxCacheLineProbes;
+    }
+    const char* Name() const override { return "leveldb.CacheLineBloomFilter";}
+
+    void CreateFilter(const Slice* keys,int n,std::string* dst) const override{
+        const size_t bits = n * bits_per_key_;
+        size_t num_lines = (bits + kCacheLineBits - 1)/kCacheLineBits;
+        if(num_lines<1) num_lines = 1;
+
+        const size_t init_size = dst->size();
+        dst->resize(init_size + num_lines*kCacheLineBytes,0);
+        dst->push_back(static_cast<char>(k_));
+        dst->push_back(static_cast<char>(kCacheLineBloomTag));
+        char* array = &(*dst)[init_size];
+        for(int i=0;i<n;i++){
+            const uint64_t hash = BloomHash(keys[i]);
+            char* line = array + CacheLineIndex(hash,num_lines)*kCacheLineBytes;
+            const uint32_t h = static_cast<uint32_t>(hash);
+            for(size_t j=0;j<k_;j++){
+                const uint32_t bitpos = CacheLineBitPos(h,j);
+                line[bitpos/8] |= (1<<(bitpos%8));
+            }
+        }
+    }
+
+    bool KeyMayMatch(const Slice& key,const Slice& bloom_filter) const override{
+        return CacheLineBloomMayMatch(key,bloom_filter);
+    }
+
+private:
+    size_t bits_per_key_;
+    size_t k_;
+};
+
+} // namespace
+
+const FilterPolicy* NewBloomFilterPolicy(int bits_per_key){
+    return new BloomFilterPolicy(bits_per_key);
+}
+
+const FilterPolicy* NewCacheLineBloomFilterPolicy(int bits_per_key){
+    return new CacheLineBloomFilterPolicy(bits_per_key);
+}
+
+} // namespace leveldb
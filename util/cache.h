@@ -1,5 +1,10 @@
 #pragma once
 #include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
 #include "util/slice.h"
 #include "port/port.h"
 #include "port/thread_annotations.h"
@@ -8,7 +13,18 @@
 namespace leveldb{
 class Cache;
 
-Cache* NewLRUCache(size_t capacity);
+//num_shard_bits<0时根据硬件线程数和容量自动选择分片数
+Cache* NewLRUCache(size_t capacity,int num_shard_bits = -1);
+
+//单个分片的统计信息，lock_waits为加锁时锁已被其他线程持有的次数，用于衡量锁竞争
+struct CacheShardStats{
+    size_t capacity;
+    size_t usage;
+    uint64_t lookups;
+    uint64_t hits;
+    uint64_t inserts;
+    uint64_t lock_waits;
+};
 
 class Cache{
 public:
@@ -25,6 +41,10 @@ public:
     virtual uint64_t NewId()=0;
     virtual void Prune(){}
     virtual size_t TotalCharge() const =0;
+    //按照LRU顺序(最久未使用的在前)把cache中驻留的key追加到*keys中，用于持久化cache内容，重启后预热
+    virtual void GetResidentKeys(std::vector<std::string>* keys) const {}
+    //每个分片一项
+    virtual void GetShardStats(std::vector<CacheShardStats>* stats) const {}
 
 private:
     void LRU_Remove(Handle* e);
@@ -48,7 +68,7 @@ struct LRUHandle{
     size_t key_length;
     bool in_cache; //entry是否在cache中
     uint32_t refs;//引用计数
-    uint32_t hash;
+    uint64_t hash;//Hash64(key)，高位决定分片，低位决定HandleTable中的桶
     char key_data[1];//key的开始位置
     Slice key() const{
         //空链表的头结点无实际意义
@@ -63,7 +83,7 @@ class HandleTable{
 public:
     HandleTable():length_(0),elems_(0),list_(nullptr){ Resize(); }
     ~HandleTable() { delete[] list_; }
-    LRUHandle* Lookup(const Slice& key,uint32_t hash){
+    LRUHandle* Lookup(const Slice& key,uint64_t hash){
         return *FindPointer(key,hash);
     }
 
@@ -84,7 +104,7 @@ public:
         return old;
     }
 
-    LRUHandle* Remove(const Slice& key,uint32_t hash){
+    LRUHandle* Remove(const Slice& key,uint64_t hash){
         LRUHandle** ptr = FindPointer(key,hash);
         LRUHandle* result = *ptr;
         if(result != nullptr){
@@ -110,7 +130,7 @@ private:
             LRUHandle* h = list_[i];
             while(h!=nullptr){
                 LRUHandle* next= h->next_hash;
-                uint32_t hash = h->hash;
+                uint64_t hash = h->hash;
                 LRUHandle** ptr = &new_list[hash&(new_length-1)];
                 h->next_hash = *ptr;
                 *ptr=h;
@@ -124,7 +144,7 @@ private:
         length_ = new_length;
     }
 
-    LRUHandle** FindPointer(const Slice& key,uint32_t hash){
+    LRUHandle** FindPointer(const Slice& key,uint64_t hash){
         LRUHandle** ptr = &list_[hash & (length_-1)];
         while(*ptr != nullptr && ((*ptr)->hash != hash || key != (*ptr)->key())){
             ptr = &(*ptr)->next_hash;
@@ -133,20 +153,38 @@ private:
     }
 };
 
-class LRUCahce{
+//与MutexLock相同，但是在锁已被持有、需要等待时计数
+class SCOPED_LOCKABLE CountingMutexLock{
 public:
-    LRUCahce();
-    ~LRUCahce();
+    CountingMutexLock(port::Mutex* mu,std::atomic<uint64_t>* waits) EXCLUSIVE_LOCK_FUNCTION(mu):mu_(mu){
+        if(!mu_->TryLock()){
+            waits->fetch_add(1,std::memory_order_relaxed);
+            mu_->Lock();
+        }
+    }
+    ~CountingMutexLock() UNLOCK_FUNCTION(){ mu_->Unlock();}
+    CountingMutexLock(const CountingMutexLock&) = delete;
+    CountingMutexLock& operator=(const CountingMutexLock&) = delete;
+private:
+    port::Mutex* const mu_;
+};
+
+class LRUCache{
+public:
+    LRUCache();
+    ~LRUCache();
     void SetCapacity(size_t capacity){capacity_ = capacity;}
-    Cache::Handle* Insert(const Slice& key,uint32_t hash,void* value,size_t charge,void(*deleter)(const Slice& key,void* value));
-    Cache::Handle* Lookup(const Slice& key,uint32_t hash);
+    Cache::Handle* Insert(const Slice& key,uint64_t hash,void* value,size_t charge,void(*deleter)(const Slice& key,void* value));
+    Cache::Handle* Lookup(const Slice& key,uint64_t hash);
     void Release(Cache::Handle* handle);
-    void Erase(const Slice& key,uint32_t hash);
+    void Erase(const Slice& key,uint64_t hash);
     void Prune();
     size_t TotalCharge() const{
         MutexLock l(&mutex_);
         return usage_;
     }
+    void AppendResidentKeys(std::vector<std::string>* keys) const;
+    void GetStats(CacheShardStats* stats) const;
 
 
 private:
@@ -163,16 +201,20 @@ private:
     LRUHandle in_use_ GUARDED_BY(mutex_);
     HandleTable table_ GUARDED_BY(mutex_);
 
+    std::atomic<uint64_t> lookups_;
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> inserts_;
+    std::atomic<uint64_t> lock_waits_;
 };
 
-LRUCahce::LRUCahce():capacity_(0),usage_(0){
+LRUCache::LRUCache():capacity_(0),usage_(0),lookups_(0),hits_(0),inserts_(0),lock_waits_(0){
     lru_.next = &lru_;
     lru_.prev = &lru_;
     in_use_.next = &in_use_;
     in_use_.prev = &in_use_;
 }
 
-LRUCahce::~LRUCahce(){
+LRUCache::~LRUCache(){
     assert(in_use_.next == &in_use_);
     for(LRUHandle* e = lru_.next;e!=&lru_;){
         LRUHandle* next = e->next;
@@ -192,7 +234,7 @@ void LRUCache::Ref(LRUHandle* e){
     e->refs++;
 }
 
-void LRUCache:: LRU_Remove(LRUCache* e){
+void LRUCache:: LRU_Remove(LRUHandle* e){
     e->next->prev = e->prev;
     e->prev->next = e->next;
 }
@@ -209,7 +251,7 @@ void LRUCache::Unref(LRUHandle* e){
     e->refs--;
     if(e->refs==0){
         assert(!e->in_cache);
-        (*e->delter)(e->key(),e->value);
+        (*e->deleter)(e->key(),e->value);
         free(e);
     }else if(e->in_cache && e->refs==1){
         LRU_Remove(e);
@@ -217,23 +259,26 @@ void LRUCache::Unref(LRUHandle* e){
     }
 }
 
-Cache:: Handle* LRUCache::Lookup(const Slice& key,uint32_t hash){
-    MutextLock l(&mutext);
+Cache:: Handle* LRUCache::Lookup(const Slice& key,uint64_t hash){
+    CountingMutexLock l(&mutex_,&lock_waits_);
+    lookups_.fetch_add(1,std::memory_order_relaxed);
     LRUHandle* e = table_.Lookup(key,hash);
     if(e!=nullptr){
+        hits_.fetch_add(1,std::memory_order_relaxed);
         Ref(e);
     }
     return reinterpret_cast<Cache::Handle*>(e);
 }
 
 void LRUCache::Release(Cache::Handle* handle){
-    MutexLock l(&mutex_);
-    Unref(reinterpret_cast<LRUCahce*>(handle));
+    CountingMutexLock l(&mutex_,&lock_waits_);
+    Unref(reinterpret_cast<LRUHandle*>(handle));
 }
 
-Cache::Handle* LRUCache::Insert(const Slice& key,uint32_t hash,void* value,size_t charge,
+Cache::Handle* LRUCache::Insert(const Slice& key,uint64_t hash,void* value,size_t charge,
                                 void(*deleter)(const Slice& key,void* value)){
-    MutexLock l(&mutex_);
+    CountingMutexLock l(&mutex_,&lock_waits_);
+    inserts_.fetch_add(1,std::memory_order_relaxed);
     LRUHandle* e = reinterpret_cast<LRUHandle*>(malloc(sizeof(LRUHandle)-1+key.size()));
     e->value = value;
     e->deleter = deleter;
@@ -252,7 +297,7 @@ Cache::Handle* LRUCache::Insert(const Slice& key,uint32_t hash,void* value,size_
     }else{
         e->next = nullptr;
     }
-    while(usgae_ > capacity_ && lru_.next != &lru_){
+    while(usage_ > capacity_ && lru_.next != &lru_){
         LRUHandle* old = lru_.next;
         assert(old->refs==1);
         bool erased = FinishErase(table_.Remove(old->key(),old->hash));
@@ -274,48 +319,100 @@ bool LRUCache::FinishErase(LRUHandle* e){
     return e != nullptr;
 }
 
-void LRUCache::Erase(const Slice& key,uint32_t hash){
-    MutexLock l(&mutex_);
-    FinnishErase(table_.Remove(key,hash));
+void LRUCache::Erase(const Slice& key,uint64_t hash){
+    CountingMutexLock l(&mutex_,&lock_waits_);
+    FinishErase(table_.Remove(key,hash));
 }
 
-void LRUCahce::Prune(){
+void LRUCache::Prune(){
     MutexLock l(&mutex_);
     while(lru_.next != &lru_){
         LRUHandle* e = lru_.next;
         assert(e->refs == 1);
-        bool erased = FinsishErase(table_.Remove(e->key,e->hash));
+        bool erased = FinishErase(table_.Remove(e->key(),e->hash));
         if(!erased){
             assert(erased);
         }
     }
 }  
-static const int kNumShardBits = 4;
-static const int kNumShards = 1<<kNumShardBits;
+//先追加lru_中的entry(从旧到新)，再追加正在被引用的in_use_中的entry，后者是最热的
+void LRUCache::AppendResidentKeys(std::vector<std::string>* keys) const{
+    MutexLock l(&mutex_);
+    for(const LRUHandle* e = lru_.next;e!=&lru_;e=e->next){
+        keys->push_back(e->key().ToString());
+    }
+    for(const LRUHandle* e = in_use_.next;e!=&in_use_;e=e->next){
+        keys->push_back(e->key().ToString());
+    }
+}
+
+void LRUCache::GetStats(CacheShardStats* stats) const{
+    stats->capacity = capacity_;
+    stats->usage = TotalCharge();
+    stats->lookups = lookups_.load(std::memory_order_relaxed);
+    stats->hits = hits_.load(std::memory_order_relaxed);
+    stats->inserts = inserts_.load(std::memory_order_relaxed);
+    stats->lock_waits = lock_waits_.load(std::memory_order_relaxed);
+}
+
+static const int kMaxNumShardBits = 10;
+//自动选择分片数时，每个分片的最小容量
+static const size_t kMinShardCapacity = 512 * 1024;
+
+//分片数取线程数的2倍(向上取2的幂，不超过2^kMaxNumShardBits)以降低锁竞争，
+//但小cache要减少分片，保证每个分片至少kMinShardCapacity，避免容量碎片化
+int DefaultCacheShardBits(size_t capacity,unsigned int threads){
+    if(threads==0) threads = 1;
+    int bits = 0;
+    while((1u<<bits) < 2*threads && bits<kMaxNumShardBits){
+        bits++;
+    }
+    while(bits>0 && (capacity>>bits) < kMinShardCapacity){
+        bits--;
+    }
+    return bits;
+}
+
+int DefaultCacheShardBits(size_t capacity){
+    return DefaultCacheShardBits(capacity,std::thread::hardware_concurrency());
+}
+
 class ShardedLRUCache: public Cache{
 private:
-    LRUCache shard_[kNumShards];
+    const int num_shard_bits_;
+    const int num_shards_;
+    LRUCache* shard_;
     port::Mutex id_mutex_;
     uint64_t last_id_;
-    static inline uint32_t HashSlice(const Slice& s){
-        return Hash(s.data(),s.size(),0);
+    static inline uint64_t HashSlice(const Slice& s){
+        //block cache的key都是16字节，走定长的快速路径
+        if(s.size()==16){
+            return Hash64Fixed16(s.data(),0);
+        }
+        return Hash64(s.data(),s.size(),0);
+    }
+    //取hash的高位选择分片，低位留给分片内的HandleTable选择bucket
+    uint32_t Shard(uint64_t hash) const {
+        return num_shard_bits_>0 ? static_cast<uint32_t>(hash >>(64-num_shard_bits_)) : 0;
     }
-    static uint32_t Shard(uint32_t hash) {return hash >>(32-kNumShardBits);}
 
 public:
-    explicit ShardedLRUCache(size_t capacity):last_id_(0){
-        const size_t per_shard = (capacity + (kNumShards-1)) / kNumShards;
-        for(int s=0;s<kNumShards;s++){
+    ShardedLRUCache(size_t capacity,int num_shard_bits)
+        :num_shard_bits_(num_shard_bits),num_shards_(1<<num_shard_bits),last_id_(0){
+        assert(num_shard_bits>=0 && num_shard_bits<=kMaxNumShardBits);
+        shard_ = new LRUCache[num_shards_];
+        const size_t per_shard = (capacity + (num_shards_-1)) / num_shards_;
+        for(int s=0;s<num_shards_;s++){
             shard_[s].SetCapacity(per_shard);
         }
     }
-    ~ShardedLRUCache() override{}
+    ~ShardedLRUCache() override{ delete[] shard_;}
     Handle* Insert(const Slice& key,void* value,size_t charge,void(*deleter)(const Slice& key,void* value)) override{
-        const uint32_t hash = HashSlice(key);
+        const uint64_t hash = HashSlice(key);
         return shard_[Shard(hash)].Insert(key,hash,value,charge,deleter);
     }
     Handle* Lookup(const Slice& key) override{
-        const uint32_t hash = HashSlice(key);
+        const uint64_t hash = HashSlice(key);
         return shard_[Shard(hash)].Lookup(key,hash);
     }
 
@@ -325,25 +422,61 @@ public:
     }
 
     void Erase(const Slice& key)override{
-        const uint32_t hash = HashSlice(key);
+        const uint64_t hash = HashSlice(key);
         shard_[Shard(hash)].Erase(key,hash);
     }
     void* Value(Handle* handle) override {
         return reinterpret_cast<LRUHandle*>(handle)->value;
     }
+    uint64_t NewId() override {
+        MutexLock l(&id_mutex_);
+        return ++(last_id_);
+    }
     void Prune() override {
-        for (int s = 0; s < kNumShards; s++) {
+        for (int s = 0; s < num_shards_; s++) {
         shard_[s].Prune();
         }
     }
     size_t TotalCharge() const override {
         size_t total = 0;
-        for (int s = 0; s < kNumShards; s++) {
+        for (int s = 0; s < num_shards_; s++) {
             total += shard_[s].TotalCharge();
         }
         return total;
     }
+    //每个shard内部是严格的LRU顺序，shard之间没有全局时间戳，这里按照entry在各自shard中的相对位置归并
+    void GetResidentKeys(std::vector<std::string>* keys) const override{
+        std::vector<std::pair<double,std::string>> ranked;
+        for(int s=0;s<num_shards_;s++){
+            std::vector<std::string> shard_keys;
+            shard_[s].AppendResidentKeys(&shard_keys);
+            const size_t n = shard_keys.size();
+            for(size_t i=0;i<n;i++){
+                ranked.emplace_back(static_cast<double>(i+1)/n,std::move(shard_keys[i]));
+            }
+        }
+        std::stable_sort(ranked.begin(),ranked.end(),
+            [](const std::pair<double,std::string>& a,const std::pair<double,std::string>& b){
+                return a.first<b.first;
+            });
+        for(size_t i=0;i<ranked.size();i++){
+            keys->push_back(std::move(ranked[i].second));
+        }
+    }
+    void GetShardStats(std::vector<CacheShardStats>* stats) const override{
+        stats->resize(num_shards_);
+        for(int s=0;s<num_shards_;s++){
+            shard_[s].GetStats(&(*stats)[s]);
+        }
+    }
 };
 }
-Cache* NewLRUCache(size_t capacity) { return new ShardedLRUCache(capacity);}
+Cache* NewLRUCache(size_t capacity,int num_shard_bits) {
+    if(num_shard_bits<0){
+        num_shard_bits = DefaultCacheShardBits(capacity);
+    }else if(num_shard_bits>kMaxNumShardBits){
+        num_shard_bits = kMaxNumShardBits;
+    }
+    return new ShardedLRUCache(capacity,num_shard_bits);
+}
 } // namespace leveldb
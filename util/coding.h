@@ -119,7 +119,7 @@ void PutFixed32(std::string* dst,uint32_t value){
 //将64位整数编码成字符串
 void PutFixed64(std::string* dst,uint64_t value){
     char buf[sizeof(value)];
-    EncodeFix64(buf,value);
+    EncodeFixed64(buf,value);
     dst->append(buf,sizeof(buf));
 }
 
@@ -197,7 +197,7 @@ int VarintLength(uint64_t v){
     return len;
 }
 
-inline uint32_t DecodeFixed64(const char* ptr){
+inline uint64_t DecodeFixed64(const char* ptr){
     const uint8_t* const buffer = reinterpret_cast<const uint8_t*>(ptr);
     return (static_cast<uint64_t>(buffer[0])) |
          (static_cast<uint64_t>(buffer[1]) << 8) |
@@ -12,6 +12,8 @@ public:
     virtual const char* Name() const=0;
     virtual void FindShortestSeparator(std::string* start,const Slice& limit) const =0;
     virtual void FindShortSuccessor(std::string* key) const =0;
+    //比较internal key的comparator返回它包装的user key comparator，其他comparator返回nullptr
+    virtual const Comparator* user_comparator() const { return nullptr;}
 };
 
 namespace{
@@ -0,0 +1,141 @@
+#pragma once
+#include<stddef.h>
+#include<stdint.h>
+#include<atomic>
+#include<string>
+#include<vector>
+#include "port/port.h"
+#include "util/no_destructor.h"
+#include "util/options.h"
+#include "util/slice.h"
+
+namespace leveldb{
+
+/**
+ * block的压缩算法。Type()写入block trailer的类型字节，读取时按这个字节找到对应的算法解压，
+ * 同一个sstable中的block可以使用不同的算法
+ * 内置snappy、lz4和zstd，压缩库没有编译进来(HAVE_SNAPPY/HAVE_LZ4/HAVE_ZSTD)时压缩和解压都返回false
+ */
+class Compressor{
+public:
+    virtual ~Compressor() = default;
+    virtual const char* Name() const = 0;
+    virtual CompressionType Type() const = 0;
+    //dict为空时不使用字典，失败时返回false，调用者按不压缩写入
+    virtual bool Compress(const Slice& input,const Slice& dict,std::string* output) const = 0;
+    virtual bool GetUncompressedLength(const Slice& input,size_t* result) const = 0;
+    //output的大小为GetUncompressedLength的结果，dict必须与压缩时相同
+    virtual bool Uncompress(const Slice& input,const Slice& dict,char* output,size_t output_length) const = 0;
+    //能否使用TrainDictionary训练出的字典
+    virtual bool SupportsDictionary() const { return false;}
+    //用samples训练不超过max_length字节的字典
+    virtual bool TrainDictionary(const std::vector<Slice>& samples,size_t max_length,std::string* dict) const{
+        return false;
+    }
+};
+
+namespace{
+
+class SnappyCompressor:public Compressor{
+public:
+    const char* Name() const override { return "leveldb.Snappy";}
+    CompressionType Type() const override { return kSnappyCompression;}
+    bool Compress(const Slice& input,const Slice& dict,std::string* output) const override{
+        return port::Snappy_Compress(input.data(),input.size(),output);
+    }
+    bool GetUncompressedLength(const Slice& input,size_t* result) const override{
+        return port::Snappy_GetUncompressedLength(input.data(),input.size(),result);
+    }
+    bool Uncompress(const Slice& input,const Slice& dict,char* output,size_t output_length) const override{
+        return port::Snappy_Uncompress(input.data(),input.size(),output);
+    }
+};
+
+class LZ4Compressor:public Compressor{
+public:
+    const char* Name() const override { return "leveldb.LZ4";}
+    CompressionType Type() const override { return kLZ4Compression;}
+    bool Compress(const Slice& input,const Slice& dict,std::string* output) const override{
+        return port::LZ4_Compress(input.data(),input.size(),output);
+    }
+    bool GetUncompressedLength(const Slice& input,size_t* result) const override{
+        return port::LZ4_GetUncompressedLength(input.data(),input.size(),result);
+    }
+    bool Uncompress(const Slice& input,const Slice& dict,char* output,size_t output_length) const override{
+        return port::LZ4_Uncompress(input.data(),input.size(),output,output_length);
+    }
+};
+
+class ZstdCompressor:public Compressor{
+public:
+    const char* Name() const override { return "leveldb.Zstd";}
+    CompressionType Type() const override { return kZstdCompression;}
+    bool Compress(const Slice& input,const Slice& dict,std::string* output) const override{
+        return port::Zstd_Compress(kLevel,input.data(),input.size(),dict.data(),dict.size(),output);
+    }
+    bool GetUncompressedLength(const Slice& input,size_t* result) const override{
+        return port::Zstd_GetUncompressedLength(input.data(),input.size(),result);
+    }
+    bool Uncompress(const Slice& input,const Slice& dict,char* output,size_t output_length) const override{
+        return port::Zstd_Uncompress(input.data(),input.size(),dict.data(),dict.size(),output,output_length);
+    }
+    bool SupportsDictionary() const override { return true;}
+    bool TrainDictionary(const std::vector<Slice>& samples,size_t max_length,std::string* dict) const override{
+        std::string buffer;
+        std::vector<size_t> lengths(samples.size());
+        for(size_t i=0;i<samples.size();i++){
+            buffer.append(samples[i].data(),samples[i].size());
+            lengths[i] = samples[i].size();
+        }
+        return !samples.empty() &&
+               port::Zstd_TrainDictionary(buffer.data(),lengths.data(),static_cast<unsigned>(samples.size()),max_length,dict);
+    }
+private:
+    static const int kLevel = 3;
+};
+
+//按trailer类型字节索引的压缩算法
+class CompressorRegistry{
+public:
+    CompressorRegistry(){
+        for(size_t i=0;i<256;i++){
+            compressors_[i] = nullptr;
+        }
+        Register(&snappy_);
+        Register(&lz4_);
+        Register(&zstd_);
+    }
+    const Compressor* Get(uint8_t type) const { return compressors_[type].load(std::memory_order_acquire);}
+    void Register(const Compressor* compressor){
+        compressors_[static_cast<uint8_t>(compressor->Type())].store(compressor,std::memory_order_release);
+    }
+private:
+    SnappyCompressor snappy_;
+    LZ4Compressor lz4_;
+    ZstdCompressor zstd_;
+    std::atomic<const Compressor*> compressors_[256];
+};
+
+CompressorRegistry* GlobalCompressorRegistry(){
+    static NoDestructor<CompressorRegistry> singleton;
+    return singleton.get();
+}
+
+} // namespace
+
+//返回type对应的压缩算法，kNoCompression或没有注册的类型返回nullptr
+const Compressor* GetCompressor(CompressionType type){
+    if(type==kNoCompression){
+        return nullptr;
+    }
+    return GlobalCompressorRegistry()->Get(static_cast<uint8_t>(type));
+}
+
+//注册自定义的压缩算法，或替换Type()相同的已有算法；不持有compressor，它必须一直有效
+//Type()不能是kNoCompression，而且写入的sstable只能由注册了同样算法的进程读取
+void RegisterCompressor(const Compressor* compressor){
+    assert(compressor->Type()!=kNoCompression);
+    GlobalCompressorRegistry()->Register(compressor);
+}
+
+} // namespace leveldb
@@ -0,0 +1,57 @@
+#pragma once
+
+//运行时检测CPU支持的指令集，SIMD实现用__attribute__((target(...)))单独编译，按检测结果选择
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define LEVELDB_HAVE_X86_TARGET_ATTRIBUTE 1
+#endif
+//aarch64 Linux上通过getauxval检测CRC32扩展
+#if defined(__aarch64__) && defined(__linux__) && (defined(__GNUC__) || defined(__clang__))
+#define LEVELDB_HAVE_ARM64_CRC32 1
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#endif
+
+namespace leveldb{
+
+inline bool CpuHasAVX2(){
+#ifdef LEVELDB_HAVE_X86_TARGET_ATTRIBUTE
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+#else
+    return false;
+#endif
+}
+
+//SSE4.2的crc32指令
+inline bool CpuHasSSE42(){
+#ifdef LEVELDB_HAVE_X86_TARGET_ATTRIBUTE
+    static const bool has_sse42 = __builtin_cpu_supports("sse4.2");
+    return has_sse42;
+#else
+    return false;
+#endif
+}
+
+//无进位乘法PCLMULQDQ
+inline bool CpuHasPCLMUL(){
+#ifdef LEVELDB_HAVE_X86_TARGET_ATTRIBUTE
+    static const bool has_pclmul = __builtin_cpu_supports("pclmul");
+    return has_pclmul;
+#else
+    return false;
+#endif
+}
+
+//ARMv8的crc32c指令
+inline bool CpuHasARMCRC32(){
+#ifdef LEVELDB_HAVE_ARM64_CRC32
+    static const bool has_crc32 = (getauxval(AT_HWCAP) & HWCAP_CRC32)!=0;
+    return has_crc32;
+#else
+    return false;
+#endif
+}
+
+} // namespace leveldb
@@ -4,6 +4,14 @@
 #include <stdint.h>
 #include "port/port.h"
 #include "util/coding.h"
+#include "util/cpu_features.h"
+#ifdef LEVELDB_HAVE_X86_TARGET_ATTRIBUTE
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#endif
+#ifdef LEVELDB_HAVE_ARM64_CRC32
+#include <arm_acle.h>
+#endif
 namespace leveldb{
 namespace crc32c{
 
@@ -255,12 +263,8 @@ static bool CanAccelerateCRC32C() {
 
   return port::AcceleratedCRC32C(0, kTestCRCBuffer, kBufSize) == kTestCRCValue;
 }
-uint32_t Extend(uint32_t init_crc, const char* data, size_t n){
-     static bool accelerate = CanAccelerateCRC32C();
-  if (accelerate) {
-    return port::AcceleratedCRC32C(crc, data, n);
-  }
-
+//查表实现，没有硬件指令时使用
+uint32_t ExtendPortable(uint32_t crc, const char* data, size_t n){
   const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
   const uint8_t* e = p + n;
   uint32_t l = crc ^ kCRC32Xor;
@@ -358,6 +362,152 @@ uint32_t Extend(uint32_t init_crc, const char* data, size_t n){
   return l ^ kCRC32Xor;
 }
 
+namespace{
+
+//crc32c多项式的位反转表示
+static constexpr uint32_t kCRC32CPoly = 0x82f63b78u;
+
+//位反转表示下的多项式乘法 a*b mod P，最高位(bit31)是x^0的系数
+constexpr uint32_t CRC32CMultiply(uint32_t a, uint32_t b){
+    uint32_t r = 0;
+    for(uint32_t m = 0x80000000u; m != 0; m >>= 1){
+        if(a & m) r ^= b;
+        b = (b & 1) ? (b >> 1) ^ kCRC32CPoly : b >> 1;
+    }
+    return r;
+}
+
+//x^n mod P
+constexpr uint32_t CRC32CXPow(size_t n){
+    uint32_t r = 0x80000000u;
+    uint32_t base = 0x40000000u;
+    while(n != 0){
+        if(n & 1) r = CRC32CMultiply(r, base);
+        base = CRC32CMultiply(base, base);
+        n >>= 1;
+    }
+    return r;
+}
+
+/**
+ * 硬件实现把数据分成连续的三段交替计算，隐藏crc32指令3个周期的延迟。后两段从0开始计算，
+ * 合并时前面一段的结果要乘上x^(8*len)，即crc * x^(8*len-33)做无进位乘法后再用crc32指令约减
+ * 长段用于大块数据，短段处理剩下不足三个长段的部分
+ */
+static constexpr size_t kCRC32CLongBlock = 8192;
+static constexpr size_t kCRC32CShortBlock = 256;
+static constexpr uint64_t kCRC32CLongShift1 = CRC32CXPow(8 * kCRC32CLongBlock - 33);
+static constexpr uint64_t kCRC32CLongShift2 = CRC32CXPow(16 * kCRC32CLongBlock - 33);
+static constexpr uint64_t kCRC32CShortShift1 = CRC32CXPow(8 * kCRC32CShortBlock - 33);
+static constexpr uint64_t kCRC32CShortShift2 = CRC32CXPow(16 * kCRC32CShortBlock - 33);
+
+#ifdef LEVELDB_HAVE_X86_TARGET_ATTRIBUTE
+__attribute__((target("sse4.2,pclmul")))
+inline uint64_t CRC32CShift(uint64_t crc, uint64_t k){
+    const __m128i product = _mm_clmulepi64_si128(_mm_cvtsi64_si128(static_cast<long long>(crc)),
+                                                 _mm_cvtsi64_si128(static_cast<long long>(k)), 0);
+    return _mm_crc32_u64(0, static_cast<uint64_t>(_mm_cvtsi128_si64(product)));
+}
+
+//每次处理3*block字节，*p前进到剩余不足3*block字节的位置
+__attribute__((target("sse4.2,pclmul")))
+inline uint64_t CRC32CThreeWay(uint64_t l, const uint8_t** p, const uint8_t* e, size_t block,
+                               uint64_t shift1, uint64_t shift2){
+    const uint8_t* q = *p;
+    while(static_cast<size_t>(e - q) >= 3 * block){
+        uint64_t crc0 = l, crc1 = 0, crc2 = 0;
+        for(size_t i = 0; i < block; i += 8){
+            crc0 = _mm_crc32_u64(crc0, DecodeFixed64(reinterpret_cast<const char*>(q + i)));
+            crc1 = _mm_crc32_u64(crc1, DecodeFixed64(reinterpret_cast<const char*>(q + block + i)));
+            crc2 = _mm_crc32_u64(crc2, DecodeFixed64(reinterpret_cast<const char*>(q + 2 * block + i)));
+        }
+        l = CRC32CShift(crc0, shift2) ^ CRC32CShift(crc1, shift1) ^ crc2;
+        q += 3 * block;
+    }
+    *p = q;
+    return l;
+}
+#endif
+
+#ifdef LEVELDB_HAVE_ARM64_CRC32
+#ifdef __clang__
+#define LEVELDB_ARM64_CRC32_TARGET __attribute__((target("crc")))
+#else
+#define LEVELDB_ARM64_CRC32_TARGET __attribute__((target("+crc")))
+#endif
+#endif
+
+}//namespace
+
+#ifdef LEVELDB_HAVE_X86_TARGET_ATTRIBUTE
+//SSE4.2实现，调用前需要CpuHasSSE42()和CpuHasPCLMUL()都为true
+__attribute__((target("sse4.2,pclmul")))
+uint32_t ExtendSSE42(uint32_t crc, const char* data, size_t n){
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    const uint8_t* e = p + n;
+    uint64_t l = crc ^ kCRC32Xor;
+    while(p != e && (reinterpret_cast<uintptr_t>(p) & 7) != 0){
+        l = _mm_crc32_u8(static_cast<uint32_t>(l), *p++);
+    }
+    l = CRC32CThreeWay(l, &p, e, kCRC32CLongBlock, kCRC32CLongShift1, kCRC32CLongShift2);
+    l = CRC32CThreeWay(l, &p, e, kCRC32CShortBlock, kCRC32CShortShift1, kCRC32CShortShift2);
+    while(e - p >= 8){
+        l = _mm_crc32_u64(l, DecodeFixed64(reinterpret_cast<const char*>(p)));
+        p += 8;
+    }
+    while(p != e){
+        l = _mm_crc32_u8(static_cast<uint32_t>(l), *p++);
+    }
+    return static_cast<uint32_t>(l) ^ kCRC32Xor;
+}
+#endif
+
+#ifdef LEVELDB_HAVE_ARM64_CRC32
+//ARMv8实现，调用前需要CpuHasARMCRC32()为true
+LEVELDB_ARM64_CRC32_TARGET
+uint32_t ExtendARM64(uint32_t crc, const char* data, size_t n){
+    uint32_t l = crc ^ kCRC32Xor;
+    while(n >= 8){
+        l = __crc32cd(l, DecodeFixed64(data));
+        data += 8;
+        n -= 8;
+    }
+    while(n > 0){
+        l = __crc32cb(l, static_cast<uint8_t>(*data++));
+        n--;
+    }
+    return l ^ kCRC32Xor;
+}
+#endif
+
+typedef uint32_t (*ExtendFunction)(uint32_t crc, const char* data, size_t n);
+
+//按CPU支持的指令选择实现，编译时链接了crc32c库则优先使用它
+static ExtendFunction ChooseExtend(){
+    if(CanAccelerateCRC32C()){
+        return port::AcceleratedCRC32C;
+    }
+#ifdef LEVELDB_HAVE_X86_TARGET_ATTRIBUTE
+    if(CpuHasSSE42() && CpuHasPCLMUL()){
+        return ExtendSSE42;
+    }
+#endif
+#ifdef LEVELDB_HAVE_ARM64_CRC32
+    if(CpuHasARMCRC32()){
+        return ExtendARM64;
+    }
+#endif
+    return ExtendPortable;
+}
+
+// Return the crc32c of concat(A, data[0,n-1]) where init_crc is the
+// crc32c of some string A.  Extend() is often used to maintain the
+// crc32c of a stream of data.
+uint32_t Extend(uint32_t crc, const char* data, size_t n){
+    static const ExtendFunction extend = ChooseExtend();
+    return extend(crc, data, n);
+}
+
 // Return the crc32c of data[0,n-1]
 inline uint32_t Value(const char* data, size_t n) { return Extend(0, data, n); }
 
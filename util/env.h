@@ -0,0 +1,83 @@
+#pragma once
+#include<stddef.h>
+#include<stdint.h>
+#include "util/slice.h"
+#include "util/status.h"
+
+namespace leveldb{
+
+//文件的访问方式，用于提示操作系统预读
+enum AccessPattern{
+    kNormalAccess,
+    kRandomAccess,
+    kSequentialAccess
+};
+
+//批量或异步读取中的一个请求，result和status由文件填写
+struct ReadRequest{
+    uint64_t offset = 0;
+    size_t len = 0;
+    char* scratch = nullptr;//至少len字节，文件SupportsZeroCopy时可以为nullptr
+    Slice result;
+    Status status;
+};
+
+//异步读取完成后的回调，可能在其他线程中调用
+typedef void(*ReadCallback)(void* arg,ReadRequest* req);
+
+//随机读文件，sstable通过该接口读取block，必须是线程安全的
+class RandomAccessFile{
+public:
+    RandomAccessFile() = default;
+    RandomAccessFile(const RandomAccessFile&) = delete;
+    RandomAccessFile& operator=(const RandomAccessFile&) = delete;
+    virtual ~RandomAccessFile(){}
+
+    //从offset处读取最多n个字节，*result可能指向scratch[0,n-1]，也可能指向文件自身的内存
+    virtual Status Read(uint64_t offset,size_t n,Slice* result,char* scratch) const = 0;
+
+    //返回true时Read总是返回指向文件自身内存(如mmap)的结果，在文件对象的生命周期内有效，scratch可以为nullptr
+    virtual bool SupportsZeroCopy() const { return false;}
+
+    //提示之后的访问方式，默认忽略
+    virtual void Hint(AccessPattern pattern) const {}
+
+    //一次提交reqs[0,num-1]，全部完成后返回，默认逐个同步读取
+    virtual void MultiRead(ReadRequest* reqs,size_t num) const{
+        for(size_t i=0;i<num;i++){
+            reqs[i].status = Read(reqs[i].offset,reqs[i].len,&reqs[i].result,reqs[i].scratch);
+        }
+    }
+
+    //提交后立即返回，读取完成后调用callback(arg,req)，req在回调之前必须保持有效
+    //返回错误时不会调用callback；默认同步读取后在当前线程中调用callback
+    virtual Status ReadAsync(ReadRequest* req,ReadCallback callback,void* arg) const{
+        req->status = Read(req->offset,req->len,&req->result,req->scratch);
+        (*callback)(arg,req);
+        return Status::OK();
+    }
+};
+
+//顺序写文件，调用者负责同步，写入的数据可能先缓存在内存中
+class WritableFile{
+public:
+    WritableFile() = default;
+    WritableFile(const WritableFile&) = delete;
+    WritableFile& operator=(const WritableFile&) = delete;
+    virtual ~WritableFile(){}
+
+    virtual Status Append(const Slice& data) = 0;
+    //依次追加data和trailer，带缓冲的文件把两者连续拷贝进缓冲区；默认调用两次Append
+    virtual Status AppendWithTrailer(const Slice& data,const Slice& trailer){
+        Status s = Append(data);
+        if(s.ok()){
+            s = Append(trailer);
+        }
+        return s;
+    }
+    virtual Status Close() = 0;
+    virtual Status Flush() = 0;
+    virtual Status Sync() = 0;
+};
+
+} // namespace leveldb
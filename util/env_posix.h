@@ -0,0 +1,635 @@
+#pragma once
+#include<errno.h>
+#include<fcntl.h>
+#include<stdlib.h>
+#include<string.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+#include<algorithm>
+#include<string>
+#include "port/port.h"
+#include "util/env.h"
+#include "util/mutexlock.h"
+#include "util/options.h"
+#include "util/slice.h"
+#include "util/status.h"
+#if HAVE_LIBURING
+#include<liburing.h>
+#include<chrono>
+#include<thread>
+#include<vector>
+#endif
+
+namespace leveldb{
+
+namespace{
+
+static Status PosixError(const std::string& context,int error_number){
+    if(error_number==ENOENT){
+        return Status::NotFound(context,strerror(error_number));
+    }
+    return Status::IOError(context,strerror(error_number));
+}
+
+#if HAVE_LIBURING
+static const unsigned kIOUringQueueDepth = 256;
+
+//每个线程一个ring，用于提交后同步等待的批量读取
+struct ThreadLocalIOUring{
+    ThreadLocalIOUring(){ ok = (io_uring_queue_init(kIOUringQueueDepth,&ring,0)==0);}
+    ~ThreadLocalIOUring(){
+        if(ok) io_uring_queue_exit(&ring);
+    }
+    io_uring ring;
+    bool ok;
+};
+
+static ThreadLocalIOUring* CurrentThreadIOUring(){
+    static thread_local ThreadLocalIOUring ring;
+    return ring.ok ? &ring : nullptr;
+}
+
+static void FinishIOUringRead(const io_uring_cqe* cqe,const std::string& filename,ReadRequest* req){
+    if(cqe->res<0){
+        req->result = Slice();
+        req->status = PosixError(filename,-cqe->res);
+    }else{
+        req->result = Slice(req->scratch,cqe->res);
+        req->status = Status::OK();
+    }
+}
+
+//销毁这个线程的ring，之后的批量读取改用pread
+static void DisableIOUring(ThreadLocalIOUring* local){
+    io_uring_queue_exit(&local->ring);
+    local->ok = false;
+}
+
+static void PreadRequests(int fd,const std::string& filename,ReadRequest* reqs,size_t num){
+    for(size_t i=0;i<num;i++){
+        ssize_t r = pread(fd,reqs[i].scratch,reqs[i].len,static_cast<off_t>(reqs[i].offset));
+        reqs[i].result = Slice(reqs[i].scratch,r<0 ? 0 : r);
+        reqs[i].status = r<0 ? PosixError(filename,errno) : Status::OK();
+    }
+}
+
+//一次提交一批读取并等待全部完成，ring不可用时返回false，由调用者改用pread
+static bool IOUringMultiRead(int fd,const std::string& filename,ReadRequest* reqs,size_t num){
+    ThreadLocalIOUring* local = CurrentThreadIOUring();
+    if(local==nullptr) return false;
+    io_uring* ring = &local->ring;
+    std::vector<char> completed;
+    size_t done = 0;
+    while(done<num){
+        const size_t batch = std::min<size_t>(num-done,kIOUringQueueDepth);
+        size_t queued = 0;
+        for(;queued<batch;queued++){
+            ReadRequest* req = &reqs[done+queued];
+            io_uring_sqe* sqe = io_uring_get_sqe(ring);
+            if(sqe==nullptr) break;
+            io_uring_prep_read(sqe,fd,req->scratch,req->len,req->offset);
+            io_uring_sqe_set_data(sqe,req);
+        }
+        int ret = 0;
+        if(queued>0){
+            do{
+                ret = io_uring_submit_and_wait(ring,queued);
+            }while(ret==-EINTR || ret==-EAGAIN);
+        }
+        if(queued==0 || ret<=0){
+            //没有请求进入内核，销毁这个ring(连同没提交的sqe)，剩下的请求改用pread
+            DisableIOUring(local);
+            PreadRequests(fd,filename,reqs+done,num-done);
+            return true;
+        }
+        //sqe按顺序提交，只提交了前submitted个
+        const size_t submitted = std::min<size_t>(ret,queued);
+        //每个提交的请求都要收割，否则它的完成事件留在ring中，下一次调用会通过user_data写已经释放的请求
+        completed.assign(submitted,0);
+        for(size_t i=0;i<submitted;i++){
+            io_uring_cqe* cqe;
+            int r;
+            do{
+                r = io_uring_wait_cqe(ring,&cqe);
+            }while(r==-EINTR || r==-EAGAIN);
+            if(r!=0){
+                //无法再收割，没完成的请求和之后的请求都失败，销毁ring丢弃剩下的完成事件
+                const Status s = PosixError(filename,-r);
+                for(size_t j=0;j<num-done;j++){
+                    if(j<submitted && completed[j]) continue;
+                    reqs[done+j].result = Slice();
+                    reqs[done+j].status = s;
+                }
+                DisableIOUring(local);
+                return true;
+            }
+            ReadRequest* req = reinterpret_cast<ReadRequest*>(io_uring_cqe_get_data(cqe));
+            FinishIOUringRead(cqe,filename,req);
+            completed[req-(reqs+done)] = 1;
+            io_uring_cqe_seen(ring,cqe);
+        }
+        done += submitted;
+        if(submitted<queued){
+            //没提交的sqe还在队列中，不能留给下一次调用
+            DisableIOUring(local);
+            PreadRequests(fd,filename,reqs+done,num-done);
+            return true;
+        }
+    }
+    return true;
+}
+
+/**
+ * ReadAsync使用的全局ring，提交在调用线程中进行(加锁)，完成由一个后台线程收割并调用回调，
+ * 回调在后台线程中执行，不能阻塞太久
+ */
+class IOUringReactor{
+public:
+    static IOUringReactor* Get(){
+        //后台线程一直运行到进程退出，不释放
+        static IOUringReactor* reactor = new IOUringReactor;
+        return reactor;
+    }
+
+    //ring不可用或者正在进行的请求太多时返回false，由调用者同步读取
+    bool Submit(int fd,const std::string* filename,ReadRequest* req,ReadCallback callback,void* arg){
+        MutexLock l(&mutex_);
+        if(!ok_ || in_flight_>=kIOUringQueueDepth) return false;
+        io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
+        if(sqe==nullptr) return false;
+        Task* task = new Task{filename,req,callback,arg};
+        io_uring_prep_read(sqe,fd,req->scratch,req->len,req->offset);
+        io_uring_sqe_set_data(sqe,task);
+        int ret;
+        do{
+            ret = io_uring_submit(&ring_);
+        }while(ret==-EINTR || ret==-EAGAIN);
+        if(ret<0){
+            //无法恢复的错误，之后不再使用io_uring，留在队列中的sqe不会再被提交
+            ok_ = false;
+            delete task;
+            return false;
+        }
+        in_flight_++;
+        return true;
+    }
+
+private:
+    struct Task{
+        const std::string* filename;
+        ReadRequest* req;
+        ReadCallback callback;
+        void* arg;
+    };
+
+    IOUringReactor():in_flight_(0){
+        ok_ = (io_uring_queue_init(kIOUringQueueDepth,&ring_,0)==0);
+        if(ok_){
+            std::thread(&IOUringReactor::Reap,this).detach();
+        }
+    }
+
+    void Reap(){
+        int backoff_ms = 1;
+        while(true){
+            io_uring_cqe* cqe;
+            const int ret = io_uring_wait_cqe(&ring_,&cqe);
+            if(ret==-EINTR || ret==-EAGAIN) continue;
+            if(ret!=0){
+                //持续出错时不再接受新的请求，退避等待已经提交的请求，全部完成后退出
+                {
+                    MutexLock l(&mutex_);
+                    ok_ = false;
+                    if(in_flight_==0) return;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(backoff_ms));
+                backoff_ms = std::min(backoff_ms*2,1000);
+                continue;
+            }
+            backoff_ms = 1;
+            Task* task = reinterpret_cast<Task*>(io_uring_cqe_get_data(cqe));
+            FinishIOUringRead(cqe,*task->filename,task->req);
+            io_uring_cqe_seen(&ring_,cqe);
+            {
+                MutexLock l(&mutex_);
+                in_flight_--;
+            }
+            (*task->callback)(task->arg,task->req);
+            delete task;
+        }
+    }
+
+    port::Mutex mutex_;//保护提交队列
+    bool ok_;
+    io_uring ring_;
+    unsigned in_flight_;
+};
+#endif // HAVE_LIBURING
+
+//用pread读取，多个线程可以同时读，有io_uring时批量和异步读取经过io_uring
+class PosixRandomAccessFile:public RandomAccessFile{
+public:
+    //持有fd，析构时关闭
+    PosixRandomAccessFile(const std::string& filename,int fd):filename_(filename),fd_(fd){}
+    ~PosixRandomAccessFile() override { close(fd_);}
+
+    Status Read(uint64_t offset,size_t n,Slice* result,char* scratch) const override{
+        ssize_t read_size = pread(fd_,scratch,n,static_cast<off_t>(offset));
+        *result = Slice(scratch,(read_size<0) ? 0 : read_size);
+        if(read_size<0){
+            return PosixError(filename_,errno);
+        }
+        return Status::OK();
+    }
+
+    void Hint(AccessPattern pattern) const override{
+#if defined(POSIX_FADV_RANDOM)
+        int advice = POSIX_FADV_NORMAL;
+        if(pattern==kRandomAccess) advice = POSIX_FADV_RANDOM;
+        else if(pattern==kSequentialAccess) advice = POSIX_FADV_SEQUENTIAL;
+        posix_fadvise(fd_,0,0,advice);
+#endif
+    }
+
+#if HAVE_LIBURING
+    void MultiRead(ReadRequest* reqs,size_t num) const override{
+        if(num<=1 || !IOUringMultiRead(fd_,filename_,reqs,num)){
+            RandomAccessFile::MultiRead(reqs,num);
+        }
+    }
+
+    Status ReadAsync(ReadRequest* req,ReadCallback callback,void* arg) const override{
+        if(IOUringReactor::Get()->Submit(fd_,&filename_,req,callback,arg)){
+            return Status::OK();
+        }
+        return RandomAccessFile::ReadAsync(req,callback,arg);
+    }
+#endif
+
+private:
+    const std::string filename_;
+    const int fd_;
+};
+
+//把整个文件映射到内存，Read不拷贝，直接返回映射内存中的数据
+class PosixMmapReadableFile:public RandomAccessFile{
+public:
+    //mmap_base为mmap的结果，析构时munmap
+    PosixMmapReadableFile(const std::string& filename,char* mmap_base,size_t length)
+        :filename_(filename),mmap_base_(mmap_base),length_(length){}
+    ~PosixMmapReadableFile() override{
+        munmap(static_cast<void*>(mmap_base_),length_);
+    }
+
+    Status Read(uint64_t offset,size_t n,Slice* result,char* scratch) const override{
+        if(offset+n>length_){
+            *result = Slice();
+            return PosixError(filename_,EINVAL);
+        }
+        *result = Slice(mmap_base_+offset,n);
+        return Status::OK();
+    }
+
+    bool SupportsZeroCopy() const override { return true;}
+
+    //点查用MADV_RANDOM避免内核按页预读浪费内存，顺序扫描用MADV_SEQUENTIAL加大预读
+    void Hint(AccessPattern pattern) const override{
+        int advice = MADV_NORMAL;
+        if(pattern==kRandomAccess) advice = MADV_RANDOM;
+        else if(pattern==kSequentialAccess) advice = MADV_SEQUENTIAL;
+        madvise(static_cast<void*>(mmap_base_),length_,advice);
+    }
+
+private:
+    const std::string filename_;
+    char* const mmap_base_;
+    const size_t length_;
+};
+
+} // namespace
+
+//写缓冲、O_DIRECT读写的地址、偏移和长度的对齐单位
+static const size_t kWritableFileAlignment = 4096;
+
+static size_t RoundUpToAlignment(size_t n){
+    return (n+kWritableFileAlignment-1)/kWritableFileAlignment*kWritableFileAlignment;
+}
+
+/**
+ * 带写缓冲的顺序写文件。Append只拷贝进对齐的缓冲区，缓冲区写满时一次写出整个缓冲区，
+ * 所以除最后一次外每次写的偏移和长度都是缓冲区大小的倍数；Flush、Sync和Close写出剩余数据
+ * use_direct_io(O_DIRECT)时数据不经过page cache，不满一页的尾部补0后按整页写出，
+ * 再ftruncate到实际大小，尾页留在缓冲区中，之后的数据连同它一起重写
+ * 不是线程安全的
+ */
+class PosixWritableFile:public WritableFile{
+public:
+    //持有fd和buf(posix_memalign分配，capacity字节)，析构时关闭和释放
+    PosixWritableFile(const std::string& filename,int fd,char* buf,size_t capacity,bool use_direct_io)
+        :filename_(filename),fd_(fd),buf_(buf),capacity_(capacity),use_direct_io_(use_direct_io),
+         pos_(0),flushed_pos_(0),file_offset_(0),write_calls_(0),bytes_written_(0){}
+    ~PosixWritableFile() override{
+        if(fd_>=0){
+            Close();
+        }
+        free(buf_);
+    }
+
+    Status Append(const Slice& data) override { return BufferData(data.data(),data.size());}
+
+    Status AppendWithTrailer(const Slice& data,const Slice& trailer) override{
+        Status s = BufferData(data.data(),data.size());
+        if(s.ok()){
+            s = BufferData(trailer.data(),trailer.size());
+        }
+        return s;
+    }
+
+    Status Flush() override { return FlushBuffer();}
+
+    Status Sync() override{
+        Status s = FlushBuffer();
+        if(s.ok() && fdatasync(fd_)!=0){
+            s = PosixError(filename_,errno);
+        }
+        return s;
+    }
+
+    Status Close() override{
+        Status s = FlushBuffer();
+        if(close(fd_)!=0 && s.ok()){
+            s = PosixError(filename_,errno);
+        }
+        fd_ = -1;
+        return s;
+    }
+
+    //写文件的系统调用次数和写出的字节数(O_DIRECT时包括补齐和重写的尾页)
+    uint64_t write_calls() const { return write_calls_;}
+    uint64_t bytes_written() const { return bytes_written_;}
+    size_t buffer_size() const { return capacity_;}
+    //打开时请求了O_DIRECT但文件系统不支持时为false
+    bool use_direct_io() const { return use_direct_io_;}
+
+private:
+    Status BufferData(const char* data,size_t n){
+        while(n>0){
+            //缓冲区为空且剩余数据超过一个缓冲区时直接写，不再拷贝；O_DIRECT要求对齐的内存，不能直接写
+            if(!use_direct_io_ && pos_==0 && n>=capacity_){
+                const size_t direct = n-n%capacity_;
+                Status s = WriteAt(data,direct,file_offset_);
+                if(!s.ok()) return s;
+                file_offset_ += direct;
+                data += direct;
+                n -= direct;
+                continue;
+            }
+            const size_t copy = std::min(n,capacity_-pos_);
+            memcpy(buf_+pos_,data,copy);
+            pos_ += copy;
+            data += copy;
+            n -= copy;
+            if(pos_==capacity_){
+                Status s = FlushBuffer();
+                if(!s.ok()) return s;
+            }
+        }
+        return Status::OK();
+    }
+
+    Status FlushBuffer(){
+        if(pos_==flushed_pos_){
+            return Status::OK();
+        }
+        if(!use_direct_io_){
+            Status s = WriteAt(buf_,pos_,file_offset_);
+            file_offset_ += pos_;
+            pos_ = 0;
+            return s;
+        }
+        const size_t aligned = RoundUpToAlignment(pos_);
+        memset(buf_+pos_,0,aligned-pos_);
+        Status s = WriteAt(buf_,aligned,file_offset_);
+        if(!s.ok()){
+            return s;
+        }
+        const size_t tail_start = pos_-pos_%kWritableFileAlignment;
+        const size_t tail = pos_-tail_start;
+        file_offset_ += tail_start;
+        if(tail>0){
+            memmove(buf_,buf_+tail_start,tail);
+            if(ftruncate(fd_,static_cast<off_t>(file_offset_+tail))!=0){
+                s = PosixError(filename_,errno);
+            }
+        }
+        pos_ = tail;
+        flushed_pos_ = tail;
+        return s;
+    }
+
+    Status WriteAt(const char* data,size_t n,uint64_t offset){
+        while(n>0){
+            write_calls_++;
+            ssize_t r = pwrite(fd_,data,n,static_cast<off_t>(offset));
+            if(r<0){
+                if(errno==EINTR) continue;
+                return PosixError(filename_,errno);
+            }
+            data += r;
+            n -= r;
+            offset += r;
+            bytes_written_ += r;
+        }
+        return Status::OK();
+    }
+
+    const std::string filename_;
+    int fd_;
+    char* const buf_;
+    const size_t capacity_;
+    const bool use_direct_io_;
+    size_t pos_;//缓冲区中数据的长度
+    size_t flushed_pos_;//O_DIRECT时已经写出的尾页的长度，没有新数据时Flush不再重写
+    uint64_t file_offset_;//buf_[0]在文件中的偏移
+    uint64_t write_calls_;
+    uint64_t bytes_written_;
+};
+
+namespace{
+
+/**
+ * 用O_DIRECT读取，不经过page cache，用于compaction等后台的顺序读取，避免挤出前台读取的热数据
+ * 每次读取按kWritableFileAlignment对齐，并至少读取readahead字节，之后落在其中的读取直接从缓冲区拷贝
+ * 缓冲区由mutex保护，多个线程可以同时读
+ */
+class PosixDirectRandomAccessFile:public RandomAccessFile{
+public:
+    //持有fd，析构时关闭
+    PosixDirectRandomAccessFile(const std::string& filename,int fd,size_t readahead)
+        :filename_(filename),fd_(fd),readahead_(RoundUpToAlignment(std::max<size_t>(readahead,1))),
+         buf_(nullptr),capacity_(0),buf_offset_(0),buf_len_(0){}
+    ~PosixDirectRandomAccessFile() override{
+        close(fd_);
+        free(buf_);
+    }
+
+    Status Read(uint64_t offset,size_t n,Slice* result,char* scratch) const override{
+        MutexLock l(&mutex_);
+        if(offset<buf_offset_ || offset+n>buf_offset_+buf_len_){
+            const uint64_t start = offset-offset%kWritableFileAlignment;
+            const size_t len = std::max(readahead_,RoundUpToAlignment(static_cast<size_t>(offset+n-start)));
+            Status s = Fill(start,len);
+            if(!s.ok()){
+                *result = Slice();
+                return s;
+            }
+        }
+        size_t copy = 0;
+        if(offset>=buf_offset_ && offset<buf_offset_+buf_len_){
+            copy = std::min<size_t>(n,buf_offset_+buf_len_-offset);
+            memcpy(scratch,buf_+(offset-buf_offset_),copy);
+        }
+        *result = Slice(scratch,copy);
+        return Status::OK();
+    }
+
+private:
+    //从对齐的start读取len字节到缓冲区，到达文件末尾时buf_len_小于len
+    Status Fill(uint64_t start,size_t len) const{
+        if(len>capacity_){
+            void* buf = nullptr;
+            if(posix_memalign(&buf,kWritableFileAlignment,len)!=0){
+                return Status::IOError(filename_,"cannot allocate read buffer");
+            }
+            free(buf_);
+            buf_ = reinterpret_cast<char*>(buf);
+            capacity_ = len;
+        }
+        ssize_t r;
+        do{
+            r = pread(fd_,buf_,len,static_cast<off_t>(start));
+        }while(r<0 && errno==EINTR);
+        buf_offset_ = start;
+        buf_len_ = r<0 ? 0 : static_cast<size_t>(r);
+        if(r<0){
+            return PosixError(filename_,errno);
+        }
+        return Status::OK();
+    }
+
+    const std::string filename_;
+    const int fd_;
+    const size_t readahead_;
+    mutable port::Mutex mutex_;
+    mutable char* buf_;
+    mutable size_t capacity_;
+    mutable uint64_t buf_offset_;//缓冲区中数据在文件中的偏移
+    mutable size_t buf_len_;
+};
+
+//打开fd，use_direct_io时加上O_DIRECT，系统或文件系统不支持时不使用O_DIRECT，*use_direct_io置为false
+static int OpenMaybeDirect(const std::string& filename,int flags,bool* use_direct_io){
+#if defined(O_DIRECT)
+    if(*use_direct_io){
+        int fd = open(filename.c_str(),flags | O_DIRECT,0644);
+        if(fd>=0 || errno!=EINVAL){
+            return fd;
+        }
+    }
+#endif
+    *use_direct_io = false;
+    return open(filename.c_str(),flags,0644);
+}
+
+} // namespace
+
+//创建(或截断)一个顺序写文件，写缓冲为buffer_size(通常取options.writable_file_buffer_size)向上对齐到kWritableFileAlignment
+//use_direct_io时使用O_DIRECT，不支持时退回普通的写入
+Status NewPosixWritableFile(const std::string& filename,size_t buffer_size,bool use_direct_io,WritableFile** result){
+    *result = nullptr;
+    const size_t capacity = std::max(kWritableFileAlignment,RoundUpToAlignment(buffer_size));
+    void* buf = nullptr;
+    if(posix_memalign(&buf,kWritableFileAlignment,capacity)!=0){
+        return Status::IOError(filename,"cannot allocate write buffer");
+    }
+    int fd = OpenMaybeDirect(filename,O_TRUNC | O_WRONLY | O_CREAT | O_CLOEXEC,&use_direct_io);
+    if(fd<0){
+        free(buf);
+        return PosixError(filename,errno);
+    }
+    *result = new PosixWritableFile(filename,fd,reinterpret_cast<char*>(buf),capacity,use_direct_io);
+    return Status::OK();
+}
+
+//打开一个用O_DIRECT读取的文件，每次至少读取readahead字节；不支持O_DIRECT时使用pread
+Status NewPosixDirectRandomAccessFile(const std::string& filename,size_t readahead,RandomAccessFile** result){
+    *result = nullptr;
+    bool use_direct_io = true;
+    int fd = OpenMaybeDirect(filename,O_RDONLY | O_CLOEXEC,&use_direct_io);
+    if(fd<0){
+        return PosixError(filename,errno);
+    }
+    if(use_direct_io){
+        *result = new PosixDirectRandomAccessFile(filename,fd,readahead);
+    }else{
+        *result = new PosixRandomAccessFile(filename,fd);
+        (*result)->Hint(kSequentialAccess);
+    }
+    return Status::OK();
+}
+
+//打开一个用于随机读的文件，use_mmap为true时映射整个文件，否则使用pread
+//pattern为初始的访问方式提示
+Status NewPosixRandomAccessFile(const std::string& filename,bool use_mmap,AccessPattern pattern,
+                                RandomAccessFile** result){
+    *result = nullptr;
+    int fd = open(filename.c_str(),O_RDONLY | O_CLOEXEC);
+    if(fd<0){
+        return PosixError(filename,errno);
+    }
+    if(!use_mmap){
+        *result = new PosixRandomAccessFile(filename,fd);
+        (*result)->Hint(pattern);
+        return Status::OK();
+    }
+    struct stat file_stat;
+    if(fstat(fd,&file_stat)!=0){
+        Status s = PosixError(filename,errno);
+        close(fd);
+        return s;
+    }
+    const size_t file_size = static_cast<size_t>(file_stat.st_size);
+    Status s;
+    if(file_size==0){
+        //长度为0的文件不能mmap
+        *result = new PosixRandomAccessFile(filename,fd);
+        return s;
+    }
+    void* mmap_base = mmap(nullptr,file_size,PROT_READ,MAP_SHARED,fd,0);
+    if(mmap_base!=MAP_FAILED){
+        *result = new PosixMmapReadableFile(filename,reinterpret_cast<char*>(mmap_base),file_size);
+        (*result)->Hint(pattern);
+    }else{
+        s = PosixError(filename,errno);
+    }
+    //映射建立后不再需要fd
+    close(fd);
+    return s;
+}
+
+//TableBuilder的输出文件，options.use_direct_io_for_table_builds时不经过page cache
+Status NewTableWritableFile(const Options& options,const std::string& filename,WritableFile** result){
+    return NewPosixWritableFile(filename,options.writable_file_buffer_size,options.use_direct_io_for_table_builds,result);
+}
+
+//后台(compaction等)读取sstable的文件，options.use_direct_reads_for_background时不经过page cache，
+//否则与前台一样使用pread；前台读取使用NewPosixRandomAccessFile
+Status NewBackgroundRandomAccessFile(const Options& options,const std::string& filename,RandomAccessFile** result){
+    if(options.use_direct_reads_for_background){
+        return NewPosixDirectRandomAccessFile(filename,options.direct_io_readahead_size,result);
+    }
+    return NewPosixRandomAccessFile(filename,false,kSequentialAccess,result);
+}
+
+} // namespace leveldb
@@ -0,0 +1,50 @@
+#pragma once
+#include<string>
+
+namespace leveldb{
+
+class Slice;
+
+//CreateFilter的累计统计，bloom_bytes为同样的key使用假阳率相同的bloom filter需要的字节数
+struct FilterPolicyStats{
+    uint64_t filters = 0;
+    uint64_t keys = 0;
+    uint64_t filter_bytes = 0;
+    uint64_t bloom_bytes = 0;
+    uint64_t bloom_fallbacks = 0;//退回bloom格式的filter个数
+};
+
+//filter用来判断一个key是否可能存在于一组key中，sstable为每个范围的data block生成一个filter，
+//点查时先查filter，filter判断不存在就不必读取data block
+class FilterPolicy{
+public:
+    virtual ~FilterPolicy();
+
+    //filter的名字，写入sstable的metaindex block中，filter格式改变时必须换一个名字
+    virtual const char* Name() const = 0;
+
+    //keys[0,n-1]为一组key(可能有重复)，按照keys生成filter并追加到*dst
+    virtual void CreateFilter(const Slice* keys,int n,std::string* dst) const = 0;
+
+    //filter是CreateFilter生成的内容，key在生成filter的那组key中时必须返回true，
+    //不在时应尽可能返回false
+    virtual bool KeyMayMatch(const Slice& key,const Slice& filter) const = 0;
+
+    //默认不统计
+    virtual void GetStats(FilterPolicyStats* stats) const {}
+};
+
+FilterPolicy::~FilterPolicy(){}
+
+//bits_per_key为每个key占用的位数，10时假阳率约为1%
+const FilterPolicy* NewBloomFilterPolicy(int bits_per_key);
+
+//每个key的所有探测位都落在同一个64字节的cache line内，点查只访问一次内存，
+//相同bits_per_key下假阳率略高于NewBloomFilterPolicy；名字为leveldb.CacheLineBloomFilter，与经典格式互不读取
+const FilterPolicy* NewCacheLineBloomFilterPolicy(int bits_per_key);
+
+//XOR filter，假阳率约0.4%，比同样假阳率的bloom filter节省约15%的空间，比10位的bloom filter假阳率更低；
+//构建失败或者key太少时退回bits_per_key为bloom_bits_per_key的bloom filter
+const FilterPolicy* NewXorFilterPolicy(int bloom_bits_per_key);
+
+} // namespace leveldb
@@ -42,4 +42,98 @@ uint32_t Hash(const char* data,size_t n,uint32_t seed){
     return h;
 }
 
+namespace hash_internal{
+//wyhash使用的常量
+static const uint64_t kWyp0 = 0x2d358dccaa6c78a5ull;
+static const uint64_t kWyp1 = 0x8bb84b93962eacc9ull;
+static const uint64_t kWyp2 = 0x4b33a62ed433d4a3ull;
+static const uint64_t kWyp3 = 0x4d5a2da51de1aa47ull;
+
+//64x64->128位乘法，*a,*b分别得到乘积的低64位和高64位
+inline void Mum(uint64_t* a,uint64_t* b){
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = *a;
+    r *= *b;
+    *a = static_cast<uint64_t>(r);
+    *b = static_cast<uint64_t>(r>>64);
+#else
+    const uint64_t ha = *a>>32, hb = *b>>32, la = static_cast<uint32_t>(*a), lb = static_cast<uint32_t>(*b);
+    const uint64_t rh = ha*hb, rm0 = ha*lb, rm1 = hb*la, rl = la*lb;
+    const uint64_t t = rl + (rm0<<32);
+    uint64_t c = t<rl;
+    const uint64_t lo = t + (rm1<<32);
+    c += lo<t;
+    *a = lo;
+    *b = rh + (rm0>>32) + (rm1>>32) + c;
+#endif
+}
+
+inline uint64_t Mix(uint64_t a,uint64_t b){
+    Mum(&a,&b);
+    return a^b;
+}
+
+inline uint64_t Read4(const char* p){ return DecodeFixed32(p);}
+inline uint64_t Read8(const char* p){ return DecodeFixed64(p);}
+} // namespace hash_internal
+
+//64位hash，算法同wyhash(final4)
+//与Hash相比，每轮用一次64x64->128位乘法处理16字节(长输入时三路并行处理48字节)，
+//乘法链之间没有数据依赖，流水线利用率高
+//结果的高位用于选择cache分片，低位用于选择hash桶和计算bloom filter的探测位置
+uint64_t Hash64(const char* data,size_t n,uint64_t seed){
+    using namespace hash_internal;
+    const char* p = data;
+    seed ^= Mix(seed^kWyp0,kWyp1);
+    uint64_t a,b;
+    if(n<=16){
+        if(n>=4){
+            a = (Read4(p)<<32) | Read4(p+((n>>3)<<2));
+            b = (Read4(p+n-4)<<32) | Read4(p+n-4-((n>>3)<<2));
+        }else if(n>0){
+            a = (static_cast<uint64_t>(static_cast<uint8_t>(p[0]))<<16) |
+                (static_cast<uint64_t>(static_cast<uint8_t>(p[n>>1]))<<8) |
+                static_cast<uint8_t>(p[n-1]);
+            b = 0;
+        }else{
+            a = b = 0;
+        }
+    }else{
+        size_t i = n;
+        if(i>48){
+            uint64_t see1 = seed, see2 = seed;
+            do{
+                seed = Mix(Read8(p)^kWyp1,Read8(p+8)^seed);
+                see1 = Mix(Read8(p+16)^kWyp2,Read8(p+24)^see1);
+                see2 = Mix(Read8(p+32)^kWyp3,Read8(p+40)^see2);
+                p += 48;
+                i -= 48;
+            }while(i>48);
+            seed ^= see1^see2;
+        }
+        while(i>16){
+            seed = Mix(Read8(p)^kWyp1,Read8(p+8)^seed);
+            i -= 16;
+            p += 16;
+        }
+        a = Read8(p+i-16);
+        b = Read8(p+i-8);
+    }
+    a ^= kWyp1;
+    b ^= seed;
+    Mum(&a,&b);
+    return Mix(a^kWyp0^n,b^kWyp1);
+}
+
+//16字节定长输入的快速路径，结果与Hash64(data,16,seed)相同
+//Table::BlockReader生成的cache key(cache_id+offset)都是16字节
+inline uint64_t Hash64Fixed16(const char* data,uint64_t seed){
+    using namespace hash_internal;
+    seed ^= Mix(seed^kWyp0,kWyp1);
+    uint64_t a = ((Read4(data)<<32) | Read4(data+8)) ^ kWyp1;
+    uint64_t b = ((Read4(data+12)<<32) | Read4(data+4)) ^ seed;
+    Mum(&a,&b);
+    return Mix(a^kWyp0^16,b^kWyp1);
+}
+
 } // namespace leveldb
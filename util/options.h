@@ -1,18 +1,37 @@
 #pragma once
 
 #include<stddef.h>
+#include<stdint.h>
 #include "util/comparator.h"
 namespace leveldb{
     
+class BlobSource;
 class Cache;
 class Comparator;
 class FilterPolicy;
 class Logger;
 class Snapshot;
+class SliceTransform;
 
-enum CompressionType{
+//sstable中filter的组织方式
+enum FilterLayout{
+    kBlockBasedFilter = 0x0,//每2KB的data block范围一个filter
+    kFullFilter = 0x1,//整个table一个filter
+    kPartitionedFilter = 0x2//按key切分成多个分区，分区按需经过block cache读取
+};
+
+//sstable中index的组织方式
+enum IndexLayout{
+    kSingleIndex = 0x0,//一个常驻内存的index block
+    kPartitionedIndex = 0x1//按大小切分成多个分区，只有分区的顶层索引常驻内存，分区按需经过block cache读取
+};
+
+//block trailer中的类型字节，自定义的压缩算法可以使用其他取值，见util/compression.h
+enum CompressionType:uint8_t{
     kNoCompression = 0x0,
-    kSnappyCompression = 0x1
+    kSnappyCompression = 0x1,
+    kZstdCompression = 0x2,
+    kLZ4Compression = 0x3
 };
 
 struct Options{
@@ -27,20 +46,78 @@ struct Options{
     Cache* block_cache = nullptr;
 
     size_t block_size = 4 * 1024;
+    //NewPosixWritableFile的写缓冲大小，向上取整到kWritableFileAlignment的倍数；
+    //缓冲写满时才调用write，TableBuilder在Finish时Flush剩余数据
+    size_t writable_file_buffer_size = 1024 * 1024;
+    //TableBuilder的输出文件(NewTableWritableFile)使用O_DIRECT，flush和compaction的写入不挤出page cache中前台读取的数据
+    bool use_direct_io_for_table_builds = false;
+    //后台读取sstable的文件(NewBackgroundRandomAccessFile)使用O_DIRECT，每次至少读取direct_io_readahead_size字节；
+    //前台读取仍经过page cache或mmap。文件系统不支持O_DIRECT时两者都退回普通读写
+    bool use_direct_reads_for_background = false;
+    size_t direct_io_readahead_size = 1024 * 1024;
 
     int block_restart_interval = 16;
+    //在data block末尾追加user key到重启区间的hash索引，点查时直接定位重启区间或确定key不在block中
+    //旧版本无法读取带hash索引的block
+    bool data_block_hash_index = false;
+    //hash索引中key数与bucket数之比
+    double data_block_hash_table_util_ratio = 0.75;
+    //block第一次Seek时缓存重启点key的位置和8字节前缀，之后的Seek不再解码重启点
+    //每个重启点多占16字节，不计入block cache的容量；只用于block cache中的block，零拷贝文件不经过cache的block不建立缓存
+    bool block_restart_key_cache = false;
+    //data block的迭代器Prev时解码一次当前重启区间并缓存，区间内之后的Prev不必从重启点重新解析；
+    //为false时每次Prev都从重启点解析
+    bool block_prev_cache = true;
 
     size_t max_file_size = 2 * 1024 * 1024;
     CompressionType compression = kSnappyCompression;
+    //压缩算法支持字典(kZstdCompression)时，每个table先缓存约100倍这个大小的data block，
+    //用它们训练不超过这么多字节的字典，保存在meta block中，data block和index分区用它压缩；为0时不使用字典
+    //使用kBlockBasedFilter时不生效，filter需要data block写入时的偏移
+    size_t compression_dict_bytes = 0;
+    //按最近尝试压缩的block的压缩率判断数据是否可压缩，不可压缩时跳过压缩，间隔一段时间再尝试
+    //适合value本身已经压缩过的数据，结果见TableBuilder::CompressionStats
+    bool adaptive_compression = false;
     bool reuse_logs = false;
     const FilterPolicy* filter_policy = nullptr;
+    //只影响新生成的sstable，读取时按照metaindex中的记录识别
+    FilterLayout filter_layout = kBlockBasedFilter;
+    //kPartitionedFilter时每个分区大约包含的key数
+    size_t filter_partition_keys = 4096;
+    //只影响新生成的sstable，读取时按照metaindex中的记录识别
+    IndexLayout index_layout = kSingleIndex;
+    //kPartitionedIndex时每个index分区的大致字节数
+    size_t index_partition_size = 4 * 1024;
+    //Table::Open一次读取文件末尾这么多字节，落在其中的index、metaindex和filter不再单独读取；
+    //不超过footer大小时只读取footer，之后逐个读取这些block
+    size_t table_open_tail_size = 0;
+    //Table::Open时不读取filter，第一次点查需要时再读取，用于快速打开大量table
+    bool lazy_filter_loading = false;
+    //不为空时把key的前缀也加入filter，配合ReadOptions::prefix_seek跳过不含该前缀的table
+    const SliceTransform* prefix_extractor = nullptr;
+    //大于等于这个大小的value写入TableBuilder::SetBlobFile指定的blob文件，sstable中只保存引用；为0时不分离
+    //只影响新生成的sstable，读取时按照metaindex中的记录识别
+    size_t min_blob_size = 0;
+    //读取sstable中的blob引用，见table/blob_file.h
+    BlobSource* blob_source = nullptr;
 };
 
 struct ReadOptions{
     ReadOptions() = default;
+    //从文件读取的block校验checksum；block cache中的block记录放入时是否校验过，
+    //命中校验过的block不再重复校验，命中未校验的block时重新读取校验并替换cache中的项；
+    //零拷贝文件不经过cache的data block由table按偏移记录是否校验过，同样只校验一次
     bool verify_checksums = false;
     bool fill_cache = true;
     const Snapshot* snapshot = nullptr;
+    //Seek时target的前缀不在table(全表或分区filter)或memtable的前缀filter中，直接得到无效的迭代器；
+    //开启后迭代器只保证在target的前缀范围内结果正确
+    bool prefix_seek = false;
+    //迭代器连续向后读取多个data block后，一次读取后面的多个block；预读窗口从2个block开始，
+    //每次用完后翻倍，总大小不超过readahead_size，为0时不预读；相邻block合并读取时单次读取最多max(256KB,readahead_size)
+    size_t readahead_size = 256*1024;
+    //为false时blob引用不读取，value为带类型字节的编码(见DecodeBlobValue)，用于重写table时保留引用
+    bool resolve_blobs = true;
 };
 struct WriteOptions{
     WriteOptions() = default;
@@ -0,0 +1,43 @@
+#pragma once
+#include<stddef.h>
+#include<stdint.h>
+#include<chrono>
+#include<thread>
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "util/mutexlock.h"
+
+namespace leveldb{
+
+//简单的令牌桶限速器，多个线程共享同一个限速器时总速率不超过bytes_per_second
+class RateLimiter{
+public:
+    //bytes_per_second为0表示不限速
+    explicit RateLimiter(uint64_t bytes_per_second)
+        :bytes_per_second_(bytes_per_second),next_free_(std::chrono::steady_clock::now()){}
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    //申请bytes字节的I/O额度，额度不足时睡眠等待
+    void Request(size_t bytes){
+        if(bytes_per_second_==0) return;
+        std::chrono::steady_clock::time_point wait_until;
+        {
+            MutexLock l(&mutex_);
+            const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if(next_free_<now){
+                next_free_ = now;
+            }
+            wait_until = next_free_;
+            next_free_ += std::chrono::microseconds(bytes * 1000000 / bytes_per_second_);
+        }
+        std::this_thread::sleep_until(wait_until);
+    }
+
+private:
+    const uint64_t bytes_per_second_;
+    port::Mutex mutex_;
+    std::chrono::steady_clock::time_point next_free_ GUARDED_BY(mutex_);//下一次可以发起I/O的时间
+};
+
+} // namespace leveldb
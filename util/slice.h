@@ -55,7 +55,7 @@ public:
 
     //判断x是否是*this的前缀
     bool starts_with(const Slice& x)const{
-        return ((size_ >= x.size_) && (memcmp(data_,x.data_,x.size_)>=0));
+        return ((size_ >= x.size_) && (memcmp(data_,x.data_,x.size_)==0));
     }
 
 private:
@@ -0,0 +1,53 @@
+#pragma once
+#include<stddef.h>
+#include<string>
+#include "util/slice.h"
+
+namespace leveldb{
+
+//从key中取出前缀，用于前缀filter和前缀查找
+//要求比较器的顺序下前缀相同的key是连续的，BytewiseComparator满足这一点
+class SliceTransform{
+public:
+    virtual ~SliceTransform() = default;
+
+    //名字写入sstable的metaindex block中，只有名字相同时读取才使用前缀filter
+    virtual const char* Name() const = 0;
+
+    //key不在定义域中时不得调用
+    virtual Slice Transform(const Slice& key) const = 0;
+
+    //key是否有前缀
+    virtual bool InDomain(const Slice& key) const = 0;
+};
+
+namespace{
+
+class FixedPrefixTransform:public SliceTransform{
+public:
+    explicit FixedPrefixTransform(size_t prefix_len)
+        :prefix_len_(prefix_len),name_("leveldb.FixedPrefix." + std::to_string(prefix_len)){}
+
+    const char* Name() const override { return name_.c_str();}
+
+    Slice Transform(const Slice& key) const override{
+        assert(InDomain(key));
+        return Slice(key.data(),prefix_len_);
+    }
+
+    //短于prefix_len的key没有前缀
+    bool InDomain(const Slice& key) const override { return key.size()>=prefix_len_;}
+
+private:
+    size_t prefix_len_;
+    std::string name_;
+};
+
+} // namespace
+
+//取key的前prefix_len个字节作为前缀
+const SliceTransform* NewFixedPrefixTransform(size_t prefix_len){
+    return new FixedPrefixTransform(prefix_len);
+}
+
+} // namespace leveldb
@@ -0,0 +1,101 @@
+#pragma once
+#include<deque>
+#include<thread>
+#include<vector>
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "util/mutexlock.h"
+
+namespace leveldb{
+
+//固定线程数的后台线程池，任务按提交顺序执行
+class ThreadPool{
+public:
+    explicit ThreadPool(int num_threads);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    //等待已提交的任务全部完成后再退出
+    ~ThreadPool();
+
+    void Schedule(void(*function)(void* arg),void* arg);
+    //阻塞直到队列为空且没有正在运行的任务
+    void WaitForIdle();
+    int NumThreads() const { return static_cast<int>(threads_.size());}
+
+private:
+    struct Work{
+        void(*function)(void*);
+        void* arg;
+    };
+    static void ThreadMain(ThreadPool* pool);
+    void Run();
+
+    port::Mutex mutex_;
+    port::CondVar work_cv_;//有新任务或者需要退出
+    port::CondVar idle_cv_;//任务全部完成
+    std::deque<Work> queue_ GUARDED_BY(mutex_);
+    int running_ GUARDED_BY(mutex_);
+    bool shutting_down_ GUARDED_BY(mutex_);
+    std::vector<std::thread> threads_;
+};
+
+ThreadPool::ThreadPool(int num_threads)
+    :work_cv_(&mutex_),idle_cv_(&mutex_),running_(0),shutting_down_(false){
+    if(num_threads<1) num_threads = 1;
+    for(int i=0;i<num_threads;i++){
+        threads_.emplace_back(&ThreadPool::ThreadMain,this);
+    }
+}
+
+ThreadPool::~ThreadPool(){
+    {
+        MutexLock l(&mutex_);
+        shutting_down_ = true;
+        work_cv_.SignalAll();
+    }
+    for(size_t i=0;i<threads_.size();i++){
+        threads_[i].join();
+    }
+}
+
+void ThreadPool::Schedule(void(*function)(void* arg),void* arg){
+    MutexLock l(&mutex_);
+    assert(!shutting_down_);
+    queue_.push_back(Work{function,arg});
+    work_cv_.Signal();
+}
+
+void ThreadPool::WaitForIdle(){
+    MutexLock l(&mutex_);
+    while(!queue_.empty() || running_>0){
+        idle_cv_.Wait();
+    }
+}
+
+void ThreadPool::ThreadMain(ThreadPool* pool){ pool->Run();}
+
+void ThreadPool::Run(){
+    mutex_.Lock();
+    while(true){
+        while(queue_.empty() && !shutting_down_){
+            work_cv_.Wait();
+        }
+        if(queue_.empty()){
+            //shutting_down_且没有剩余任务
+            break;
+        }
+        Work work = queue_.front();
+        queue_.pop_front();
+        running_++;
+        mutex_.Unlock();
+        (*work.function)(work.arg);
+        mutex_.Lock();
+        running_--;
+        if(queue_.empty() && running_==0){
+            idle_cv_.SignalAll();
+        }
+    }
+    mutex_.Unlock();
+}
+
+} // namespace leveldb
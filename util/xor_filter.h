@@ -0,0 +1,204 @@
+#pragma once
+#include<stddef.h>
+#include<stdint.h>
+#include<algorithm>
+#include<atomic>
+#include<string>
+#include<vector>
+#include "util/bloom.h"
+#include "util/coding.h"
+#include "util/filter_policy.h"
+#include "util/hash.h"
+#include "util/slice.h"
+
+namespace leveldb{
+
+namespace{
+
+/**
+ * 8位指纹的XOR filter，格式:
+ * fingerprint数组(3*block_length字节) | seed(fixed32) | block_length(fixed32) | kXorFilterTag(1字节)
+ * key的hash在三段中各选一个位置h0,h1,h2，满足 fp[h0]^fp[h1]^fp[h2] == fingerprint(hash)
+ * 假阳率约为1/256，每个key约占9.84位，同样假阳率的bloom filter需要约11.5位
+ * 构建失败或者key太少时改用bloom格式，末尾字节不是kXorFilterTag的filter按bloom读取
+ */
+static const uint8_t kXorFilterTag = 0xfe;
+static const size_t kXorFilterTrailerSize = 9;
+//多次换seed仍然无法构建时放弃
+static const int kXorFilterMaxAttempts = 64;
+//假阳率为1/256的bloom filter理论上每个key需要的位数: log2(256)/ln2
+static const double kBloomBitsPerKeyAtXorFpRate = 11.54;
+
+static inline uint64_t XorRemix(uint64_t hash,uint32_t seed){
+    return hash_internal::Mix(hash ^ hash_internal::kWyp0,seed ^ hash_internal::kWyp1);
+}
+
+static inline uint32_t XorReduce(uint32_t x,uint32_t n){
+    return static_cast<uint32_t>((static_cast<uint64_t>(x)*n)>>32);
+}
+
+//r可以为0，右移位数取模64，避免移位64位的未定义行为
+static inline uint64_t XorRotl(uint64_t x,int r){
+    return (x<<r) | (x>>((64-r)&63));
+}
+
+//hash在第i段中的位置
+static inline uint32_t XorSlot(uint64_t h,int i,uint32_t block_length){
+    return XorReduce(static_cast<uint32_t>(XorRotl(h,21*i)),block_length) + i*block_length;
+}
+
+static inline uint8_t XorFingerprint(uint64_t h){
+    return static_cast<uint8_t>(h ^ (h>>32));
+}
+
+//剥离(peeling)构建，hashes中不能有重复，失败返回false
+static bool BuildXor8(const std::vector<uint64_t>& hashes,uint32_t seed,uint32_t block_length,uint8_t* fingerprints){
+    const uint32_t size = 3*block_length;
+    std::vector<uint8_t> count(size,0);
+    std::vector<uint64_t> xor_mask(size,0);
+    for(size_t i=0;i<hashes.size();i++){
+        const uint64_t h = XorRemix(hashes[i],seed);
+        for(int j=0;j<3;j++){
+            const uint32_t slot = XorSlot(h,j,block_length);
+            //同一位置被超过255个key选中时必然无法剥离
+            if(count[slot]==255) return false;
+            count[slot]++;
+            xor_mask[slot] ^= h;
+        }
+    }
+    std::vector<uint32_t> queue;
+    for(uint32_t i=0;i<size;i++){
+        if(count[i]==1) queue.push_back(i);
+    }
+    //stack中按剥离顺序记录(hash,只属于它的位置)
+    std::vector<std::pair<uint64_t,uint32_t>> stack;
+    stack.reserve(hashes.size());
+    while(!queue.empty()){
+        const uint32_t slot = queue.back();
+        queue.pop_back();
+        if(count[slot]!=1) continue;
+        const uint64_t h = xor_mask[slot];
+        stack.push_back(std::make_pair(h,slot));
+        for(int j=0;j<3;j++){
+            const uint32_t s = XorSlot(h,j,block_length);
+            count[s]--;
+            xor_mask[s] ^= h;
+            if(count[s]==1) queue.push_back(s);
+        }
+    }
+    if(stack.size()!=hashes.size()) return false;
+
+    memset(fingerprints,0,size);
+    //逆序赋值，每个位置赋值后不会再被后面的key改变
+    for(size_t i=stack.size();i>0;i--){
+        const uint64_t h = stack[i-1].first;
+        fingerprints[stack[i-1].second] = XorFingerprint(h) ^
+            fingerprints[XorSlot(h,0,block_length)] ^
+            fingerprints[XorSlot(h,1,block_length)] ^
+            fingerprints[XorSlot(h,2,block_length)];
+    }
+    return true;
+}
+
+class XorFilterPolicy:public FilterPolicy{
+public:
+    //bloom_bits_per_key为退回bloom格式时使用的参数
+    explicit XorFilterPolicy(int bloom_bits_per_key)
+        :bloom_bits_per_key_(bloom_bits_per_key),bloom_(bloom_bits_per_key),
+         filters_(0),keys_(0),filter_bytes_(0),bloom_bytes_(0),bloom_fallbacks_(0){}
+    const char* Name() const override { return "leveldb.Xor8Filter";}
+
+    void CreateFilter(const Slice* keys,int n,std::string* dst) const override{
+        std::vector<uint64_t> hashes(n);
+        for(int i=0;i<n;i++){
+            hashes[i] = BloomHash(keys[i]);
+        }
+        std::sort(hashes.begin(),hashes.end());
+        hashes.erase(std::unique(hashes.begin(),hashes.end()),hashes.end());
+
+        //32个额外位置保证key很少时也能构建
+        const size_t capacity = 32 + static_cast<size_t>(1.23*hashes.size());
+        const uint32_t block_length = static_cast<uint32_t>((capacity+2)/3);
+        const size_t xor_bytes = 3*block_length + kXorFilterTrailerSize;
+        size_t bloom_bytes = (n*bloom_bits_per_key_+7)/8;
+        if(bloom_bytes<8) bloom_bytes = 8;
+        bloom_bytes += 1;
+
+        const size_t init_size = dst->size();
+        bool built = false;
+        //key很少时固定开销占主导，bloom反而更小
+        if(xor_bytes<bloom_bytes){
+            dst->resize(init_size + 3*block_length);
+            uint8_t* fingerprints = reinterpret_cast<uint8_t*>(&(*dst)[init_size]);
+            for(uint32_t seed=0;seed<kXorFilterMaxAttempts && !built;seed++){
+                if(BuildXor8(hashes,seed,block_length,fingerprints)){
+                    PutFixed32(dst,seed);
+                    PutFixed32(dst,block_length);
+                    dst->push_back(static_cast<char>(kXorFilterTag));
+                    built = true;
+                }
+            }
+            if(!built){
+                dst->resize(init_size);
+            }
+        }
+        if(!built){
+            bloom_fallbacks_.fetch_add(1,std::memory_order_relaxed);
+            bloom_.CreateFilter(keys,n,dst);
+        }
+        const size_t filter_bytes = dst->size()-init_size;
+        filters_.fetch_add(1,std::memory_order_relaxed);
+        keys_.fetch_add(n,std::memory_order_relaxed);
+        filter_bytes_.fetch_add(filter_bytes,std::memory_order_relaxed);
+        //与同样假阳率的bloom filter比较，退回bloom格式时没有节省
+        bloom_bytes_.fetch_add(built ? static_cast<size_t>(hashes.size()*kBloomBitsPerKeyAtXorFpRate/8) + 1 : filter_bytes,
+                               std::memory_order_relaxed);
+    }
+
+    bool KeyMayMatch(const Slice& key,const Slice& filter) const override{
+        const size_t len = filter.size();
+        if(len<1 || static_cast<uint8_t>(filter[len-1])!=kXorFilterTag){
+            return BloomFilterMayMatch(key,filter);
+        }
+        if(len<kXorFilterTrailerSize) return true;
+        const char* trailer = filter.data() + len - kXorFilterTrailerSize;
+        const uint32_t seed = DecodeFixed32(trailer);
+        const uint32_t block_length = DecodeFixed32(trailer+4);
+        if(block_length==0 || 3*static_cast<uint64_t>(block_length)!=len-kXorFilterTrailerSize){
+            //格式错误时认为可能匹配
+            return true;
+        }
+        const uint8_t* fingerprints = reinterpret_cast<const uint8_t*>(filter.data());
+        const uint64_t h = XorRemix(BloomHash(key),seed);
+        const uint8_t f = fingerprints[XorSlot(h,0,block_length)] ^
+                          fingerprints[XorSlot(h,1,block_length)] ^
+                          fingerprints[XorSlot(h,2,block_length)];
+        return f==XorFingerprint(h);
+    }
+
+    void GetStats(FilterPolicyStats* stats) const override{
+        stats->filters = filters_.load(std::memory_order_relaxed);
+        stats->keys = keys_.load(std::memory_order_relaxed);
+        stats->filter_bytes = filter_bytes_.load(std::memory_order_relaxed);
+        stats->bloom_bytes = bloom_bytes_.load(std::memory_order_relaxed);
+        stats->bloom_fallbacks = bloom_fallbacks_.load(std::memory_order_relaxed);
+    }
+
+private:
+    size_t bloom_bits_per_key_;
+    BloomFilterPolicy bloom_;
+    //CreateFilter可能在多个TableBuilder中并发调用
+    mutable std::atomic<uint64_t> filters_;
+    mutable std::atomic<uint64_t> keys_;
+    mutable std::atomic<uint64_t> filter_bytes_;
+    mutable std::atomic<uint64_t> bloom_bytes_;
+    mutable std::atomic<uint64_t> bloom_fallbacks_;
+};
+
+} // namespace
+
+const FilterPolicy* NewXorFilterPolicy(int bloom_bits_per_key){
+    return new XorFilterPolicy(bloom_bits_per_key);
+}
+
+} // namespace leveldb